@@ -0,0 +1,43 @@
+#include "block_pool.h"
+
+#include <cstddef>
+#include <new>
+
+BlockPool::BlockPool(size_t blockSize, size_t blocksPerChunk)
+    : perChunk(blocksPerChunk > 0 ? blocksPerChunk : 1),
+      freeList(nullptr),
+      inUse(0) {
+    // every block has to hold a free list link and stay aligned for any type
+    const size_t align = alignof(std::max_align_t);
+    if (blockSize < sizeof(FreeBlock)) blockSize = sizeof(FreeBlock);
+    size = (blockSize + align - 1) / align * align;
+}
+
+BlockPool::~BlockPool() {
+    for (void* chunk : chunks) ::operator delete(chunk);
+}
+
+void* BlockPool::allocate() {
+    if (!freeList) {
+        chunks.reserve(chunks.size() + 1);  // so that push_back can't throw
+        char* chunk = static_cast<char*>(::operator new(size * perChunk));
+        chunks.push_back(chunk);
+        // link the blocks so that they are handed out in address order
+        for (size_t i = perChunk; i-- > 0;) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * size);
+            block->next = freeList;
+            freeList = block;
+        }
+    }
+    FreeBlock* block = freeList;
+    freeList = block->next;
+    ++inUse;
+    return block;
+}
+
+void BlockPool::release(void* p) {
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = freeList;
+    freeList = block;
+    --inUse;
+}
@@ -0,0 +1,44 @@
+#ifndef CP_EDITOR_BLOCK_POOL_H
+#define CP_EDITOR_BLOCK_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief allocator of fixed size blocks carved out of large chunks
+ *
+ * Released blocks go on a free list and are handed out again by the next
+ * allocate(); chunks are only given back when the pool is destroyed. Owners
+ * that share a pool reuse each other's memory, so a buffer that shrinks
+ * leaves its nodes to the one that grows. Not thread safe.
+ */
+class BlockPool {
+public:
+    explicit BlockPool(size_t blockSize, size_t blocksPerChunk = 256);
+    ~BlockPool();
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    void* allocate();
+    // p must come from allocate() of this pool
+    void release(void* p);
+
+    size_t blockSize() const { return size; }
+    // blocks handed out and not released
+    size_t used() const { return inUse; }
+    // blocks in all chunks, used or free
+    size_t reserved() const { return chunks.size() * perChunk; }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    size_t size, perChunk;
+    std::vector<void*> chunks;
+    FreeBlock* freeList;
+    size_t inUse;
+};
+
+#endif  // CP_EDITOR_BLOCK_POOL_H
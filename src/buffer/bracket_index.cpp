@@ -0,0 +1,270 @@
+#include "bracket_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "search.h"
+
+const size_t BracketIndex::LINES_PER_MATCH;
+const int BracketIndex::KINDS;
+const size_t BracketIndex::NONE;
+const size_t BracketIndex::UNKNOWN;
+
+namespace {
+
+/**
+ * @brief call f(x, kind, open) for the brackets of line
+ *
+ * Literals and comments are skipped; f returns false to stop.
+ */
+template <typename F>
+void forEachBracket(LineView line, F f) {
+    static const char BRACKETS[] = "([{)]}";
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quote) {
+            if (c == '\\')
+                i++;
+            else if (c == quote)
+                quote = 0;
+        } else if (c == '"' ||
+                   (c == '\'' && !(i > 0 && isdigit(line[i - 1])))) {
+            quote = c;  // a quote after a digit separates digits
+        } else if (c == '/' && i + 1 < line.size() && line[i + 1] == '/') {
+            return;
+        } else if (c == '/' && i + 1 < line.size() && line[i + 1] == '*') {
+            const char* end = findFirst(line.begin() + i + 2,
+                                        line.size() - i - 2, LineView("*/"));
+            if (!end) return;
+            i = end - line.begin() + 1;
+        } else if (const char* p = c ? strchr(BRACKETS, c) : nullptr) {
+            int k = (p - BRACKETS) % 3;
+            if (!f(i, k, p - BRACKETS < 3)) return;
+        }
+    }
+}
+
+}  // namespace
+
+BracketIndex::BracketIndex() : budget(0), unfinished(false), lexed(0) {}
+
+int BracketIndex::kindOf(char c) {
+    switch (c) {
+        case '(':
+        case ')':
+            return 0;
+        case '[':
+        case ']':
+            return 1;
+        case '{':
+        case '}':
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+void BracketIndex::clear() {
+    tree.clear();
+    unfinished = false;
+}
+
+// the lines after the tree are lexed when it grows to them
+void BracketIndex::invalidate(size_t y) {
+    if (y >= tree.size()) return;
+    tree.set(y, Line{Summary(), true});
+}
+
+void BracketIndex::insertLines(size_t y, size_t n) {
+    if (y >= tree.size()) return;
+    tree.insert(y, n, Line{Summary(), true});
+}
+
+void BracketIndex::eraseLines(size_t y, size_t n) {
+    if (y >= tree.size() || n == 0) return;
+    tree.erase(y, std::min(n, tree.size() - y));
+}
+
+BracketIndex::Summary BracketIndex::combine(const Summary& a,
+                                            const Summary& b) {
+    Summary out;
+    for (int k = 0; k < KINDS; ++k) {
+        const Depth& l = a.kinds[k];
+        const Depth& r = b.kinds[k];
+        out.kinds[k].delta = l.delta + r.delta;
+        out.kinds[k].low = std::min(l.low, l.delta + r.low);
+        out.kinds[k].high = std::max(r.high, r.delta + l.high);
+    }
+    return out;
+}
+
+BracketIndex::Summary BracketIndex::summarize(LineView line) {
+    lexed++;
+    if (budget > 0) budget--;
+    Summary out = Summary();
+    forEachBracket(line, [&out](size_t, int k, bool open) -> bool {
+        Depth& d = out.kinds[k];
+        int step = open ? 1 : -1;
+        d.delta += step;
+        d.low = std::min(d.low, d.delta);
+        // every suffix gets the bracket, and the empty one is still there
+        d.high = std::max(d.high + step, 0);
+        return true;
+    });
+    return out;
+}
+
+void BracketIndex::refresh(const TextBuffer& buffer, size_t end) {
+    tree.modify([this](const Line& lines) { return lines.dirty && budget > 0; },
+                [this, &buffer](size_t y, Line& line) {
+                    if (!line.dirty || budget == 0) return;
+                    line.summary = summarize(buffer.line(y));
+                    line.dirty = false;
+                });
+    size_t first = tree.size();
+    if (first >= end) return;
+    tree.append(std::min(end - first, budget),
+                [this, &buffer, first](size_t i) {
+                    return Line{summarize(buffer.line(first + i)), false};
+                });
+}
+
+size_t BracketIndex::findForward(Ref t, size_t base, size_t first, int kind,
+                                 long& depth) const {
+    if (t == LineTree<Lines>::NIL || base + tree.size(t) <= first)
+        return NONE;
+    const Line& lines = tree.sum(t);
+    const Depth& d = lines.summary.kinds[kind];
+    if (base >= first && !lines.dirty && depth + d.low > 0) {
+        depth += d.delta;
+        return NONE;
+    }
+    size_t y = findForward(tree.left(t), base, first, kind, depth);
+    if (y != NONE) return y;
+    // then the line of t itself, between its two subtrees
+    size_t mid = base + tree.size(tree.left(t));
+    if (mid >= first) {
+        if (tree.value(t).dirty) return UNKNOWN;
+        const Depth& own = tree.value(t).summary.kinds[kind];
+        if (depth + own.low <= 0) return mid;
+        depth += own.delta;
+    }
+    return findForward(tree.right(t), mid + 1, first, kind, depth);
+}
+
+size_t BracketIndex::findBackward(Ref t, size_t base, size_t end, int kind,
+                                  long& depth) const {
+    if (t == LineTree<Lines>::NIL || base >= end) return NONE;
+    const Line& lines = tree.sum(t);
+    const Depth& d = lines.summary.kinds[kind];
+    if (base + tree.size(t) <= end && !lines.dirty && depth - d.high > 0) {
+        depth -= d.delta;
+        return NONE;
+    }
+    size_t mid = base + tree.size(tree.left(t));
+    size_t y = findBackward(tree.right(t), mid + 1, end, kind, depth);
+    if (y != NONE) return y;
+    if (mid < end) {
+        if (tree.value(t).dirty) return UNKNOWN;
+        const Depth& own = tree.value(t).summary.kinds[kind];
+        if (depth - own.high <= 0) return mid;
+        depth -= own.delta;
+    }
+    return findBackward(tree.left(t), base, end, kind, depth);
+}
+
+bool BracketIndex::scanForward(LineView line, size_t from, int kind,
+                               long& depth, size_t& x) {
+    lexed++;
+    bool found = false;
+    forEachBracket(line, [&](size_t i, int k, bool open) -> bool {
+        if (i < from || k != kind) return true;
+        depth += open ? 1 : -1;
+        if (depth > 0) return true;
+        x = i;
+        found = true;
+        return false;
+    });
+    return found;
+}
+
+bool BracketIndex::scanBackward(LineView line, size_t to, int kind,
+                                long& depth, size_t& x) {
+    lexed++;
+    std::vector<size_t>& found = columns;
+    found.clear();
+    forEachBracket(line, [&found, to, kind](size_t i, int k, bool) -> bool {
+        if (i >= to) return false;
+        if (k == kind) found.push_back(i);
+        return true;
+    });
+    for (size_t j = found.size(); j-- > 0;) {
+        char c = line[found[j]];
+        depth += c == ')' || c == ']' || c == '}' ? 1 : -1;
+        if (depth == 0) {
+            x = found[j];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BracketIndex::match(const TextBuffer& buffer, TextPosition at,
+                         TextPosition& match) {
+    unfinished = false;
+    if (at.y >= buffer.lineCount()) return false;
+    LineView line = buffer.line(at.y);
+    if (at.x >= line.size()) return false;
+    int kind = kindOf(line[at.x]);
+    if (kind < 0) return false;
+    char c = line[at.x];
+    bool open = c == '(' || c == '[' || c == '{';
+
+    // the bracket must be one the lexer sees
+    bool code = false;
+    forEachBracket(line, [&code, at](size_t i, int, bool) -> bool {
+        code = i == at.x;
+        return i < at.x;
+    });
+    if (!code) return false;
+
+    long depth = 1;
+    size_t x;
+    if (open) {
+        if (scanForward(line, at.x + 1, kind, depth, x)) {
+            match = TextPosition{at.y, x};
+            return true;
+        }
+        budget = LINES_PER_MATCH;
+        refresh(buffer, buffer.lineCount());
+        size_t y = findForward(tree.root(), 0, at.y + 1, kind, depth);
+        // the match may be in the lines the tree lacks
+        unfinished = y == UNKNOWN ||
+                     (y == NONE && tree.size() < buffer.lineCount());
+        if (y == NONE || unfinished) return false;
+        // depth is now the one at the start of line y
+        if (!scanForward(buffer.line(y), 0, kind, depth, x)) return false;
+        match = TextPosition{y, x};
+        return true;
+    }
+
+    if (scanBackward(line, at.x, kind, depth, x)) {
+        match = TextPosition{at.y, x};
+        return true;
+    }
+    budget = LINES_PER_MATCH;
+    refresh(buffer, at.y);
+    if (tree.size() < at.y) {
+        unfinished = true;
+        return false;
+    }
+    size_t y = findBackward(tree.root(), 0, at.y, kind, depth);
+    unfinished = y == UNKNOWN;
+    if (y == NONE || unfinished) return false;
+    LineView found = buffer.line(y);
+    if (!scanBackward(found, found.size(), kind, depth, x)) return false;
+    match = TextPosition{y, x};
+    return true;
+}
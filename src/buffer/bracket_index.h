@@ -0,0 +1,130 @@
+#ifndef CP_EDITOR_BRACKET_INDEX_H
+#define CP_EDITOR_BRACKET_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "buffer.h"
+#include "line_tree.h"
+#include "line_view.h"
+#include "text_position.h"
+
+/**
+ * @brief finds the bracket matching another one in O(log n) lines
+ *
+ * For each kind of bracket, (), [] and {}, every line is summed up by how
+ * much it changes the nesting depth and by the lowest and highest depth
+ * it reaches from its start or its end. These summaries are kept in a
+ * LineTree, so the first line where the depth drops below the one of a
+ * bracket is found by walking down its sums instead of lexing every line
+ * in between. Only the lines with the two brackets are lexed.
+ *
+ * Brackets in string and character literals and in comments that end on
+ * their line are skipped. Lines are lexed on their own, so brackets in a
+ * block comment that spans lines count.
+ *
+ * The tree holds the lines from the first one on, as far as the matches
+ * so far needed them. An edited or inserted line is only marked in the
+ * tree, in O(log n), and lexed again by the next match that leaves its
+ * line, which finds the marked lines through the sums. Erasing lines costs
+ * O(log n) and the erased lines themselves.
+ *
+ * A match lexes at most LINES_PER_MATCH of the marked lines and of the
+ * lines the tree lacks, so a big file is read over several matches rather
+ * than all at once. Until then pending() tells a bracket that isn't
+ * matched yet apart from one that has no match.
+ */
+class BracketIndex {
+public:
+    static const size_t LINES_PER_MATCH = 16384;
+
+    BracketIndex();
+
+    // forget every line, the buffer has new contents
+    void clear();
+    // line y was modified
+    void invalidate(size_t y);
+    // n lines were inserted before line y
+    void insertLines(size_t y, size_t n);
+    // lines [y, y + n) were erased
+    void eraseLines(size_t y, size_t n);
+
+    /**
+     * @brief find the bracket matching the one at column at.x of line at.y
+     * @param match set to the position of the matching bracket
+     * @return false if there is no bracket at at, or it is not matched, or
+     * it is pending()
+     */
+    bool match(const TextBuffer& buffer, TextPosition at, TextPosition& match);
+    // the last match() ran out of lines to lex before it could tell, the
+    // next one goes on
+    bool pending() const { return unfinished; }
+
+    static bool isBracket(char c) { return kindOf(c) >= 0; }
+
+    // number of lines lexed so far, to check the work done
+    size_t linesLexed() const { return lexed; }
+
+private:
+    static const int KINDS = 3;
+    static const size_t NONE = static_cast<size_t>(-1);
+    static const size_t UNKNOWN = NONE - 1;  // a marked line is in the way
+
+    // change of depth through some lines, opening brackets count 1
+    struct Depth {
+        int32_t delta;
+        int32_t low;   // lowest depth from the start, 0 at most
+        int32_t high;  // highest change of depth to the end, 0 at least
+    };
+    struct Summary {
+        Depth kinds[KINDS];
+    };
+    // a line, or the sum of some lines, of the tree
+    struct Line {
+        Summary summary;
+        bool dirty;  // to lex again, summary is wrong
+    };
+    struct Lines {
+        typedef Line Value;
+        typedef Line Sum;
+        static Line sum(const Line& line) { return line; }
+        static Line combine(const Line& a, const Line& b) {
+            return Line{BracketIndex::combine(a.summary, b.summary),
+                        a.dirty || b.dirty};
+        }
+    };
+    typedef LineTree<Lines>::Ref Ref;
+
+    // 0, 1 or 2 for the kind of bracket c is, -1 if it is not one
+    static int kindOf(char c);
+    static Summary combine(const Summary& a, const Summary& b);
+    Summary summarize(LineView line);
+
+    // lex the marked lines, then the lines before end the tree lacks, as
+    // long as the budget lasts
+    void refresh(const TextBuffer& buffer, size_t end);
+
+    // first line from first on where depth drops to 0, walking down from
+    // t, whose lines start at base; depth gets the change up to it.
+    // UNKNOWN if a marked line comes first
+    size_t findForward(Ref t, size_t base, size_t first, int kind,
+                       long& depth) const;
+    // last line before end where depth, going backward, drops to 0
+    size_t findBackward(Ref t, size_t base, size_t end, int kind,
+                        long& depth) const;
+    // column of the bracket at or after from where depth drops to 0
+    bool scanForward(LineView line, size_t from, int kind, long& depth,
+                     size_t& x);
+    // same, for the brackets before to, from right to left
+    bool scanBackward(LineView line, size_t to, int kind, long& depth,
+                      size_t& x);
+
+    LineTree<Lines> tree;         // the first lines of the buffer
+    size_t budget;                // lines the running match may still lex
+    bool unfinished;
+    std::vector<size_t> columns;  // of the brackets of a line when scanning
+    size_t lexed;
+};
+
+#endif  // CP_EDITOR_BRACKET_INDEX_H
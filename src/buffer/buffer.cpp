@@ -0,0 +1,587 @@
+#include "buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "search.h"
+
+// lines a thread takes at a time in findAll() and replaceAll()
+static const size_t TASK_LINES = 1 << 14;
+
+// run task(i) for every i < tasks on up to threads threads, each taking the
+// next one until there are none left
+template <typename F>
+static void runTasks(size_t tasks, unsigned threads, F task) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    threads = std::max<size_t>(1, std::min<size_t>(threads, tasks));
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t i; (i = next++) < tasks;) task(i);
+    };
+    std::vector<std::thread> helpers;
+    for (unsigned t = 1; t < threads; ++t) helpers.emplace_back(work);
+    work();
+    for (std::thread& helper : helpers) helper.join();
+}
+
+TextBuffer::TextBuffer() : TextBuffer(newPool()) {}
+
+TextBuffer::TextBuffer(std::shared_ptr<BlockPool> pool)
+    : root(nullptr), pool(pool), seed(2463534242u) {
+    if (!pool || pool->blockSize() < sizeof(Node))
+        throw std::invalid_argument("TextBuffer: blocks too small for nodes");
+}
+
+std::shared_ptr<BlockPool> TextBuffer::newPool() {
+    return std::make_shared<BlockPool>(sizeof(Node));
+}
+
+TextBuffer::~TextBuffer() { destroy(root); }
+
+void TextBuffer::load(std::shared_ptr<const MappedFile> file) {
+    clear();
+    source = file;
+    if (source && source->lineCount() > 0)
+        root = newPiece(0, source->lineCount());
+}
+
+void TextBuffer::update(Node* t) {
+    t->size = t->count + size(t->left) + size(t->right);
+}
+
+void TextBuffer::destroy(Node* t) {
+    while (t) {
+        destroy(t->left);
+        Node* right = t->right;
+        deleteNode(t);
+        t = right;
+    }
+}
+
+TextBuffer::Node* TextBuffer::merge(Node* a, Node* b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (a->priority > b->priority) {
+        a->right = merge(a->right, b);
+        update(a);
+        return a;
+    }
+    b->left = merge(a, b->left);
+    update(b);
+    return b;
+}
+
+void TextBuffer::split(Node* t, size_t k, Node*& l, Node*& r) {
+    if (!t) {
+        l = r = nullptr;
+        return;
+    }
+    size_t leftSize = size(t->left);
+    if (k <= leftSize) {
+        split(t->left, k, l, t->left);
+        r = t;
+    } else if (k >= leftSize + t->count) {
+        split(t->right, k - leftSize - t->count, t->right, r);
+        l = t;
+    } else {
+        // k falls inside an untouched piece, cut it in two
+        size_t head = k - leftSize;
+        Node* tail = newPiece(t->first + head, t->count - head);
+        t->count = head;
+        r = merge(tail, t->right);
+        t->right = nullptr;
+        l = t;
+    }
+    update(t);
+}
+
+unsigned TextBuffer::nextPriority() {
+    // xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+TextBuffer::Node* TextBuffer::newNode(const std::string& text) {
+    void* p = pool->allocate();
+    try {
+        return new (p)
+            Node{text, 0, 1, true, nextPriority(), 1, nullptr, nullptr};
+    } catch (...) {
+        pool->release(p);
+        throw;
+    }
+}
+
+TextBuffer::Node* TextBuffer::newPiece(size_t first, size_t count) {
+    return new (pool->allocate()) Node{
+        std::string(), first, count, false, nextPriority(), count,
+        nullptr,       nullptr};
+}
+
+void TextBuffer::deleteNode(Node* t) {
+    t->~Node();
+    pool->release(t);
+}
+
+TextBuffer::Node* TextBuffer::find(size_t y, size_t& offset) const {
+    if (y >= lineCount()) throw std::out_of_range("TextBuffer: no such line");
+    Node* t = root;
+    while (true) {
+        size_t leftSize = size(t->left);
+        if (y < leftSize) {
+            t = t->left;
+        } else if (y < leftSize + t->count) {
+            offset = y - leftSize;
+            return t;
+        } else {
+            y -= leftSize + t->count;
+            t = t->right;
+        }
+    }
+}
+
+TextBuffer::Node* TextBuffer::edit(size_t y) {
+    size_t offset;
+    Node* t = find(y, offset);
+    if (t->edited) return t;
+
+    // detach the line from its piece and give it its own copy
+    Node *l, *m, *r;
+    split(root, y, l, r);
+    split(r, 1, m, r);
+    m->text = source->line(m->first).str();
+    m->edited = true;
+    root = merge(merge(l, m), r);
+    return m;
+}
+
+LineView TextBuffer::line(size_t y) const {
+    size_t offset;
+    const Node* t = find(y, offset);
+    if (t->edited) return LineView(t->text);
+    return source->line(t->first + offset);
+}
+
+Snapshot TextBuffer::snapshot() const {
+    Snapshot out(source);
+    addToSnapshot(root, out);
+    return out;
+}
+
+void TextBuffer::addToSnapshot(const Node* t, Snapshot& out) const {
+    while (t) {
+        addToSnapshot(t->left, out);
+        if (t->edited) {
+            out.addText(t->text);
+            out.addText("\n");
+        } else {
+            // the lines of a piece are one run of bytes in the source
+            size_t begin = source->lineStart(t->first);
+            size_t end = source->lineStart(t->first + t->count);
+            if (end > source->size()) {
+                // the file doesn't end in a newline, write one anyway
+                out.addSource(begin, source->size());
+                out.addText("\n");
+            } else {
+                out.addSource(begin, end);
+            }
+        }
+        t = t->right;
+    }
+}
+
+bool TextBuffer::search(LineView needle, TextPosition from,
+                        TextPosition& match) const {
+    if (needle.empty() || from.y >= lineCount()) return false;
+    return searchForward(root, 0, needle, from, match);
+}
+
+bool TextBuffer::searchForward(const Node* t, size_t base, LineView needle,
+                               TextPosition from, TextPosition& match) const {
+    while (t) {
+        size_t mid = base + size(t->left);  // first line of t
+        if (from.y < mid) {
+            if (searchForward(t->left, base, needle, from, match)) return true;
+            from = TextPosition{mid, 0};
+        }
+        if (from.y < mid + t->count) {
+            if (t->edited) {
+                size_t x = std::min(from.x, t->text.size());
+                const char* p = findFirst(t->text.data() + x,
+                                          t->text.size() - x, needle);
+                if (p) {
+                    match = TextPosition{mid, static_cast<size_t>(
+                                                  p - t->text.data())};
+                    return true;
+                }
+            } else {
+                // search the rest of the piece as one run of bytes, a match
+                // can't span lines as the needle has no newline
+                size_t y = t->first + from.y - mid;
+                size_t begin = source->lineStart(y) +
+                               std::min(from.x, source->line(y).size());
+                size_t end = std::min(source->lineStart(t->first + t->count),
+                                      source->size());
+                const char* p = findFirst(source->data() + begin,
+                                          end - begin, needle);
+                if (p) {
+                    size_t offset = p - source->data();
+                    size_t line = source->lineOf(offset);
+                    match = TextPosition{mid + line - t->first,
+                                         offset - source->lineStart(line)};
+                    return true;
+                }
+            }
+        }
+        base = mid + t->count;
+        from = TextPosition{base, 0};
+        t = t->right;
+    }
+    return false;
+}
+
+bool TextBuffer::searchBackward(LineView needle, TextPosition from,
+                                TextPosition& match) const {
+    if (needle.empty() || lineCount() == 0) return false;
+    if (from.y >= lineCount())
+        from = TextPosition{lineCount() - 1, std::string::npos};
+    return searchBackward(root, 0, needle, from, match);
+}
+
+bool TextBuffer::searchBackward(const Node* t, size_t base, LineView needle,
+                                TextPosition from, TextPosition& match) const {
+    while (t) {
+        size_t mid = base + size(t->left);
+        size_t end = mid + t->count;
+        if (from.y >= end) {
+            if (searchBackward(t->right, end, needle, from, match)) return true;
+            from = TextPosition{end - 1, std::string::npos};
+        }
+        if (from.y >= mid) {
+            // matches have to start before column from.x of line from.y
+            if (t->edited) {
+                size_t x = std::min(from.x, t->text.size());
+                size_t limit = std::min(x + needle.size() - 1, t->text.size());
+                const char* p = findLast(t->text.data(), limit, needle);
+                if (p) {
+                    match = TextPosition{mid, static_cast<size_t>(
+                                                  p - t->text.data())};
+                    return true;
+                }
+            } else {
+                size_t y = t->first + from.y - mid;
+                size_t length = source->line(y).size();
+                size_t x = std::min(from.x, length);
+                size_t begin = source->lineStart(t->first);
+                size_t limit = source->lineStart(y) +
+                               std::min(x + needle.size() - 1, length);
+                const char* p = findLast(source->data() + begin,
+                                         limit - begin, needle);
+                if (p) {
+                    size_t offset = p - source->data();
+                    size_t line = source->lineOf(offset);
+                    match = TextPosition{mid + line - t->first,
+                                         offset - source->lineStart(line)};
+                    return true;
+                }
+            }
+        }
+        if (mid == 0) return false;
+        from = TextPosition{mid - 1, std::string::npos};
+        t = t->left;
+    }
+    return false;
+}
+
+void TextBuffer::spans(Node* t, size_t base, std::vector<Span>& out) const {
+    while (t) {
+        spans(t->left, base, out);
+        base += size(t->left);
+        out.push_back(Span{t, base});
+        base += t->count;
+        t = t->right;
+    }
+}
+
+void TextBuffer::findIn(const std::vector<Span>& order, size_t begin,
+                        size_t end, LineView needle,
+                        std::vector<TextPosition>& out) const {
+    // the node holding line begin is the last one starting at or before it
+    auto it = std::upper_bound(
+        order.begin(), order.end(), begin,
+        [](size_t y, const Span& span) { return y < span.line; });
+    for (--it; it != order.end() && it->line < end; ++it) {
+        const Node* t = it->node;
+        if (t->edited) {
+            const char* data = t->text.data();
+            size_t x = 0;
+            while (const char* p = findFirst(data + x, t->text.size() - x,
+                                             needle)) {
+                out.push_back(
+                    TextPosition{it->line, static_cast<size_t>(p - data)});
+                x = p - data + needle.size();
+            }
+            continue;
+        }
+        // the lines of the piece in the range are one run of bytes
+        size_t first = t->first + (std::max(begin, it->line) - it->line);
+        size_t last = t->first + (std::min(end, it->line + t->count) -
+                                  it->line);
+        const char* data = source->data();
+        size_t pos = source->lineStart(first);
+        size_t stop = std::min(source->lineStart(last), source->size());
+        size_t line = first;  // holding pos, the matches come in order
+        while (const char* p = findFirst(data + pos, stop - pos, needle)) {
+            size_t offset = p - data;
+            while (source->lineStart(line + 1) <= offset) line++;
+            out.push_back(TextPosition{it->line + line - t->first,
+                                       offset - source->lineStart(line)});
+            pos = offset + needle.size();
+        }
+    }
+}
+
+void TextBuffer::findAll(LineView needle, std::vector<TextPosition>& matches,
+                         unsigned threads) const {
+    matches.clear();
+    if (needle.empty() || empty()) return;
+    std::vector<Span> order;
+    spans(root, 0, order);
+    size_t lines = lineCount();
+    size_t tasks = (lines + TASK_LINES - 1) / TASK_LINES;
+    std::vector<std::vector<TextPosition>> found(tasks);
+    runTasks(tasks, threads, [&](size_t i) {
+        size_t begin = i * TASK_LINES;
+        findIn(order, begin, std::min(lines, begin + TASK_LINES), needle,
+               found[i]);
+    });
+
+    size_t total = 0;
+    for (const std::vector<TextPosition>& f : found) total += f.size();
+    matches.reserve(total);
+    for (std::vector<TextPosition>& f : found) {
+        matches.insert(matches.end(), f.begin(), f.end());
+        std::vector<TextPosition>().swap(f);
+    }
+}
+
+void TextBuffer::replaceAll(const std::vector<TextPosition>& at, size_t n,
+                            LineView with, unsigned threads) {
+    if (at.empty()) return;
+    if (at.back().y >= lineCount())
+        throw std::out_of_range("TextBuffer: no such line");
+    // the positions on the i-th line that changes are at[starts[i]] up to
+    // at[starts[i + 1]]
+    std::vector<size_t> starts;
+    for (size_t i = 0; i < at.size(); ++i) {
+        if (i > 0 && at[i].y < at[i - 1].y)
+            throw std::invalid_argument("TextBuffer: positions out of order");
+        if (i == 0 || at[i].y != at[i - 1].y) starts.push_back(i);
+    }
+    size_t changed = starts.size();
+    starts.push_back(at.size());
+
+    // the lines that change, found in one walk over the nodes in order
+    std::vector<Span> order;
+    spans(root, 0, order);
+    std::vector<LineView> old(changed);
+    for (size_t i = 0, j = 0; i < changed; ++i) {
+        size_t y = at[starts[i]].y;
+        while (order[j].line + order[j].node->count <= y) j++;
+        const Node* t = order[j].node;
+        old[i] = t->edited ? LineView(t->text)
+                           : source->line(t->first + y - order[j].line);
+    }
+
+    // build the new lines, nothing is modified until they all are
+    std::vector<std::string> texts(changed);
+    std::atomic<bool> bad(false);
+    size_t tasks = (changed + TASK_LINES - 1) / TASK_LINES;
+    runTasks(tasks, threads, [&](size_t task) {
+        size_t last = std::min(changed, (task + 1) * TASK_LINES);
+        for (size_t i = task * TASK_LINES; i < last && !bad; ++i) {
+            LineView line = old[i];
+            size_t matches = starts[i + 1] - starts[i];
+            std::string& text = texts[i];
+            text.reserve(line.size() + matches * with.size());
+            size_t x = 0;
+            for (size_t j = starts[i]; j < starts[i + 1]; ++j) {
+                if (at[j].x < x || at[j].x + n > line.size()) {
+                    bad = true;
+                    break;
+                }
+                text.append(line.data() + x, at[j].x - x);
+                text.append(with.data(), with.size());
+                x = at[j].x + n;
+            }
+            text.append(line.data() + x, line.size() - x);
+        }
+    });
+    if (bad) throw std::out_of_range("TextBuffer: no such text to replace");
+
+    // the nodes in order, with the pieces cut around the lines that change
+    std::vector<Node*> nodes;
+    nodes.reserve(order.size() + 2 * changed);
+    size_t next = 0;  // the next line that changes
+    for (const Span& span : order) {
+        Node* t = span.node;
+        size_t end = span.line + t->count;
+        if (next == changed || at[starts[next]].y >= end) {
+            nodes.push_back(t);
+        } else if (t->edited) {
+            t->text.swap(texts[next++]);
+            nodes.push_back(t);
+        } else {
+            size_t first = t->first;
+            bool reused = false;  // t holds the first part of the piece
+            auto addPiece = [&](size_t from, size_t to) {
+                if (from == to) return;
+                if (reused) {
+                    nodes.push_back(newPiece(first + from - span.line,
+                                             to - from));
+                    return;
+                }
+                t->first = first + from - span.line;
+                t->count = to - from;
+                nodes.push_back(t);
+                reused = true;
+            };
+            size_t y = span.line;  // lines before y are in nodes
+            for (; next < changed && at[starts[next]].y < end; ++next) {
+                size_t line = at[starts[next]].y;
+                addPiece(y, line);
+                Node* m = newNode(std::string());
+                m->text.swap(texts[next]);
+                nodes.push_back(m);
+                y = line + 1;
+            }
+            addPiece(y, end);
+            if (!reused) deleteNode(t);
+        }
+    }
+    rebuild(nodes);
+}
+
+void TextBuffer::rebuild(const std::vector<Node*>& nodes) {
+    // the right spine of the tree so far, its priorities go down; a node
+    // takes the part of it it has a higher priority than as its left child
+    std::vector<Node*> spine;
+    for (Node* t : nodes) {
+        Node* last = nullptr;
+        while (!spine.empty() && spine.back()->priority < t->priority) {
+            last = spine.back();
+            spine.pop_back();
+        }
+        t->left = last;
+        t->right = nullptr;
+        if (!spine.empty()) spine.back()->right = t;
+        spine.push_back(t);
+    }
+    root = spine.empty() ? nullptr : spine.front();
+    updateAll(root);
+}
+
+void TextBuffer::updateAll(Node* t) {
+    if (!t) return;
+    updateAll(t->left);
+    updateAll(t->right);
+    update(t);
+}
+
+void TextBuffer::insertLine(size_t y, const std::string& text) {
+    if (y > lineCount()) throw std::out_of_range("TextBuffer: no such line");
+    Node *l, *r;
+    split(root, y, l, r);
+    root = merge(merge(l, newNode(text)), r);
+}
+
+void TextBuffer::appendLine(const std::string& text) {
+    root = merge(root, newNode(text));
+}
+
+void TextBuffer::eraseLine(size_t y) {
+    if (y >= lineCount()) throw std::out_of_range("TextBuffer: no such line");
+    Node *l, *m, *r;
+    split(root, y, l, r);
+    split(r, 1, m, r);
+    deleteNode(m);
+    root = merge(l, r);
+}
+
+void TextBuffer::setLine(size_t y, const std::string& text) {
+    edit(y)->text = text;
+}
+
+void TextBuffer::clear() {
+    destroy(root);
+    root = nullptr;
+    source.reset();
+}
+
+void TextBuffer::insertChar(size_t y, size_t x, char c) {
+    edit(y)->text.insert(x, 1, c);
+}
+
+void TextBuffer::eraseChar(size_t y, size_t x) { edit(y)->text.erase(x, 1); }
+
+void TextBuffer::insertText(size_t y, size_t x, const std::string& text) {
+    size_t nl = text.find('\n');
+    std::string& first = edit(y)->text;
+    if (nl == std::string::npos) {
+        first.insert(x, text);
+        return;
+    }
+
+    std::string tail = first.substr(x);
+    first.erase(x);
+    first.append(text, 0, nl);
+
+    // build the new lines on their own and link them in with one split
+    Node* lines = nullptr;
+    size_t pos = nl + 1;
+    while (true) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) {
+            lines = merge(lines, newNode(text.substr(pos) + tail));
+            break;
+        }
+        lines = merge(lines, newNode(text.substr(pos, end - pos)));
+        pos = end + 1;
+    }
+    Node *l, *r;
+    split(root, y + 1, l, r);
+    root = merge(merge(l, lines), r);
+}
+
+void TextBuffer::eraseText(size_t y, size_t x, size_t n) {
+    while (n > 0) {
+        std::string& text = edit(y)->text;
+        size_t rest = text.size() - x;
+        if (n <= rest) {
+            text.erase(x, n);
+            return;
+        }
+        // take the rest of the line and the line break after it
+        text.erase(x);
+        n -= rest + 1;
+        joinLines(y);
+    }
+}
+
+void TextBuffer::splitLine(size_t y, size_t x) {
+    std::string& text = edit(y)->text;
+    std::string tail = text.substr(x);
+    text.erase(x);
+    insertLine(y + 1, tail);
+}
+
+void TextBuffer::joinLines(size_t y) {
+    std::string tail = line(y + 1).str();
+    eraseLine(y + 1);
+    edit(y)->text += tail;
+}
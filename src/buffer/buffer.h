@@ -0,0 +1,176 @@
+#ifndef CP_EDITOR_BUFFER_H
+#define CP_EDITOR_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "block_pool.h"
+#include "line_view.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+#include "text_position.h"
+
+/**
+ * @brief line oriented text buffer
+ *
+ * The buffer is a sequence of pieces stored in an implicit treap ordered by
+ * line number. A piece is either a run of untouched lines of the mapped
+ * source file or a single line that has been edited. Every node keeps the
+ * number of lines in its subtree, so looking up, inserting and erasing a
+ * line costs O(log n). Lines of the source file are only copied once they
+ * are modified. Nodes come from a BlockPool, which buffers can share.
+ */
+class TextBuffer {
+public:
+    // nodes come from a pool of its own
+    TextBuffer();
+    // nodes come from pool, which must be made by newPool()
+    explicit TextBuffer(std::shared_ptr<BlockPool> pool);
+    ~TextBuffer();
+
+    // pool that TextBuffers can share
+    static std::shared_ptr<BlockPool> newPool();
+
+    TextBuffer(const TextBuffer&) = delete;
+    TextBuffer& operator=(const TextBuffer&) = delete;
+
+    // replace the contents by the lines of file, without copying them
+    void load(std::shared_ptr<const MappedFile> file);
+
+    size_t lineCount() const { return size(root); }
+    bool empty() const { return root == nullptr; }
+
+    LineView line(size_t y) const;
+    // contents that stay valid while the buffer is modified
+    Snapshot snapshot() const;
+
+    void insertLine(size_t y, const std::string& text);
+    void appendLine(const std::string& text);
+    void eraseLine(size_t y);
+    void setLine(size_t y, const std::string& text);
+    void clear();
+
+    void insertChar(size_t y, size_t x, char c);
+    void eraseChar(size_t y, size_t x);
+    // insert text, which may contain '\n', at column x of line y
+    void insertText(size_t y, size_t x, const std::string& text);
+    // erase n characters from column x of line y, a line break counts as one
+    void eraseText(size_t y, size_t x, size_t n);
+    // move the text after column x of line y to a new line below it
+    void splitLine(size_t y, size_t x);
+    // append line y + 1 to line y and remove it
+    void joinLines(size_t y);
+
+    /**
+     * @brief find needle, which must not contain '\n'
+     *
+     * Untouched pieces are searched in the mapped file as a whole rather
+     * than line by line.
+     * @param from search matches at or after this position
+     * @param match set to the start of the match
+     * @return false if there is no match
+     */
+    bool search(LineView needle, TextPosition from, TextPosition& match) const;
+    // like search, but for the last match starting before from
+    bool searchBackward(LineView needle, TextPosition from,
+                        TextPosition& match) const;
+
+    /**
+     * @brief every occurrence of needle, which must not contain '\n'
+     *
+     * The lines are cut into ranges that up to threads threads (by default
+     * one per core) search at the same time, untouched pieces as runs of
+     * bytes. A match starts after the end of the one before it.
+     * @param matches set to the starts of the matches, in order
+     */
+    void findAll(LineView needle, std::vector<TextPosition>& matches,
+                 unsigned threads = 0) const;
+    /**
+     * @brief replace the n characters at each position of at by with
+     *
+     * at is in order and its ranges neither overlap nor span lines, as
+     * findAll() gives them. The new lines are built on up to threads
+     * threads and the tree is then put together again in one pass over its
+     * nodes, instead of an edit of O(log n) per match.
+     */
+    void replaceAll(const std::vector<TextPosition>& at, size_t n,
+                    LineView with, unsigned threads = 0);
+
+    template <typename F>
+    void forEachLine(F f) const {
+        forEach(root, f);
+    }
+
+private:
+    struct Node {
+        std::string text;  // contents of an edited line
+        size_t first;      // first source line of an untouched piece
+        size_t count;      // number of lines in the piece
+        bool edited;
+        unsigned priority;
+        size_t size;  // number of lines in this subtree
+        Node* left;
+        Node* right;
+    };
+
+    static size_t size(const Node* t) { return t ? t->size : 0; }
+    static void update(Node* t);
+    void destroy(Node* t);
+    static Node* merge(Node* a, Node* b);
+    // first k lines of t go to l, the rest to r
+    void split(Node* t, size_t k, Node*& l, Node*& r);
+
+    template <typename F>
+    void forEach(const Node* t, F& f) const {
+        while (t) {
+            forEach(t->left, f);
+            if (t->edited) {
+                f(LineView(t->text));
+            } else {
+                for (size_t i = 0; i < t->count; ++i)
+                    f(source->line(t->first + i));
+            }
+            t = t->right;
+        }
+    }
+
+    // a node and its first line
+    struct Span {
+        Node* node;
+        size_t line;
+    };
+    // append the nodes of t, which holds the lines from base on, in order
+    void spans(Node* t, size_t base, std::vector<Span>& out) const;
+    // matches of needle in lines [begin, end), order has every node
+    void findIn(const std::vector<Span>& order, size_t begin, size_t end,
+                LineView needle, std::vector<TextPosition>& out) const;
+    // make the tree of nodes, which are in the order of their lines
+    void rebuild(const std::vector<Node*>& nodes);
+    // sum up the sizes under t again
+    static void updateAll(Node* t);
+
+    void addToSnapshot(const Node* t, Snapshot& out) const;
+    // t holds the lines from base on
+    bool searchForward(const Node* t, size_t base, LineView needle,
+                       TextPosition from, TextPosition& match) const;
+    bool searchBackward(const Node* t, size_t base, LineView needle,
+                        TextPosition from, TextPosition& match) const;
+
+    unsigned nextPriority();
+    Node* newNode(const std::string& text);
+    Node* newPiece(size_t first, size_t count);
+    void deleteNode(Node* t);
+    // node holding line y and the index of that line within its piece
+    Node* find(size_t y, size_t& offset) const;
+    // node owning a modifiable copy of line y
+    Node* edit(size_t y);
+
+    Node* root;
+    std::shared_ptr<BlockPool> pool;  // where the nodes live
+    std::shared_ptr<const MappedFile> source;
+    unsigned seed;  // state of xorshift generator for priorities
+};
+
+#endif  // CP_EDITOR_BUFFER_H
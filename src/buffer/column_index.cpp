@@ -0,0 +1,145 @@
+#include "column_index.h"
+
+#include <algorithm>
+
+#include "utf8.h"
+
+void ColumnIndex::build(LineView line, int tabSize) {
+    stops.clear();
+    length = line.size();
+
+    const char* p = line.data();
+    size_t x = 0, rx = 0, offset = 0;
+    while (true) {
+        // runs of plain ASCII need no stops
+        size_t run = plainSpan(p + x, length - x);
+        x += run;
+        rx += run;
+        offset += run;
+        if (x == length) break;
+
+        if (p[x] == '\t') {
+            size_t width = tabSize - rx % tabSize;
+            stops.push_back(Stop{x, 1, rx, width, offset, width, TAB});
+            x++;
+            rx += width;
+            offset += width;
+            continue;
+        }
+
+        uint32_t c;
+        size_t n = decodeUtf8(p + x, length - x, c);
+        if (n == 0) {
+            // shown as '?'
+            stops.push_back(Stop{x, 1, rx, 1, offset, 1, INVALID});
+            x++;
+            rx++;
+            offset++;
+            continue;
+        }
+
+        int width = codePointWidth(c);
+        if (width == 0) {
+            // a combining mark goes into the cell of the character before it
+            bool afterStop =
+                !stops.empty() && stops.back().x + stops.back().length == x;
+            if (afterStop && stops.back().kind == TEXT) {
+                stops.back().length += n;
+                stops.back().size += n;
+            } else if (x > 0 && !afterStop) {
+                stops.push_back(
+                    Stop{x - 1, n + 1, rx - 1, 1, offset - 1, n + 1, TEXT});
+            } else {
+                stops.push_back(Stop{x, n, rx, 0, offset, n, TEXT});
+            }
+        } else {
+            stops.push_back(Stop{x, n, rx, static_cast<size_t>(width), offset,
+                                 n, TEXT});
+        }
+        x += n;
+        rx += width;
+        offset += n;
+    }
+    renderLength = rx;
+    renderSize = offset;
+}
+
+const ColumnIndex::Stop* ColumnIndex::stopAt(size_t x) const {
+    auto it = std::upper_bound(
+        stops.begin(), stops.end(), x,
+        [](size_t x, const Stop& stop) { return x < stop.x; });
+    if (it == stops.begin()) return nullptr;
+    return &*(it - 1);
+}
+
+size_t ColumnIndex::renderColumn(size_t x) const {
+    if (x > length) x = length;
+    const Stop* stop = stopAt(x);
+    if (!stop) return x;
+    if (x < stop->x + stop->length) return stop->rx;
+    return stop->rx + stop->width + (x - stop->x - stop->length);
+}
+
+size_t ColumnIndex::charStart(size_t x) const {
+    const Stop* stop = stopAt(x);
+    if (stop && x < stop->x + stop->length) return stop->x;
+    return x;
+}
+
+size_t ColumnIndex::charEnd(size_t x) const {
+    if (x >= length) return length;
+    const Stop* stop = stopAt(x);
+    if (stop && x < stop->x + stop->length) return stop->x + stop->length;
+    return x + 1;
+}
+
+ColumnIndex::Cell ColumnIndex::cellAt(size_t rx) const {
+    // last stop starting at or before column rx
+    auto it = std::upper_bound(
+        stops.begin(), stops.end(), rx,
+        [](size_t rx, const Stop& stop) { return rx < stop.rx; });
+    if (it == stops.begin()) return Cell{rx, 1, rx, 1};
+    const Stop& stop = *(it - 1);
+    if (rx >= stop.rx + stop.width) {
+        size_t offset = stop.offset + stop.size + (rx - stop.rx - stop.width);
+        return Cell{offset, 1, rx, 1};
+    }
+    if (stop.kind == TAB)  // one space per column
+        return Cell{stop.offset + (rx - stop.rx), 1, rx, 1};
+    return Cell{stop.offset, stop.size, stop.rx, stop.width};
+}
+
+void ColumnIndex::render(LineView line, std::string& out) const {
+    out.clear();
+    out.reserve(renderSize);
+    size_t pos = 0;
+    for (auto& stop : stops) {
+        out.append(line.data() + pos, stop.x - pos);
+        switch (stop.kind) {
+            case TAB:
+                out.append(stop.width, ' ');
+                break;
+            case TEXT:
+                out.append(line.data() + stop.x, stop.length);
+                break;
+            case INVALID:
+                out += '?';
+                break;
+        }
+        pos = stop.x + stop.length;
+    }
+    out.append(line.data() + pos, line.size() - pos);
+}
+
+void ColumnIndex::render(const std::vector<unsigned char>& values,
+                         std::vector<unsigned char>& out) const {
+    out.clear();
+    out.reserve(renderLength);
+    size_t pos = 0;
+    for (auto& stop : stops) {
+        out.insert(out.end(), values.begin() + pos, values.begin() + stop.x);
+        out.insert(out.end(), stop.width, values[stop.x]);
+        pos = stop.x + stop.length;
+    }
+    out.insert(out.end(), values.begin() + pos, values.end());
+}
@@ -0,0 +1,70 @@
+#ifndef CP_EDITOR_COLUMN_INDEX_H
+#define CP_EDITOR_COLUMN_INDEX_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "line_view.h"
+
+/**
+ * @brief mapping between the columns of a line and of its rendering
+ *
+ * Only characters that don't render as one byte in one column are recorded,
+ * sorted by position: tabs, multibyte UTF-8 characters (wide or together
+ * with the combining marks after them) and bytes that are not valid UTF-8.
+ * Everything between them maps one to one, so looking up a rendered column
+ * is a binary search over the recorded stops.
+ */
+class ColumnIndex {
+public:
+    // a character on the screen: its bytes in the rendering and its columns
+    struct Cell {
+        size_t offset, size;
+        size_t rx, width;
+    };
+
+    ColumnIndex() : length(0), renderLength(0), renderSize(0) {}
+
+    void build(LineView line, int tabSize);
+
+    // rendered column of the character at x
+    size_t renderColumn(size_t x) const;
+    size_t renderWidth() const { return renderLength; }
+
+    // start of the character that contains x
+    size_t charStart(size_t x) const;
+    // position after the character that contains x
+    size_t charEnd(size_t x) const;
+    // character covering rendered column rx, which is below renderWidth()
+    Cell cellAt(size_t rx) const;
+
+    // write the rendering of line, which must be the indexed line, to out
+    void render(LineView line, std::string& out) const;
+    // spread a value per byte of the line over its rendered columns
+    void render(const std::vector<unsigned char>& values,
+                std::vector<unsigned char>& out) const;
+
+private:
+    enum Kind { TAB, TEXT, INVALID };
+
+    struct Stop {
+        size_t x;       // position in the line
+        size_t length;  // bytes in the line
+        size_t rx;      // rendered column
+        size_t width;   // number of rendered columns
+        size_t offset;  // position in the rendering
+        size_t size;    // bytes in the rendering
+        Kind kind;
+    };
+
+    // last stop starting at or before x, or nullptr
+    const Stop* stopAt(size_t x) const;
+
+    std::vector<Stop> stops;
+    size_t length;
+    size_t renderLength;
+    size_t renderSize;
+};
+
+#endif  // CP_EDITOR_COLUMN_INDEX_H
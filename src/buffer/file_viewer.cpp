@@ -0,0 +1,115 @@
+#include "file_viewer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+FileViewer::FileViewer(size_t windowSize, size_t maxLine)
+    : fd(-1),
+      length(0),
+      maxLine(std::max<size_t>(maxLine, 1)),
+      addr(nullptr),
+      windowBegin(0),
+      windowEnd(0) {
+    // a window has to hold a whole line on either side of a page boundary
+    size_t page = sysconf(_SC_PAGESIZE);
+    windowSize = std::max(windowSize, 2 * this->maxLine + 2 * page);
+    this->windowSize = (windowSize + page - 1) / page * page;
+}
+
+FileViewer::~FileViewer() { close(); }
+
+bool FileViewer::open(const std::string& path) {
+    close();
+
+    int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file == -1) return false;
+
+    struct stat st;
+    if (fstat(file, &st) == -1) {
+        int err = errno;
+        ::close(file);
+        errno = err;
+        return false;
+    }
+    fd = file;
+    length = st.st_size;
+    return true;
+}
+
+void FileViewer::close() {
+    unmap();
+    if (fd != -1) ::close(fd);
+    fd = -1;
+    length = 0;
+}
+
+void FileViewer::unmap() {
+    if (addr) munmap(const_cast<char*>(addr), windowEnd - windowBegin);
+    addr = nullptr;
+    windowBegin = windowEnd = 0;
+}
+
+const char* FileViewer::bytes(size_t offset, size_t n) {
+    if (addr && offset >= windowBegin && offset + n <= windowEnd)
+        return addr + (offset - windowBegin);
+    unmap();
+    if (n == 0 || offset + n > length) return nullptr;
+
+    // center the window on offset, scrolling goes either way
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t begin = offset > windowSize / 2 ? offset - windowSize / 2 : 0;
+    begin -= begin % page;
+    size_t end = std::min(length, begin + windowSize);
+    void* p = mmap(nullptr, end - begin, PROT_READ, MAP_PRIVATE, fd,
+                   static_cast<off_t>(begin));
+    if (p == MAP_FAILED) return nullptr;
+    addr = static_cast<const char*>(p);
+    windowBegin = begin;
+    windowEnd = end;
+    return addr + (offset - begin);
+}
+
+size_t FileViewer::lineStart(size_t offset) {
+    if (offset >= length) offset = length > 0 ? length - 1 : 0;
+    size_t n = std::min(maxLine, offset);
+    const char* p = bytes(offset - n, n);
+    if (!p) return offset;
+    const char* nl = static_cast<const char*>(memrchr(p, '\n', n));
+    return nl ? offset - n + (nl - p) + 1 : offset - n;
+}
+
+size_t FileViewer::nextLine(size_t offset) {
+    if (offset >= length) return length;
+    size_t n = std::min(maxLine, length - offset);
+    const char* p = bytes(offset, n);
+    if (!p) return length;
+    const char* nl = static_cast<const char*>(memchr(p, '\n', n));
+    return nl ? offset + (nl - p) + 1 : offset + n;
+}
+
+size_t FileViewer::previousLine(size_t offset) {
+    if (offset == 0) return 0;
+    if (offset > length) offset = length;
+    // the byte before offset ends the previous line
+    size_t end = offset - 1;
+    size_t n = std::min(maxLine, end);
+    const char* p = bytes(end - n, n);
+    if (!p) return 0;
+    const char* nl = static_cast<const char*>(memrchr(p, '\n', n));
+    return nl ? end - n + (nl - p) + 1 : end - n;
+}
+
+LineView FileViewer::line(size_t offset) {
+    if (offset >= length) return LineView();
+    size_t n = std::min(maxLine, length - offset);
+    const char* p = bytes(offset, n);
+    if (!p) return LineView();
+    const char* nl = static_cast<const char*>(memchr(p, '\n', n));
+    return LineView(p, nl ? nl - p : n);
+}
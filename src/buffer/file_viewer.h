@@ -0,0 +1,57 @@
+#ifndef CP_EDITOR_FILE_VIEWER_H
+#define CP_EDITOR_FILE_VIEWER_H
+
+#include <cstddef>
+#include <string>
+
+#include "line_view.h"
+
+/**
+ * @brief read-only access to the lines of a file of any size
+ *
+ * Nothing is read or indexed when the file is opened. Only a window of the
+ * file around the bytes asked for is mapped, and it moves when bytes
+ * outside it are needed, so memory doesn't depend on the size of the file.
+ * Lines are addressed by the offset of their first byte. A line longer than
+ * maxLine bytes is cut into pieces of maxLine bytes, as if they were lines.
+ */
+class FileViewer {
+public:
+    explicit FileViewer(size_t windowSize = 16 << 20,
+                        size_t maxLine = 64 << 10);
+    ~FileViewer();
+
+    FileViewer(const FileViewer&) = delete;
+    FileViewer& operator=(const FileViewer&) = delete;
+
+    // false with errno set if the file can't be opened
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return fd != -1; }
+
+    size_t size() const { return length; }
+
+    // start of the line containing the byte at offset
+    size_t lineStart(size_t offset);
+    // start of the line after the one starting at offset, size() at the end
+    size_t nextLine(size_t offset);
+    // start of the line before the one starting at offset
+    size_t previousLine(size_t offset);
+    // the line starting at offset without its newline, valid until the next
+    // call of any method
+    LineView line(size_t offset);
+
+private:
+    // bytes [offset, offset + n) of the file, remapping the window if needed;
+    // nullptr if they can't be mapped
+    const char* bytes(size_t offset, size_t n);
+    void unmap();
+
+    int fd;
+    size_t length;
+    size_t windowSize, maxLine;
+    const char* addr;  // mapping of file bytes [windowBegin, windowEnd)
+    size_t windowBegin, windowEnd;
+};
+
+#endif  // CP_EDITOR_FILE_VIEWER_H
@@ -0,0 +1,97 @@
+#include "identifier_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+// bytes scanned between two looks at the stop flag
+static const size_t SCAN_CHUNK = 1 << 20;
+// entries looked at by a completion, so that a short prefix stays quick
+static const size_t COMPLETE_SCAN = 4096;
+
+void IdentifierIndex::update(LineView text, long delta) {
+    const char* p = text.begin();
+    const char* end = text.end();
+    std::string word;
+    while (p < end) {
+        if (!isWordChar(*p)) {
+            ++p;
+            continue;
+        }
+        const char* start = p;
+        while (p < end && isWordChar(*p)) ++p;
+        if (*start >= '0' && *start <= '9') continue;  // a number
+        if (p - start < 2) continue;  // nothing to complete
+        word.assign(start, p - start);
+        std::map<std::string, long>::iterator it =
+            counts.insert(std::make_pair(word, 0)).first;
+        it->second += delta;
+        if (it->second == 0) counts.erase(it);
+    }
+}
+
+bool IdentifierIndex::addSnapshot(const Snapshot& snapshot,
+                                  const std::atomic<bool>& stop) {
+    // runs of a snapshot hold whole lines, no identifier spans two of them
+    return snapshot.forEachRun([this, &stop](const char* data,
+                                             size_t size) -> bool {
+        while (size > 0) {
+            if (stop) return false;
+            size_t n = std::min(size, SCAN_CHUNK);
+            if (n < size) {
+                // cut after a line break, or take the run whole
+                const void* nl = memchr(data + n, '\n', size - n);
+                n = nl ? static_cast<const char*>(nl) - data + 1 : size;
+            }
+            add(LineView(data, n));
+            data += n;
+            size -= n;
+        }
+        return true;
+    });
+}
+
+void IdentifierIndex::merge(const IdentifierIndex& other) {
+    for (const std::pair<const std::string, long>& entry : other.counts) {
+        std::map<std::string, long>::iterator it =
+            counts.insert(std::make_pair(entry.first, 0)).first;
+        it->second += entry.second;
+        if (it->second == 0) counts.erase(it);
+    }
+}
+
+long IdentifierIndex::count(const std::string& word) const {
+    std::map<std::string, long>::const_iterator it = counts.find(word);
+    return it == counts.end() ? 0 : it->second;
+}
+
+size_t IdentifierIndex::size() const {
+    size_t n = 0;
+    for (const std::pair<const std::string, long>& entry : counts)
+        if (entry.second > 0) n++;
+    return n;
+}
+
+void IdentifierIndex::complete(LineView prefix, size_t limit,
+                               std::vector<std::string>& out) const {
+    out.clear();
+    std::string key = prefix.str();
+    std::vector<std::pair<long, const std::string*>> found;
+    std::map<std::string, long>::const_iterator it = counts.lower_bound(key);
+    for (size_t seen = 0; it != counts.end() && seen < COMPLETE_SCAN;
+         ++it, ++seen) {
+        if (it->first.compare(0, key.size(), key) != 0) break;
+        if (it->second > 0 && it->first.size() > key.size())
+            found.push_back(std::make_pair(-it->second, &it->first));
+    }
+    // the most frequent first, then in alphabetical order
+    size_t n = std::min(limit, found.size());
+    std::partial_sort(
+        found.begin(), found.begin() + n, found.end(),
+        [](const std::pair<long, const std::string*>& a,
+           const std::pair<long, const std::string*>& b) {
+            if (a.first != b.first) return a.first < b.first;
+            return *a.second < *b.second;
+        });
+    for (size_t i = 0; i < n; ++i) out.push_back(*found[i].second);
+}
@@ -0,0 +1,64 @@
+#ifndef CP_EDITOR_IDENTIFIER_INDEX_H
+#define CP_EDITOR_IDENTIFIER_INDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "line_view.h"
+#include "snapshot.h"
+
+/**
+ * @brief the identifiers of a text with the number of times they occur
+ *
+ * The identifiers are kept sorted, so the ones starting with a prefix are
+ * found in O(log n) whatever the size of the text. Lines are removed
+ * before they are edited and added back after, which costs the length of
+ * the lines. A count can drop below zero in an index of the edits made
+ * while the index of the text they were made to is built on another
+ * thread; merge() adds both up.
+ */
+class IdentifierIndex {
+public:
+    IdentifierIndex() {}
+
+    void clear() { counts.clear(); }
+    void add(LineView text) { update(text, 1); }
+    void remove(LineView text) { update(text, -1); }
+    /**
+     * @brief add the identifiers of snapshot
+     * @param stop checked now and then, the scan gives up once it is set
+     * @return false if it gave up
+     */
+    bool addSnapshot(const Snapshot& snapshot,
+                     const std::atomic<bool>& stop);
+    // add the counts of other
+    void merge(const IdentifierIndex& other);
+
+    long count(const std::string& word) const;
+    // identifiers with a positive count
+    size_t size() const;
+
+    /**
+     * @brief complete prefix
+     *
+     * @param out set to up to limit identifiers that are longer than prefix
+     * and start with it, the most frequent first
+     */
+    void complete(LineView prefix, size_t limit,
+                  std::vector<std::string>& out) const;
+
+    static bool isWordChar(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               (c >= '0' && c <= '9') || c == '_';
+    }
+
+private:
+    void update(LineView text, long delta);
+
+    std::map<std::string, long> counts;  // no zero counts
+};
+
+#endif  // CP_EDITOR_IDENTIFIER_INDEX_H
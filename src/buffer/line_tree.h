@@ -0,0 +1,278 @@
+#ifndef CP_EDITOR_LINE_TREE_H
+#define CP_EDITOR_LINE_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief a value for every line, summed up over subtrees
+ *
+ * The lines are the nodes of an implicit treap ordered by line number, the
+ * way the pieces of a TextBuffer are. Every node keeps the number of lines
+ * of its subtree and their values summed up, so setting a line or summing
+ * the lines before it costs O(log n), and inserting or erasing k lines
+ * costs O(k + log n) wherever they are, without moving the other lines.
+ * Indexes that walk down the sums to find a line get at the nodes through
+ * root(), left() and right().
+ *
+ * Traits gives the Value of a line and the Sum of a run of lines, where
+ * Sum() is the sum of no lines, and
+ *
+ *     static Sum sum(const Value& value);
+ *     static Sum combine(const Sum& before, const Sum& after);
+ *
+ * Nodes live in one vector and are referred to by their index there.
+ */
+template <typename Traits>
+class LineTree {
+public:
+    typedef typename Traits::Value Value;
+    typedef typename Traits::Sum Sum;
+    typedef uint32_t Ref;
+    static const Ref NIL = 0;  // no node, with no lines and a sum of Sum()
+
+    LineTree() : nodes(1), top(NIL), seed(2463534242u) {}
+
+    void clear() {
+        nodes.resize(1);
+        freed.clear();
+        top = NIL;
+    }
+
+    size_t size() const { return nodes[top].size; }
+    bool empty() const { return top == NIL; }
+
+    // n lines, line y holding valueOf(y)
+    template <typename F>
+    void assign(size_t n, F valueOf) {
+        clear();
+        nodes.reserve(n + 1);
+        top = build(n, valueOf);
+    }
+
+    const Value& operator[](size_t y) const {
+        Ref t = top;
+        while (true) {
+            const Node& n = nodes[t];
+            size_t leftSize = nodes[n.left].size;
+            if (y == leftSize) return n.value;
+            if (y < leftSize) {
+                t = n.left;
+            } else {
+                y -= leftSize + 1;
+                t = n.right;
+            }
+        }
+    }
+
+    void set(size_t y, const Value& value) { set(top, y, value); }
+
+    // n lines holding value before line y
+    void insert(size_t y, size_t n, const Value& value) {
+        if (n == 0) return;
+        Ref lines = build(n, [&value](size_t) { return value; });
+        Ref l, r;
+        split(top, y, l, r);
+        top = merge(merge(l, lines), r);
+    }
+
+    void push_back(const Value& value) { insert(size(), 1, value); }
+
+    // n lines after the last one, line size() + i holding valueOf(i)
+    template <typename F>
+    void append(size_t n, F valueOf) {
+        if (n == 0) return;
+        top = merge(top, build(n, valueOf));
+    }
+
+    // lines [y, y + n)
+    void erase(size_t y, size_t n) {
+        Ref l, m, r;
+        split(top, y, l, m);
+        split(m, n, m, r);
+        release(m);
+        top = merge(l, r);
+    }
+
+    Sum total() const { return nodes[top].sum; }
+    // sum of the lines before y
+    Sum prefix(size_t y) const {
+        Sum out = Sum();
+        Ref t = top;
+        while (t != NIL) {
+            const Node& n = nodes[t];
+            size_t leftSize = nodes[n.left].size;
+            if (y <= leftSize) {
+                t = n.left;
+                continue;
+            }
+            out = Traits::combine(
+                out, Traits::combine(nodes[n.left].sum, Traits::sum(n.value)));
+            y -= leftSize + 1;
+            t = n.right;
+        }
+        return out;
+    }
+
+    /**
+     * @brief change(y, value) may change the value of any line y of the
+     * subtrees whose sum visit(sum) is true for
+     *
+     * The other subtrees are skipped as a whole, so the cost depends on how
+     * many lines the sums leave to look at.
+     */
+    template <typename P, typename F>
+    void modify(P visit, F change) {
+        modify(top, 0, visit, change);
+    }
+
+    Ref root() const { return top; }
+    Ref left(Ref t) const { return nodes[t].left; }
+    Ref right(Ref t) const { return nodes[t].right; }
+    // lines of the subtree of t
+    size_t size(Ref t) const { return nodes[t].size; }
+    const Value& value(Ref t) const { return nodes[t].value; }
+    const Sum& sum(Ref t) const { return nodes[t].sum; }
+
+private:
+    struct Node {
+        Value value;
+        Sum sum;  // of the values of the subtree
+        uint32_t size;
+        uint32_t priority;
+        Ref left, right;
+    };
+
+    void update(Ref t) {
+        Node& n = nodes[t];
+        n.size = nodes[n.left].size + 1 + nodes[n.right].size;
+        n.sum = Traits::combine(
+            Traits::combine(nodes[n.left].sum, Traits::sum(n.value)),
+            nodes[n.right].sum);
+    }
+
+    Ref merge(Ref a, Ref b) {
+        if (a == NIL) return b;
+        if (b == NIL) return a;
+        if (nodes[a].priority > nodes[b].priority) {
+            Ref right = merge(nodes[a].right, b);
+            nodes[a].right = right;
+            update(a);
+            return a;
+        }
+        Ref left = merge(a, nodes[b].left);
+        nodes[b].left = left;
+        update(b);
+        return b;
+    }
+
+    // first k lines of t go to l, the rest to r
+    void split(Ref t, size_t k, Ref& l, Ref& r) {
+        if (t == NIL) {
+            l = r = NIL;
+            return;
+        }
+        Node& n = nodes[t];
+        size_t leftSize = nodes[n.left].size;
+        if (k <= leftSize) {
+            split(n.left, k, l, n.left);
+            r = t;
+        } else {
+            split(n.right, k - leftSize - 1, n.right, r);
+            l = t;
+        }
+        update(t);
+    }
+
+    void set(Ref t, size_t y, const Value& value) {
+        Node& n = nodes[t];
+        size_t leftSize = nodes[n.left].size;
+        if (y < leftSize)
+            set(n.left, y, value);
+        else if (y > leftSize)
+            set(n.right, y - leftSize - 1, value);
+        else
+            n.value = value;
+        update(t);
+    }
+
+    template <typename P, typename F>
+    void modify(Ref t, size_t base, P& visit, F& change) {
+        if (t == NIL || !visit(nodes[t].sum)) return;
+        size_t leftSize = nodes[nodes[t].left].size;
+        modify(nodes[t].left, base, visit, change);
+        change(base + leftSize, nodes[t].value);
+        modify(nodes[t].right, base + leftSize + 1, visit, change);
+        update(t);
+    }
+
+    // treap of n new lines in O(n), the way TextBuffer::rebuild() does it:
+    // every line takes the part of the right spine it has a higher priority
+    // than as its left child
+    template <typename F>
+    Ref build(size_t n, F valueOf) {
+        std::vector<Ref>& spine = scratch;
+        spine.clear();
+        for (size_t i = 0; i < n; ++i) {
+            Ref t = newNode(valueOf(i));
+            Ref below = NIL;
+            while (!spine.empty() &&
+                   nodes[spine.back()].priority < nodes[t].priority) {
+                below = spine.back();
+                update(below);  // its subtree is complete
+                spine.pop_back();
+            }
+            nodes[t].left = below;
+            if (!spine.empty()) nodes[spine.back()].right = t;
+            spine.push_back(t);
+        }
+        for (size_t i = spine.size(); i-- > 0;) update(spine[i]);
+        return spine.empty() ? NIL : spine[0];
+    }
+
+    Ref newNode(const Value& value) {
+        Ref t;
+        if (!freed.empty()) {
+            t = freed.back();
+            freed.pop_back();
+        } else {
+            t = static_cast<Ref>(nodes.size());
+            nodes.push_back(Node());
+        }
+        Node& n = nodes[t];
+        n.value = value;
+        n.sum = Traits::sum(value);
+        n.size = 1;
+        n.priority = nextPriority();
+        n.left = n.right = NIL;
+        return t;
+    }
+
+    void release(Ref t) {
+        while (t != NIL) {
+            release(nodes[t].left);
+            freed.push_back(t);
+            t = nodes[t].right;
+        }
+    }
+
+    uint32_t nextPriority() {
+        // xorshift32
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    std::vector<Node> nodes;  // nodes[NIL] stands for every missing child
+    std::vector<Ref> freed;   // nodes to reuse
+    std::vector<Ref> scratch;
+    Ref top;
+    uint32_t seed;  // state of xorshift generator for priorities
+};
+
+template <typename Traits>
+const typename LineTree<Traits>::Ref LineTree<Traits>::NIL;
+
+#endif  // CP_EDITOR_LINE_TREE_H
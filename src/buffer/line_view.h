@@ -0,0 +1,43 @@
+#ifndef CP_EDITOR_LINE_VIEW_H
+#define CP_EDITOR_LINE_VIEW_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief non-owning reference to the characters of one line
+ *
+ * Points either into a mapped file or into a line owned by a TextBuffer, so
+ * it is only valid until the buffer is modified.
+ */
+class LineView {
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    LineView() : ptr(nullptr), len(0) {}
+    LineView(const char* data, size_t size) : ptr(data), len(size) {}
+    LineView(const std::string& s) : ptr(s.data()), len(s.size()) {}
+    LineView(const char* s) : ptr(s), len(strlen(s)) {}
+
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    char operator[](size_t i) const { return ptr[i]; }
+
+    const char* begin() const { return ptr; }
+    const char* end() const { return ptr + len; }
+
+    LineView substr(size_t pos, size_t n = npos) const {
+        if (pos > len) pos = len;
+        if (n > len - pos) n = len - pos;
+        return LineView(ptr + pos, n);
+    }
+    std::string str() const { return std::string(ptr, len); }
+
+private:
+    const char* ptr;
+    size_t len;
+};
+
+#endif  // CP_EDITOR_LINE_VIEW_H
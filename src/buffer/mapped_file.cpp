@@ -0,0 +1,104 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include "search.h"
+
+namespace {
+// bytes scanned by a thread at a time when indexing
+const size_t INDEX_CHUNK = 4 << 20;
+}  // namespace
+
+MappedFile::MappedFile() : addr(nullptr), length(0), starts(1, 0) {}
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const std::string& path) {
+    if (!map(path)) return false;
+    indexLines();
+    return true;
+}
+
+bool MappedFile::map(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        return false;
+    }
+
+    // mmap() rejects zero length, an empty file simply has no mapping
+    if (st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            errno = err;
+            return false;
+        }
+        addr = static_cast<const char*>(p);
+        length = st.st_size;
+    }
+    ::close(fd);  // the mapping stays valid without the descriptor
+    return true;
+}
+
+void MappedFile::close() {
+    if (addr) munmap(const_cast<char*>(addr), length);
+    addr = nullptr;
+    length = 0;
+    starts.assign(1, 0);
+}
+
+void MappedFile::indexLines(unsigned threads, std::atomic<size_t>* progress) {
+    size_t chunks = (length + INDEX_CHUNK - 1) / INDEX_CHUNK;
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    threads = std::max<size_t>(1, std::min<size_t>(threads, chunks));
+
+    // each thread takes the next chunk until there are none left
+    std::vector<std::vector<size_t>> found(chunks);
+    std::atomic<size_t> next(0);
+    auto scan = [&]() {
+        for (size_t i; (i = next++) < chunks;) {
+            size_t begin = i * INDEX_CHUNK;
+            size_t end = std::min(length, begin + INDEX_CHUNK);
+            findLineStarts(addr + begin, end - begin, begin, found[i]);
+            if (progress) *progress += end - begin;
+        }
+    };
+    std::vector<std::thread> helpers;
+    for (unsigned t = 1; t < threads; ++t) helpers.emplace_back(scan);
+    scan();
+    for (std::thread& helper : helpers) helper.join();
+
+    size_t total = 1;
+    for (const std::vector<size_t>& f : found) total += f.size();
+    starts.clear();
+    starts.reserve(total + 1);
+    starts.push_back(0);
+    for (std::vector<size_t>& f : found) {
+        starts.insert(starts.end(), f.begin(), f.end());
+        std::vector<size_t>().swap(f);
+    }
+    // last line without a trailing newline
+    if (length > 0 && addr[length - 1] != '\n') starts.push_back(length + 1);
+}
+
+size_t MappedFile::lineOf(size_t offset) const {
+    return std::upper_bound(starts.begin(), starts.end(), offset) -
+           starts.begin() - 1;
+}
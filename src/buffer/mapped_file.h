@@ -0,0 +1,69 @@
+#ifndef CP_EDITOR_MAPPED_FILE_H
+#define CP_EDITOR_MAPPED_FILE_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "line_view.h"
+
+/**
+ * @brief read-only memory mapping of a file with an index of line starts
+ *
+ * The file contents are never copied; lines are handed out as views into
+ * the mapping. Mapping and indexing can be done apart, so that a big file
+ * is indexed in the background.
+ */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief map the file at path and index its lines
+     * @return false with errno set if the file can't be opened or mapped
+     */
+    bool open(const std::string& path);
+    // like open(), but lines can't be used until indexLines() returns
+    bool map(const std::string& path);
+    void close();
+
+    /**
+     * @brief find where every line starts
+     *
+     * The file is cut into chunks that up to threads threads (by default one
+     * per core) scan for newlines at the same time, and the offsets found
+     * in each chunk are then appended in order. If progress is given, the
+     * size of each chunk is added to it once it is scanned, so that another
+     * thread can tell how far the indexing is.
+     */
+    void indexLines(unsigned threads = 0,
+                    std::atomic<size_t>* progress = nullptr);
+
+    const char* data() const { return addr; }
+    size_t size() const { return length; }
+
+    size_t lineCount() const { return starts.size() - 1; }
+    // offset of line i, lineStart(lineCount()) is one past the last newline
+    size_t lineStart(size_t i) const { return starts[i]; }
+    // line containing the byte at offset
+    size_t lineOf(size_t offset) const;
+    // i-th line without its trailing newline
+    LineView line(size_t i) const {
+        return LineView(addr + starts[i], starts[i + 1] - starts[i] - 1);
+    }
+
+private:
+
+    const char* addr;
+    size_t length;
+    // starts[i] is the offset of line i. The last entry is one past the
+    // newline ending the last line (or where that newline would be).
+    std::vector<size_t> starts;
+};
+
+#endif  // CP_EDITOR_MAPPED_FILE_H
@@ -0,0 +1,61 @@
+#include "render_cache.h"
+
+#include <utility>
+
+RenderCache::RenderCache(size_t capacity) { reset(capacity); }
+
+void RenderCache::reset(size_t capacity) {
+    slots.assign(capacity, Slot{EMPTY, RenderedLine()});
+}
+
+void RenderCache::clear() {
+    for (auto& slot : slots) slot.line = EMPTY;
+}
+
+const RenderedLine* RenderCache::find(size_t y) const {
+    if (slots.empty()) return nullptr;
+    const Slot& slot = slots[y % slots.size()];
+    return slot.line == y ? &slot.render : nullptr;
+}
+
+RenderedLine* RenderCache::find(size_t y) {
+    const RenderCache* self = this;
+    return const_cast<RenderedLine*>(self->find(y));
+}
+
+RenderedLine& RenderCache::put(size_t y) {
+    if (slots.empty()) reset(1);
+    Slot& slot = slots[y % slots.size()];
+    slot.line = y;
+    return slot.render;
+}
+
+void RenderCache::invalidate(size_t y) {
+    if (slots.empty()) return;
+    Slot& slot = slots[y % slots.size()];
+    if (slot.line == y) slot.line = EMPTY;
+}
+
+void RenderCache::insertLines(size_t y, size_t n) {
+    if (n > 0) shift(y, static_cast<long>(n));
+}
+
+void RenderCache::eraseLines(size_t y, size_t n) {
+    if (n == 0) return;
+    for (auto& slot : slots)
+        if (slot.line != EMPTY && slot.line >= y && slot.line < y + n)
+            slot.line = EMPTY;
+    shift(y + n, -static_cast<long>(n));
+}
+
+void RenderCache::shift(size_t y, long delta) {
+    // take out the entries that move, then put them into their new slots
+    std::vector<Slot> moved;
+    for (auto& slot : slots) {
+        if (slot.line != EMPTY && slot.line >= y) {
+            moved.push_back(Slot{slot.line + delta, std::move(slot.render)});
+            slot.line = EMPTY;
+        }
+    }
+    for (auto& slot : moved) put(slot.line) = std::move(slot.render);
+}
@@ -0,0 +1,66 @@
+#ifndef CP_EDITOR_RENDER_CACHE_H
+#define CP_EDITOR_RENDER_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "column_index.h"
+
+struct RenderedLine {
+    std::string text;     // what is drawn on the screen
+    ColumnIndex columns;  // maps line columns to text columns
+    // syntax class of every column of text, if highlighted is set
+    std::vector<unsigned char> highlight;
+    bool highlighted;
+    uint32_t syntaxState;  // lexer state the highlight started from
+
+    RenderedLine() : highlighted(false), syntaxState(0) {}
+};
+
+/**
+ * @brief bounded cache of rendered lines keyed by line number
+ *
+ * The cache is direct mapped: line y can only live in slot y % capacity. As
+ * long as the capacity is at least the number of screen rows, the rows of
+ * one frame never evict each other, and memory depends on the screen size
+ * only.
+ */
+class RenderCache {
+public:
+    explicit RenderCache(size_t capacity = 0);
+
+    size_t capacity() const { return slots.size(); }
+    // resize the cache, dropping every entry
+    void reset(size_t capacity);
+    void clear();
+
+    // rendered line y, or nullptr if it isn't cached
+    const RenderedLine* find(size_t y) const;
+    RenderedLine* find(size_t y);
+    // slot for line y, evicting the line cached there; the caller fills it
+    RenderedLine& put(size_t y);
+
+    // line y was modified
+    void invalidate(size_t y);
+    // n lines were inserted before line y
+    void insertLines(size_t y, size_t n);
+    // lines [y, y + n) were erased
+    void eraseLines(size_t y, size_t n);
+
+private:
+    static const size_t EMPTY = static_cast<size_t>(-1);
+
+    struct Slot {
+        size_t line;  // EMPTY if the slot is unused
+        RenderedLine render;
+    };
+
+    // renumber the cached lines after line y by delta
+    void shift(size_t y, long delta);
+
+    std::vector<Slot> slots;
+};
+
+#endif  // CP_EDITOR_RENDER_CACHE_H
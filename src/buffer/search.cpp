@@ -0,0 +1,121 @@
+#include "search.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const char* findFirstScalar(const char* data, size_t size, LineView needle) {
+    if (size < needle.size()) return nullptr;  // no room to start in
+    const char* end = data + size - needle.size() + 1;  // past last start
+    const char* p = data;
+    while (p < end) {
+        p = static_cast<const char*>(memchr(p, needle[0], end - p));
+        if (!p) return nullptr;
+        if (memcmp(p + 1, needle.data() + 1, needle.size() - 1) == 0) return p;
+        p++;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+const char* findFirst(const char* data, size_t size, LineView needle) {
+    size_t m = needle.size();
+    if (m == 0 || size < m) return nullptr;
+    if (m == 1)
+        return static_cast<const char*>(memchr(data, needle[0], size));
+
+    const char* p = data;
+#if defined(__SSE2__)
+    // test 16 starting positions at once: both the first and the last byte
+    // of the needle have to match before the rest is compared
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    for (; p + 16 + m - 1 <= data + size; p += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + m - 1));
+        unsigned mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            int i = __builtin_ctz(mask);
+            if (memcmp(p + i + 1, needle.data() + 1, m - 2) == 0) return p + i;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    return findFirstScalar(p, data + size - p, needle);
+}
+
+const char* findLast(const char* data, size_t size, LineView needle) {
+    size_t m = needle.size();
+    if (m == 0 || size < m) return nullptr;
+
+    size_t n = size - m + 1;  // starts [0, n) are left to test
+#if defined(__SSE2__)
+    // the 16 starts before n at once, from the back, the same way as
+    // findFirst()
+    if (m > 1) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[m - 1]);
+        for (; n >= 16; n -= 16) {
+            const char* p = data + n - 16;
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i b =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + m - 1));
+            unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+            while (mask) {
+                int i = 31 - __builtin_clz(mask);
+                if (memcmp(p + i + 1, needle.data() + 1, m - 2) == 0)
+                    return p + i;
+                mask &= ~(1u << i);
+            }
+        }
+    }
+#endif
+    // candidates are the positions of the first byte, from the back
+    while (n > 0) {
+        const char* p =
+            static_cast<const char*>(memrchr(data, needle[0], n));
+        if (!p) return nullptr;
+        if (memcmp(p + 1, needle.data() + 1, m - 1) == 0) return p;
+        n = p - data;
+    }
+    return nullptr;
+}
+
+void findLineStarts(const char* data, size_t size, size_t base,
+                    std::vector<size_t>& starts) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 64 <= size; i += 64) {
+        const __m128i* p = reinterpret_cast<const __m128i*>(data + i);
+        uint64_t mask =
+            static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_loadu_si128(p), nl))) |
+            static_cast<uint64_t>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_loadu_si128(p + 1), nl))) << 16 |
+            static_cast<uint64_t>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_loadu_si128(p + 2), nl))) << 32 |
+            static_cast<uint64_t>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_loadu_si128(p + 3), nl))) << 48;
+        while (mask) {
+            starts.push_back(base + i + __builtin_ctzll(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    const char* end = data + size;
+    for (const char* p = data + i; p < end; ++p) {
+        p = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!p) break;
+        starts.push_back(base + (p - data) + 1);
+    }
+}
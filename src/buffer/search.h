@@ -0,0 +1,28 @@
+#ifndef CP_EDITOR_SEARCH_H
+#define CP_EDITOR_SEARCH_H
+
+#include <cstddef>
+#include <vector>
+
+#include "line_view.h"
+
+/**
+ * @brief substring search over raw bytes
+ *
+ * Candidates are found by a fast filter on the first (and, with SSE2, the
+ * last) byte of the needle and are then verified with memcmp; findLast()
+ * runs the same filter from the back. Both return nullptr if there is no
+ * match or the needle is empty.
+ */
+
+// first occurrence of needle that lies within [data, data + size)
+const char* findFirst(const char* data, size_t size, LineView needle);
+// last occurrence of needle that lies within [data, data + size)
+const char* findLast(const char* data, size_t size, LineView needle);
+
+// append base + i + 1 to starts for every newline data[i], in order; with
+// SSE2 64 bytes are tested at a time, which beats a memchr() per line
+void findLineStarts(const char* data, size_t size, size_t base,
+                    std::vector<size_t>& starts);
+
+#endif  // CP_EDITOR_SEARCH_H
@@ -0,0 +1,131 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <string>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+Snapshot::Snapshot(std::shared_ptr<const MappedFile> source)
+    : source(source), length(0) {}
+
+void Snapshot::addSource(size_t begin, size_t end) {
+    if (begin == end) return;
+    if (!segments.empty() && !segments.back().copied &&
+        segments.back().offset + segments.back().size == begin) {
+        segments.back().size += end - begin;
+    } else {
+        segments.push_back(Segment{false, begin, end - begin});
+    }
+    length += end - begin;
+}
+
+void Snapshot::addText(LineView line) {
+    if (line.empty()) return;
+    if (!segments.empty() && segments.back().copied) {
+        segments.back().size += line.size();
+    } else {
+        segments.push_back(Segment{true, text.size(), line.size()});
+    }
+    text.append(line.data(), line.size());
+    length += line.size();
+}
+
+bool Snapshot::writeTo(int fd) const {
+    std::vector<struct iovec> iov;
+    size_t next = 0;  // first segment not queued in iov yet
+    while (next < segments.size() || !iov.empty()) {
+        while (next < segments.size() && iov.size() < IOV_MAX) {
+            const Segment& seg = segments[next++];
+            const char* base = seg.copied ? text.data() : source->data();
+            struct iovec v;
+            v.iov_base = const_cast<char*>(base + seg.offset);
+            v.iov_len = seg.size;
+            iov.push_back(v);
+        }
+
+        ssize_t n = writev(fd, iov.data(), iov.size());
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        // drop what went out, a short write leaves part of an entry
+        size_t written = n;
+        size_t i = 0;
+        while (i < iov.size() && written >= iov[i].iov_len)
+            written -= iov[i++].iov_len;
+        iov.erase(iov.begin(), iov.begin() + i);
+        if (written > 0) {
+            iov[0].iov_base = static_cast<char*>(iov[0].iov_base) + written;
+            iov[0].iov_len -= written;
+        }
+    }
+    return true;
+}
+
+uint64_t Snapshot::hash(uint64_t h) const {
+    forEachRun([&h](const char* data, size_t size) -> bool {
+        h = hashBytes(data, size, h);
+        return true;
+    });
+    return h;
+}
+
+uint64_t hashBytes(const char* data, size_t n, uint64_t h) {
+    for (size_t i = 0; i < n; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ull;  // FNV prime
+    }
+    return h;
+}
+
+// a new file next to path, named in tmp; unlike mkstemp(), which makes it
+// 0600, it gets 0666 less the umask like any other new file
+static int createTemporary(const std::string& path, std::string& tmp) {
+    static std::atomic<unsigned> counter(0);
+    for (int tries = 0; tries < 100; ++tries) {
+        tmp = path + "." + std::to_string(getpid()) + "." +
+              std::to_string(counter++) + ".tmp";
+        int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                      0666);
+        if (fd != -1 || errno != EEXIST) return fd;
+    }
+    return -1;
+}
+
+bool saveAtomically(const Snapshot& snapshot, const std::string& path) {
+    std::string tmp;
+    int fd = createTemporary(path, tmp);
+    if (fd == -1) return false;
+
+    // keep the permissions of the file we replace
+    struct stat st;
+    bool replacing = stat(path.c_str(), &st) == 0;
+
+    bool ok = (!replacing || fchmod(fd, st.st_mode & 07777) == 0) &&
+              snapshot.writeTo(fd) && fsync(fd) == 0;
+    int err = errno;
+    if (close(fd) == -1 && ok) {
+        ok = false;
+        err = errno;
+    }
+    if (ok && rename(tmp.c_str(), path.c_str()) == -1) {
+        ok = false;
+        err = errno;
+    }
+    if (!ok) {
+        unlink(tmp.c_str());
+        errno = err;
+    }
+    return ok;
+}
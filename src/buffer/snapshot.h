@@ -0,0 +1,77 @@
+#ifndef CP_EDITOR_SNAPSHOT_H
+#define CP_EDITOR_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "line_view.h"
+#include "mapped_file.h"
+
+const uint64_t HASH_SEED = 14695981039346656037ull;  // FNV offset basis
+
+/**
+ * @brief frozen copy of the contents of a TextBuffer
+ *
+ * Untouched lines are referenced as byte ranges of the mapped source file,
+ * which never changes, and only edited text is copied. A snapshot can
+ * therefore be taken cheaply on the UI thread and written out from
+ * another one while the buffer keeps being edited.
+ */
+class Snapshot {
+public:
+    explicit Snapshot(std::shared_ptr<const MappedFile> source = nullptr);
+
+    // bytes [begin, end) of the source file
+    void addSource(size_t begin, size_t end);
+    void addText(LineView text);
+
+    size_t size() const { return length; }
+
+    // write the whole snapshot to fd, false with errno set on failure
+    bool writeTo(int fd) const;
+    // hash of the contents, see hashBytes()
+    uint64_t hash(uint64_t h = HASH_SEED) const;
+    /**
+     * @brief call f(data, size) on the runs of bytes of the contents, in
+     * order; a run holds whole lines
+     * @return false if f returned false to stop early
+     */
+    template <typename F>
+    bool forEachRun(F f) const {
+        for (const Segment& seg : segments) {
+            const char* base = seg.copied ? text.data() : source->data();
+            if (!f(base + seg.offset, seg.size)) return false;
+        }
+        return true;
+    }
+
+private:
+    struct Segment {
+        bool copied;  // in text, otherwise in the source
+        size_t offset;
+        size_t size;
+    };
+
+    std::shared_ptr<const MappedFile> source;
+    std::string text;  // copied contents of edited lines
+    std::vector<Segment> segments;
+    size_t length;
+};
+
+// FNV-1a of n bytes at data continuing from h, chain calls to hash
+// several pieces as one
+uint64_t hashBytes(const char* data, size_t n, uint64_t h = HASH_SEED);
+
+/**
+ * @brief replace the file at path by the snapshot
+ *
+ * The data goes to a temporary file next to path, which is synced and
+ * renamed over path, so a crash never leaves a half written file.
+ * @return false with errno set on failure
+ */
+bool saveAtomically(const Snapshot& snapshot, const std::string& path);
+
+#endif  // CP_EDITOR_SNAPSHOT_H
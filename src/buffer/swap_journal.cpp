@@ -0,0 +1,367 @@
+#include "swap_journal.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "mapped_file.h"
+#include "snapshot.h"
+
+static const char MAGIC[] = "CPSWAP1\n";
+static const size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+static const size_t CHECK_SIZE = 4;
+
+// operations of the records
+static const char OP_INSERT = 'i';
+static const char OP_ERASE = 'e';
+static const char OP_REPLACE = 'r';
+
+static void putVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+static bool getVarint(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char c = *p++;
+        v |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+// end the record that starts at out[from] with the checksum of its bytes
+static void putCheck(std::string& out, size_t from) {
+    uint32_t check = static_cast<uint32_t>(
+        hashBytes(out.data() + from, out.size() - from));
+    out.append(reinterpret_cast<const char*>(&check), CHECK_SIZE);
+}
+
+// the bytes [begin, p) are followed by their checksum, which is skipped
+static bool getCheck(const char* begin, const char*& p, const char* end) {
+    if (end - p < static_cast<ptrdiff_t>(CHECK_SIZE)) return false;
+    uint32_t check = static_cast<uint32_t>(hashBytes(begin, p - begin));
+    bool ok = memcmp(&check, p, CHECK_SIZE) == 0;
+    p += CHECK_SIZE;
+    return ok;
+}
+
+// path opened for appending, created if missing, and locked; -1 with errno
+// set on failure
+static int openLocked(const std::string& path, int flags) {
+    int fd = open(path.c_str(), flags | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd == -1) return -1;
+    if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+static std::string encodeHeader(const SwapJournal::Base& base) {
+    std::string out(MAGIC, MAGIC_SIZE);
+    putVarint(out, base.exists);
+    putVarint(out, base.size);
+    putVarint(out, base.mtimeSec);
+    putVarint(out, base.mtimeNsec);
+    putCheck(out, 0);
+    return out;
+}
+
+SwapJournal::Base SwapJournal::baseOf(const std::string& path) {
+    Base base = Base{false, 0, 0, 0};
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        base.exists = true;
+        base.size = st.st_size;
+        base.mtimeSec = st.st_mtim.tv_sec;
+        base.mtimeNsec = st.st_mtim.tv_nsec;
+    }
+    return base;
+}
+
+std::string SwapJournal::pathFor(const std::string& file) {
+    size_t slash = file.rfind('/');
+    size_t name = slash == std::string::npos ? 0 : slash + 1;
+    return file.substr(0, name) + "." + file.substr(name) + ".cpswp";
+}
+
+SwapJournal::SwapJournal()
+    : origin(Base{false, 0, 0, 0}),
+      fd(-1),
+      started(false),
+      checkpointed(false) {}
+
+SwapJournal::~SwapJournal() { detach(); }
+
+bool SwapJournal::attach(const std::string& path, const Base& base) {
+    detach();
+    fd = openLocked(path, O_WRONLY);
+    if (fd == -1) return false;
+    file = path;
+    origin = base;
+    return true;
+}
+
+void SwapJournal::detach() {
+    // a journal nothing was written to isn't left behind
+    struct stat st;
+    if (fd != -1 && !started && fstat(fd, &st) == 0 && st.st_size == 0)
+        unlink(file.c_str());
+    close();
+    file.clear();
+    queue.clear();
+    started = false;
+    checkpointed = false;
+    sinceCheckpoint.clear();
+}
+
+void SwapJournal::remove() {
+    if (attached()) unlink(file.c_str());
+    close();
+    detach();
+}
+
+bool SwapJournal::resume(size_t length) {
+    if (ftruncate(fd, length) == -1) return false;
+    started = true;
+    return true;
+}
+
+bool SwapJournal::setAside(std::string& kept) {
+    int err;
+    // link() fails rather than replace a journal set aside before
+    for (unsigned n = 1;; ++n) {
+        kept = file + ".old." + std::to_string(n);
+        if (link(file.c_str(), kept.c_str()) == 0) break;
+        if (errno != EEXIST) {
+            err = errno;
+            detach();
+            errno = err;
+            return false;
+        }
+    }
+    // the new journal mustn't be the same file as the kept one
+    if (unlink(file.c_str()) == -1) {
+        err = errno;
+        unlink(kept.c_str());
+        detach();
+        errno = err;
+        return false;
+    }
+    std::string path = file;
+    Base base = origin;
+    close();
+    return attach(path, base);
+}
+
+void SwapJournal::recordInsert(size_t y, size_t x, LineView text) {
+    record(OP_INSERT, y, x, text.size(), text);
+}
+
+void SwapJournal::recordErase(size_t y, size_t x, size_t n) {
+    record(OP_ERASE, y, x, n, LineView());
+}
+
+void SwapJournal::recordReplace(const std::vector<TextPosition>& at,
+                                size_t n, LineView with) {
+    if (!attached() || at.empty()) return;
+    // the header says how many positions follow the text, each as the lines
+    // from the one before and the columns from the end of the one before
+    size_t from = queue.size();
+    queue += OP_REPLACE;
+    putVarint(queue, at.size());
+    putVarint(queue, n);
+    putVarint(queue, with.size());
+    queue.append(with.data(), with.size());
+    size_t y = 0, x = 0;
+    for (const TextPosition& pos : at) {
+        if (pos.y != y) x = 0;
+        putVarint(queue, pos.y - y);
+        putVarint(queue, pos.x - x);
+        y = pos.y;
+        x = pos.x + n;
+    }
+    putCheck(queue, from);
+    if (checkpointed) sinceCheckpoint.append(queue, from, std::string::npos);
+}
+
+// the positions of a replacement record, which has count of them
+static bool getPositions(const char*& p, const char* end, uint64_t count,
+                         uint64_t n, std::vector<TextPosition>& at) {
+    at.clear();
+    uint64_t y = 0, x = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t dy, dx;
+        if (!getVarint(p, end, dy) || !getVarint(p, end, dx)) return false;
+        if (dy > 0) x = 0;
+        y += dy;
+        x += dx;
+        at.push_back(TextPosition{y, x});
+        x += n;
+    }
+    return true;
+}
+
+void SwapJournal::record(char op, size_t y, size_t x, size_t n,
+                         LineView text) {
+    if (!attached()) return;
+    size_t from = queue.size();
+    queue += op;
+    putVarint(queue, y);
+    putVarint(queue, x);
+    putVarint(queue, n);
+    queue.append(text.data(), text.size());
+    putCheck(queue, from);
+    if (checkpointed) sinceCheckpoint.append(queue, from, std::string::npos);
+}
+
+bool SwapJournal::flush() {
+    if (queue.empty()) return true;
+    if (!started && !create()) return false;
+    size_t done = 0;
+    while (done < queue.size()) {
+        ssize_t n = write(fd, queue.data() + done, queue.size() - done);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            // what was written stays, the rest goes with the next flush
+            queue.erase(0, done);
+            return false;
+        }
+        done += n;
+    }
+    queue.clear();
+    return true;
+}
+
+void SwapJournal::checkpoint() {
+    checkpointed = attached();
+    sinceCheckpoint.clear();
+}
+
+bool SwapJournal::rebase(const Base& base) {
+    if (!attached()) return true;
+    origin = base;
+    checkpointed = false;
+    queue.swap(sinceCheckpoint);
+    sinceCheckpoint.clear();
+    if (!started && queue.empty()) return true;  // nothing to keep
+
+    // the new journal replaces the old one in one go, and is locked before
+    // anyone can open it
+    std::string tmp = file + ".new";
+    int out = openLocked(tmp, O_WRONLY | O_TRUNC);
+    if (out == -1) return false;
+    std::string header = encodeHeader(origin);
+    bool ok = write(out, header.data(), header.size()) ==
+              static_cast<ssize_t>(header.size());
+    if (ok && rename(tmp.c_str(), file.c_str()) == -1) ok = false;
+    if (!ok) {
+        int err = errno;
+        ::close(out);
+        unlink(tmp.c_str());
+        errno = err;
+        return false;
+    }
+    close();
+    fd = out;
+    return flush();  // the edits made since the checkpoint
+}
+
+// the lock is kept, the file is emptied and gets the header
+bool SwapJournal::create() {
+    if (ftruncate(fd, 0) == -1) return false;
+    std::string header = encodeHeader(origin);
+    if (write(fd, header.data(), header.size()) !=
+        static_cast<ssize_t>(header.size()))
+        return false;
+    started = true;
+    return true;
+}
+
+void SwapJournal::close() {
+    if (fd == -1) return;
+    ::close(fd);
+    fd = -1;
+}
+
+SwapJournal::Recovery SwapJournal::replay(const std::string& path,
+                                          const Base& base,
+                                          TextBuffer& buffer, size_t& edits,
+                                          size_t& length) {
+    edits = length = 0;
+    MappedFile journal;
+    if (!journal.map(path)) return NOTHING;
+
+    const char* begin = journal.data();
+    const char* end = begin + journal.size();
+    const char* p = begin;
+    uint64_t exists, size, sec, nsec;
+    if (journal.size() == 0) return NOTHING;
+    // what doesn't start like a journal, even one cut short, isn't ours
+    if (memcmp(p, MAGIC, std::min(journal.size(), MAGIC_SIZE)) != 0)
+        return FOREIGN;
+    if (journal.size() < MAGIC_SIZE) return OTHER_BASE;
+    p += MAGIC_SIZE;
+    if (!getVarint(p, end, exists) || !getVarint(p, end, size) ||
+        !getVarint(p, end, sec) || !getVarint(p, end, nsec) ||
+        !getCheck(begin, p, end))
+        return OTHER_BASE;
+    Base made = Base{exists != 0, size, static_cast<int64_t>(sec),
+                     static_cast<int64_t>(nsec)};
+    if (made != base) return OTHER_BASE;
+    length = p - begin;
+
+    std::vector<TextPosition> at;  // of a replacement
+    while (p < end) {
+        const char* record = p;
+        char op = *p++;
+        uint64_t y, x, n;
+        if (!getVarint(p, end, y) || !getVarint(p, end, x) ||
+            !getVarint(p, end, n))
+            break;
+        const char* text = p;
+        if (op == OP_INSERT || op == OP_REPLACE) {
+            if (static_cast<uint64_t>(end - p) < n) break;
+            p += n;
+        }
+        // a replacement has y positions, of x characters each, after it
+        if (op == OP_REPLACE && !getPositions(p, end, y, x, at)) break;
+        if (!getCheck(record, p, end)) break;  // cut short by a crash
+
+        // the edits were made to this very text, they can only fail if the
+        // journal is damaged in a way the checksums missed
+        try {
+            if (op == OP_REPLACE) {
+                buffer.replaceAll(at, x, LineView(text, n));
+            } else {
+                if (y == buffer.lineCount()) buffer.appendLine("");
+                if (x > buffer.line(y).size()) break;
+                if (op == OP_INSERT)
+                    buffer.insertText(y, x, std::string(text, n));
+                else if (op == OP_ERASE)
+                    buffer.eraseText(y, x, n);
+                else
+                    break;
+            }
+        } catch (const std::logic_error&) {
+            break;  // out of range, or positions out of order
+        }
+        edits++;
+        length = p - begin;
+    }
+    return RECOVERED;
+}
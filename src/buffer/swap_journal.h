@@ -0,0 +1,144 @@
+#ifndef CP_EDITOR_SWAP_JOURNAL_H
+#define CP_EDITOR_SWAP_JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "line_view.h"
+#include "text_position.h"
+
+/**
+ * @brief append-only file of the edits made to a buffer since its file was
+ * last saved
+ *
+ * Every insertion and erasure is encoded in a few bytes and queued, and
+ * flush() appends the queue with one write(), so keeping the edits safe
+ * costs the size of the edits and not the size of the file. Once flush()
+ * returns the edits are with the kernel and survive the editor crashing.
+ *
+ * The journal starts with the size and modification time of the file the
+ * edits apply to, and each record ends with a checksum. replay() applies
+ * the edits to a buffer loaded from that same file and stops at the first
+ * record that a crash left incomplete. After a save, rebase() makes the
+ * saved file the new starting point.
+ *
+ * An attached journal is kept locked with flock(), so a second editor of the
+ * same file neither replays nor overwrites the edits of the first one.
+ */
+class SwapJournal {
+public:
+    // what identifies the version of a file the edits were made to
+    struct Base {
+        bool exists;
+        uint64_t size;
+        int64_t mtimeSec, mtimeNsec;
+
+        bool operator==(const Base& b) const {
+            return exists == b.exists && size == b.size &&
+                   mtimeSec == b.mtimeSec && mtimeNsec == b.mtimeNsec;
+        }
+        bool operator!=(const Base& b) const { return !(*this == b); }
+    };
+
+    enum Recovery {
+        NOTHING,     // there is no journal, or an empty one
+        FOREIGN,     // the file isn't a journal, it is to be left alone
+        OTHER_BASE,  // the journal is for another version of the file
+        RECOVERED,
+    };
+
+    // the file at path as it is now
+    static Base baseOf(const std::string& path);
+    // journal of file: .name.cpswp in the same directory
+    static std::string pathFor(const std::string& file);
+
+    SwapJournal();
+    // closes the journal, which stays on disk unless it is empty
+    ~SwapJournal();
+
+    SwapJournal(const SwapJournal&) = delete;
+    SwapJournal& operator=(const SwapJournal&) = delete;
+
+    /**
+     * @brief journal the edits made to base at path, which is replaced on
+     * the first flush
+     *
+     * The file is created if it is missing, and locked.
+     * @return false with errno set on failure, EWOULDBLOCK when another
+     * editor holds the lock
+     */
+    bool attach(const std::string& path, const Base& base);
+    // stop journaling, the file stays unless it is empty
+    void detach();
+    // stop journaling and delete the file
+    void remove();
+    bool attached() const { return !file.empty(); }
+    const std::string& path() const { return file; }
+    const Base& base() const { return origin; }
+
+    /**
+     * @brief append to the journal replay() read, instead of replacing it
+     * @param length the bytes of it that were valid, the rest is cut
+     * @return false with errno set on failure
+     */
+    bool resume(size_t length);
+    /**
+     * @brief keep the journal as the first free path.old.N and journal to a
+     * new one
+     * @param kept set to the name it is kept as
+     * @return false with errno set on failure, the journal is detached then
+     */
+    bool setAside(std::string& kept);
+
+    void recordInsert(size_t y, size_t x, LineView text);
+    // n characters were erased from (y, x), a line break counts as one
+    void recordErase(size_t y, size_t x, size_t n);
+    // the n characters at each position of at were replaced by with, see
+    // TextBuffer::replaceAll()
+    void recordReplace(const std::vector<TextPosition>& at, size_t n,
+                       LineView with);
+    // write the edits recorded since the last flush, false with errno set
+    bool flush();
+    // bytes recorded and not flushed yet
+    size_t pending() const { return queue.size(); }
+
+    // a snapshot of the buffer is being saved
+    void checkpoint();
+    /**
+     * @brief the snapshot of the last checkpoint() was saved as base
+     *
+     * The journal is rewritten to only hold the edits made since, which are
+     * kept in memory meanwhile.
+     * @return false with errno set on failure
+     */
+    bool rebase(const Base& base);
+
+    /**
+     * @brief apply the edits of the journal at path to buffer
+     * @param base the file buffer was loaded from
+     * @param edits set to the number of edits applied
+     * @param length set to the bytes of the journal that could be read
+     */
+    static Recovery replay(const std::string& path, const Base& base,
+                           TextBuffer& buffer, size_t& edits,
+                           size_t& length);
+
+private:
+    void record(char op, size_t y, size_t x, size_t n, LineView text);
+    // the journal file with its header, false with errno set
+    bool create();
+    void close();
+
+    std::string file;  // empty when detached
+    Base origin;
+    int fd;             // of the locked file, -1 when detached
+    bool started;       // the file has the header of origin
+    std::string queue;  // records not written yet
+    bool checkpointed;
+    std::string sinceCheckpoint;  // records since checkpoint()
+};
+
+#endif  // CP_EDITOR_SWAP_JOURNAL_H
@@ -0,0 +1,374 @@
+#include "syntax.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "search.h"
+
+namespace {
+
+// what a line leaves open for the next one
+enum Mode {
+    NORMAL,
+    BLOCK_COMMENT,
+    LINE_COMMENT,  // continued with a backslash
+    STRING,        // continued with a backslash
+    RAW_STRING,    // the delimiter is stored above the mode
+    PREPROCESSOR,  // continued with a backslash
+};
+
+const size_t NONE = static_cast<size_t>(-1);
+const size_t MAX_DELIMITER = 16;  // longest raw string delimiter
+
+// sorted, for binary search
+const char* const KEYWORDS[] = {
+    "alignas",      "alignof",   "asm",          "auto",
+    "break",        "case",      "catch",        "class",
+    "const",        "const_cast", "constexpr",   "continue",
+    "decltype",     "default",   "delete",       "do",
+    "dynamic_cast", "else",      "enum",         "explicit",
+    "export",       "extern",    "false",        "for",
+    "friend",       "goto",      "if",           "inline",
+    "mutable",      "namespace", "new",          "noexcept",
+    "nullptr",      "operator",  "private",      "protected",
+    "public",       "register",  "reinterpret_cast", "return",
+    "sizeof",       "static",    "static_assert", "static_cast",
+    "struct",       "switch",    "template",     "this",
+    "thread_local", "throw",     "true",         "try",
+    "typedef",      "typeid",    "typename",     "union",
+    "using",        "virtual",   "volatile",     "while",
+};
+
+const char* const TYPES[] = {
+    "bool",     "char",     "char16_t", "char32_t",  "double",
+    "float",    "int",      "int16_t",  "int32_t",   "int64_t",
+    "int8_t",   "long",     "ptrdiff_t", "short",    "signed",
+    "size_t",   "uint16_t", "uint32_t", "uint64_t",  "uint8_t",
+    "unsigned", "void",     "wchar_t",
+};
+
+const char* const RAW_PREFIXES[] = {"LR", "R", "UR", "u8R", "uR"};
+
+int compare(const char* word, LineView text) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (word[i] == '\0') return -1;
+        if (word[i] != text[i])
+            return static_cast<unsigned char>(word[i]) -
+                   static_cast<unsigned char>(text[i]);
+    }
+    return word[text.size()] == '\0' ? 0 : 1;
+}
+
+template <size_t N>
+bool contains(const char* const (&words)[N], LineView text) {
+    const char* const* it = std::lower_bound(
+        words, words + N, text,
+        [](const char* word, LineView text) {
+            return compare(word, text) < 0;
+        });
+    return it != words + N && compare(*it, text) == 0;
+}
+
+bool isIdentifier(char c) {
+    return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// column of the first occurrence of pattern in line from column i
+size_t find(LineView line, size_t i, LineView pattern) {
+    const char* p = findFirst(line.data() + i, line.size() - i, pattern);
+    return p ? p - line.data() : NONE;
+}
+
+// end of the string or character literal whose body starts at column i, or
+// NONE if it doesn't end on this line; continues is set if it goes on in the
+// next line
+size_t literalEnd(LineView line, size_t i, char quote, bool& continues) {
+    continues = false;
+    while (i < line.size()) {
+        if (line[i] == '\\') {
+            if (i + 1 == line.size()) continues = true;
+            i += 2;
+        } else if (line[i] == quote) {
+            return i + 1;
+        } else {
+            i++;
+        }
+    }
+    return NONE;
+}
+
+}  // namespace
+
+const size_t SyntaxHighlighter::CLEAN;
+
+SyntaxHighlighter::SyntaxHighlighter()
+    : staleFrom(CLEAN), staleTo(0), lexed(0) {}
+
+bool SyntaxHighlighter::supports(const std::string& filename) {
+    static const char* const EXTENSIONS[] = {"c",  "cc", "cpp", "cxx",
+                                             "h",  "hh", "hpp", "hxx"};
+    size_t dot = filename.rfind('.');
+    if (dot == std::string::npos) return false;
+    return contains(EXTENSIONS, LineView(filename).substr(dot + 1));
+}
+
+void SyntaxHighlighter::clear() {
+    ends.clear();
+    staleFrom = CLEAN;
+    delimiters.clear();
+}
+
+void SyntaxHighlighter::markStale(size_t from, size_t to) {
+    if (from >= ends.size()) return;
+    if (staleFrom == CLEAN) {
+        staleFrom = from;
+        staleTo = to;
+    } else {
+        staleFrom = std::min(staleFrom, from);
+        staleTo = std::max(staleTo, to);
+    }
+}
+
+void SyntaxHighlighter::invalidate(size_t y) { markStale(y, y); }
+
+void SyntaxHighlighter::insertLines(size_t y, size_t n) {
+    if (n == 0 || y >= ends.size()) return;
+    ends.insert(y, n, 0);
+    if (staleFrom != CLEAN) {
+        if (staleFrom >= y) staleFrom += n;
+        if (staleTo >= y) staleTo += n;
+    }
+    // the cached state of the line before the new ones was not what the
+    // line after them started from, so that line has to be lexed again
+    markStale(y, y + n);
+}
+
+void SyntaxHighlighter::eraseLines(size_t y, size_t n) {
+    if (n == 0 || y >= ends.size()) return;
+    size_t last = std::min(y + n, ends.size());
+    ends.erase(y, last - y);
+    if (staleFrom != CLEAN) {
+        // lines inside the erased range move to y, the ones after it up
+        if (staleFrom >= y) staleFrom = staleFrom < last ? y : staleFrom - n;
+        if (staleTo >= y) staleTo = staleTo < last ? y : staleTo - n;
+        if (staleFrom >= ends.size()) staleFrom = CLEAN;
+    }
+    // same as for insertion, the line now at y starts from another state
+    markStale(y, y);
+}
+
+SyntaxHighlighter::State SyntaxHighlighter::stateBefore(
+    const TextBuffer& buffer, size_t y) {
+    if (y == 0) return NORMAL;
+    if (y > buffer.lineCount()) y = buffer.lineCount();
+
+    if (staleFrom != CLEAN && staleFrom < y) {
+        size_t i = staleFrom;
+        State state = i == 0 ? static_cast<State>(NORMAL) : ends[i - 1];
+        bool converged = false;
+        for (; i < y && i < ends.size(); ++i) {
+            state = lex(buffer.line(i), state, nullptr);
+            // the lines after i start from what they did when they were
+            // cached, so their states are right again
+            converged = i >= staleTo && state == ends[i];
+            ends.set(i, state);
+            if (converged) break;
+        }
+        if (converged || i >= ends.size()) {
+            staleFrom = CLEAN;
+        } else {
+            // line y starts from a new state and has to be lexed again
+            staleFrom = y;
+            staleTo = std::max(staleTo, y);
+        }
+    }
+
+    if (ends.size() >= y) return ends[y - 1];
+    State state =
+        ends.empty() ? static_cast<State>(NORMAL) : ends[ends.size() - 1];
+    while (ends.size() < y) {
+        state = lex(buffer.line(ends.size()), state, nullptr);
+        ends.push_back(state);
+    }
+    return state;
+}
+
+void SyntaxHighlighter::highlight(LineView line, State state,
+                                  std::vector<unsigned char>& out) {
+    out.resize(line.size());
+    if (!line.empty()) lex(line, state, &out[0]);
+}
+
+size_t SyntaxHighlighter::rawStringEnd(LineView line, size_t i,
+                                       State state) const {
+    const std::string& delimiter = delimiters[state >> 8];
+    char pattern[MAX_DELIMITER + 2];
+    pattern[0] = ')';
+    memcpy(pattern + 1, delimiter.data(), delimiter.size());
+    pattern[delimiter.size() + 1] = '"';
+    size_t end = find(line, i, LineView(pattern, delimiter.size() + 2));
+    return end == NONE ? NONE : end + delimiter.size() + 2;
+}
+
+SyntaxHighlighter::State SyntaxHighlighter::rawStringState(
+    LineView delimiter) {
+    size_t id = 0;
+    while (id < delimiters.size() && delimiters[id] != delimiter.str()) id++;
+    if (id == delimiters.size()) delimiters.push_back(delimiter.str());
+    return RAW_STRING | static_cast<State>(id << 8);
+}
+
+SyntaxHighlighter::State SyntaxHighlighter::lex(LineView line, State state,
+                                                unsigned char* out) {
+    lexed++;
+    const size_t n = line.size();
+    auto mark = [out](size_t from, size_t to, unsigned char hl) {
+        if (out && to > from) memset(out + from, hl, to - from);
+    };
+    const bool continued = n > 0 && line[n - 1] == '\\';
+
+    // finish what the previous line left open
+    size_t i = 0;
+    bool directive = false;
+    switch (state & 0xff) {
+        case BLOCK_COMMENT: {
+            size_t end = find(line, 0, "*/");
+            if (end == NONE) {
+                mark(0, n, HL_COMMENT);
+                return state;
+            }
+            mark(0, end + 2, HL_COMMENT);
+            i = end + 2;
+            break;
+        }
+        case LINE_COMMENT:
+            mark(0, n, HL_COMMENT);
+            return continued ? LINE_COMMENT : NORMAL;
+        case STRING: {
+            bool continues;
+            size_t end = literalEnd(line, 0, '"', continues);
+            if (end == NONE) {
+                mark(0, n, HL_STRING);
+                return continues ? STRING : NORMAL;
+            }
+            mark(0, end, HL_STRING);
+            i = end;
+            break;
+        }
+        case RAW_STRING: {
+            size_t end = rawStringEnd(line, 0, state);
+            if (end == NONE) {
+                mark(0, n, HL_STRING);
+                return state;
+            }
+            mark(0, end, HL_STRING);
+            i = end;
+            break;
+        }
+        case PREPROCESSOR:
+            directive = true;
+            break;
+    }
+
+    size_t first = i;  // a '#' here starts a directive
+    while (first < n && isspace(static_cast<unsigned char>(line[first])))
+        first++;
+
+    while (i < n) {
+        char c = line[i];
+        char next = i + 1 < n ? line[i + 1] : '\0';
+
+        if (c == '/' && next == '/') {
+            mark(i, n, HL_COMMENT);
+            return continued ? LINE_COMMENT : NORMAL;
+        }
+        if (c == '/' && next == '*') {
+            size_t end = find(line, i + 2, "*/");
+            if (end == NONE) {
+                mark(i, n, HL_COMMENT);
+                return BLOCK_COMMENT;
+            }
+            mark(i, end + 2, HL_COMMENT);
+            i = end + 2;
+            continue;
+        }
+
+        if (c == '"' || c == '\'') {
+            bool continues;
+            size_t end = literalEnd(line, i + 1, c, continues);
+            if (end == NONE) {
+                mark(i, n, HL_STRING);
+                if (continues && c == '"') return STRING;
+                return directive && continued ? PREPROCESSOR : NORMAL;
+            }
+            mark(i, end, HL_STRING);
+            i = end;
+            continue;
+        }
+
+        if (isdigit(static_cast<unsigned char>(c)) ||
+            (c == '.' && isdigit(static_cast<unsigned char>(next)))) {
+            // a preprocessing number, which covers suffixes, separators and
+            // signed exponents
+            size_t end = i + 1;
+            while (end < n) {
+                char d = line[end], prev = line[end - 1];
+                if (isIdentifier(d) || d == '.' || d == '\'') {
+                    end++;
+                } else if ((d == '+' || d == '-') &&
+                           (prev == 'e' || prev == 'E' || prev == 'p' ||
+                            prev == 'P')) {
+                    end++;
+                } else {
+                    break;
+                }
+            }
+            mark(i, end, directive ? HL_PREPROCESSOR : HL_NUMBER);
+            i = end;
+            continue;
+        }
+
+        if (isIdentifier(c)) {
+            size_t end = i + 1;
+            while (end < n && isIdentifier(line[end])) end++;
+            LineView word = line.substr(i, end - i);
+
+            if (end < n && line[end] == '"' && contains(RAW_PREFIXES, word)) {
+                // R"delimiter(...)delimiter"
+                size_t paren = end + 1;
+                while (paren < n && paren - end <= MAX_DELIMITER &&
+                       line[paren] != '(')
+                    paren++;
+                if (paren < n && line[paren] == '(') {
+                    State raw =
+                        rawStringState(line.substr(end + 1, paren - end - 1));
+                    size_t close = rawStringEnd(line, paren + 1, raw);
+                    if (close == NONE) {
+                        mark(i, n, HL_STRING);
+                        return raw;
+                    }
+                    mark(i, close, HL_STRING);
+                    i = close;
+                    continue;
+                }
+            }
+
+            unsigned char hl = HL_NORMAL;
+            if (directive)
+                hl = HL_PREPROCESSOR;
+            else if (contains(KEYWORDS, word))
+                hl = HL_KEYWORD;
+            else if (contains(TYPES, word))
+                hl = HL_TYPE;
+            mark(i, end, hl);
+            i = end;
+            continue;
+        }
+
+        if (c == '#' && i == first) directive = true;
+        mark(i, i + 1, directive ? HL_PREPROCESSOR : HL_NORMAL);
+        i++;
+    }
+    return directive && continued ? PREPROCESSOR : NORMAL;
+}
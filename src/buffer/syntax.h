@@ -0,0 +1,93 @@
+#ifndef CP_EDITOR_SYNTAX_H
+#define CP_EDITOR_SYNTAX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "line_tree.h"
+#include "line_view.h"
+
+// class of a character for highlighting
+enum Highlight : unsigned char {
+    HL_NORMAL,
+    HL_COMMENT,
+    HL_KEYWORD,
+    HL_TYPE,
+    HL_STRING,
+    HL_NUMBER,
+    HL_PREPROCESSOR,
+};
+
+/**
+ * @brief C/C++ highlighter that keeps the lexer state at the end of each line
+ *
+ * A line can only be highlighted knowing what the lines before it left open:
+ * a block comment, a raw string, a string or a directive continued with a
+ * backslash. These states are cached for the lines lexed so far. After an
+ * edit, lexing restarts at the first edited line and stops as soon as a line
+ * past the edits ends in the state that was cached for it, so the work
+ * depends on the size of the change and not on the size of the file. Lines
+ * are only lexed when a state at or after them is asked for, that is when
+ * they are above or inside the visible window. The states are kept in a
+ * LineTree, so that inserting or erasing lines doesn't move the states of
+ * the lines after them.
+ */
+class SyntaxHighlighter {
+public:
+    // lexer state between two lines, 0 at the start of the file
+    typedef uint32_t State;
+
+    SyntaxHighlighter();
+
+    // true if filename looks like C or C++ source
+    static bool supports(const std::string& filename);
+
+    // forget every state, the buffer has new contents
+    void clear();
+    // line y was modified
+    void invalidate(size_t y);
+    // n lines were inserted before line y
+    void insertLines(size_t y, size_t n);
+    // lines [y, y + n) were erased
+    void eraseLines(size_t y, size_t n);
+
+    // state at the start of line y of buffer, lexing lines as needed
+    State stateBefore(const TextBuffer& buffer, size_t y);
+    // class of every character of line, which starts in state
+    void highlight(LineView line, State state,
+                   std::vector<unsigned char>& out);
+
+    // number of lines lexed so far, to check the work done
+    size_t linesLexed() const { return lexed; }
+
+private:
+    // lex line from state and return the state at its end; the class of
+    // each character goes to out unless it is nullptr
+    State lex(LineView line, State state, unsigned char* out);
+    // find the end of a raw string with the given delimiter from column i
+    size_t rawStringEnd(LineView line, size_t i, State state) const;
+    State rawStringState(LineView delimiter);
+    void markStale(size_t from, size_t to);
+
+    // the states need no sums
+    struct Ends {
+        typedef State Value;
+        struct Sum {};
+        static Sum sum(State) { return Sum(); }
+        static Sum combine(Sum, Sum) { return Sum(); }
+    };
+
+    static const size_t CLEAN = static_cast<size_t>(-1);
+
+    LineTree<Ends> ends;  // state at the end of each line lexed so far
+    // lines [staleFrom, ends.size()) may have wrong states; the last edited
+    // line among them is staleTo. staleFrom is CLEAN if none is wrong.
+    size_t staleFrom, staleTo;
+    std::vector<std::string> delimiters;  // of the raw strings seen
+    size_t lexed;
+};
+
+#endif  // CP_EDITOR_SYNTAX_H
@@ -0,0 +1,11 @@
+#ifndef CP_EDITOR_TEXT_POSITION_H
+#define CP_EDITOR_TEXT_POSITION_H
+
+#include <cstddef>
+
+// column x of line y
+struct TextPosition {
+    size_t y, x;
+};
+
+#endif  // CP_EDITOR_TEXT_POSITION_H
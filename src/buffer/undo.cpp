@@ -0,0 +1,247 @@
+#include "undo.h"
+
+#include <algorithm>
+#include <cstdint>
+
+static void putVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+static uint64_t getVarint(const char*& p) {
+    uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        unsigned char c = *p++;
+        v |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if (!(c & 0x80)) return v;
+    }
+}
+
+UndoJournal::UndoJournal(size_t limit)
+    : current(0),
+      arenaStart(0),
+      limit(limit),
+      sealed(true),
+      grouping(false),
+      groupStarted(false) {}
+
+void UndoJournal::setLimit(size_t bytes) {
+    limit = bytes;
+    enforceLimit();
+}
+
+size_t UndoJournal::memoryUsage() const {
+    return arena.size() + records.size() * sizeof(Record);
+}
+
+void UndoJournal::clear() {
+    records.clear();
+    current = 0;
+    arena.clear();
+    arenaStart = 0;
+    sealed = true;
+}
+
+void UndoJournal::beginGroup() {
+    grouping = true;
+    groupStarted = false;
+}
+
+void UndoJournal::endGroup(bool open) {
+    grouping = false;
+    sealed = sealed || !open;
+}
+
+bool UndoJournal::mergeable(LineView text) const {
+    // only runs of single characters on one line are merged
+    return !sealed && !grouping && !records.empty() &&
+           current == records.size() && text.size() == 1 && text[0] != '\n';
+}
+
+void UndoJournal::recordInsert(size_t y, size_t x, LineView text,
+                               TextPosition before, TextPosition after) {
+    if (mergeable(text)) {
+        Record& last = records.back();
+        if (last.insert && !last.reversed && last.y == y &&
+            last.x + last.size == x &&
+            arenaStart + arena.size() == last.offset + last.size) {
+            arena.append(text.data(), text.size());
+            last.size += text.size();
+            last.after = after;
+            enforceLimit();
+            return;
+        }
+    }
+    push(Record{true, false, y, x, 0, 0, before, after, false, false}, text);
+}
+
+void UndoJournal::recordErase(size_t y, size_t x, LineView text,
+                              TextPosition before, TextPosition after) {
+    if (mergeable(text)) {
+        Record& last = records.back();
+        bool atEnd = arenaStart + arena.size() == last.offset + last.size;
+        if (!last.insert && last.y == y && atEnd) {
+            if (x + 1 == last.x && (last.reversed || last.size == 1)) {
+                // backspace: the new character comes before the others
+                arena.append(text.data(), text.size());
+                last.size++;
+                last.x = x;
+                last.reversed = true;
+                last.after = after;
+                enforceLimit();
+                return;
+            }
+            if (x == last.x && !last.reversed) {
+                // delete: the new character comes after the others
+                arena.append(text.data(), text.size());
+                last.size++;
+                last.after = after;
+                enforceLimit();
+                return;
+            }
+        }
+    }
+    push(Record{false, false, y, x, 0, 0, before, after, false, false}, text);
+}
+
+void UndoJournal::recordReplace(LineView needle, LineView with,
+                                const std::vector<TextPosition>& at,
+                                TextPosition before, TextPosition after) {
+    if (at.empty()) return;
+    // both texts, then the positions as the lines from the one before and
+    // the columns from the end of the match before on the same line
+    std::string encoded;
+    putVarint(encoded, needle.size());
+    encoded.append(needle.data(), needle.size());
+    putVarint(encoded, with.size());
+    encoded.append(with.data(), with.size());
+    putVarint(encoded, at.size());
+    size_t y = 0, x = 0;
+    for (const TextPosition& pos : at) {
+        if (pos.y != y) x = 0;
+        putVarint(encoded, pos.y - y);
+        putVarint(encoded, pos.x - x);
+        y = pos.y;
+        x = pos.x + needle.size();
+    }
+    push(Record{false, false, at.front().y, at.front().x, 0, 0, before, after,
+                false, true},
+         encoded);
+    sealed = true;
+}
+
+void UndoJournal::push(const Record& record, LineView text) {
+    dropRedo();
+    Record r = record;
+    r.offset = arenaStart + arena.size();
+    r.size = text.size();
+    r.joined = grouping && groupStarted;
+    groupStarted = groupStarted || grouping;
+    arena.append(text.data(), text.size());
+    records.push_back(r);
+    current = records.size();
+    // only single characters start a run that later edits can join
+    sealed = text.size() != 1 || text[0] == '\n';
+    enforceLimit();
+}
+
+void UndoJournal::dropRedo() {
+    if (current == records.size()) return;
+    records.erase(records.begin() + current, records.end());
+    size_t end = records.empty() ? arenaStart
+                                 : records.back().offset + records.back().size;
+    arena.resize(end - arenaStart);
+}
+
+void UndoJournal::enforceLimit() {
+    // the oldest records that can be undone go first; the records that can
+    // be redone and the newest one stay even if they are over the limit
+    while (memoryUsage() > limit && current > 0 && records.size() > 1) {
+        records.pop_front();
+        current--;
+    }
+    // what is left of a group that lost its start stands on its own
+    if (!records.empty()) records.front().joined = false;
+    // give back the arena space of dropped records once it is half the arena
+    size_t first = records.empty() ? arenaStart + arena.size()
+                                   : records.front().offset;
+    size_t dead = first - arenaStart;
+    if (dead > 0 && dead * 2 >= arena.size()) {
+        arena.erase(0, dead);
+        arenaStart = first;
+    }
+}
+
+std::string UndoJournal::text(const Record& record) const {
+    std::string s = arena.substr(record.offset - arenaStart, record.size);
+    if (record.reversed) std::reverse(s.begin(), s.end());
+    return s;
+}
+
+void UndoJournal::replacement(const Record& record, bool back,
+                              Step& step) const {
+    const char* p = arena.data() + (record.offset - arenaStart);
+    size_t size = getVarint(p);
+    LineView needle(p, size);
+    p += size;
+    size = getVarint(p);
+    LineView with(p, size);
+    p += size;
+    size_t count = getVarint(p);
+
+    step.text = (back ? needle : with).str();
+    step.n = back ? with.size() : needle.size();
+    step.at.clear();
+    step.at.reserve(count);
+    size_t y = 0, x = 0;
+    size_t done = 0;  // matches before on the line, when going back
+    for (size_t i = 0; i < count; ++i) {
+        size_t dy = getVarint(p);
+        if (dy > 0) x = done = 0;
+        y += dy;
+        x += getVarint(p);
+        // after the replacement, the ones before on the line moved it
+        size_t moved = x;
+        if (back) moved = x - done * needle.size() + done * with.size();
+        step.at.push_back(TextPosition{y, moved});
+        x += needle.size();
+        done++;
+    }
+}
+
+bool UndoJournal::undo(Step& step) {
+    if (current == 0) return false;
+    const Record& record = records[--current];
+    step.insert = !record.insert;
+    step.y = record.y;
+    step.x = record.x;
+    step.replace = record.replace;
+    if (record.replace)
+        replacement(record, true, step);
+    else
+        step.text = text(record);
+    step.cursor = record.before;
+    step.more = record.joined;
+    sealed = true;
+    return true;
+}
+
+bool UndoJournal::redo(Step& step) {
+    if (current == records.size()) return false;
+    const Record& record = records[current++];
+    step.insert = record.insert;
+    step.y = record.y;
+    step.x = record.x;
+    step.replace = record.replace;
+    if (record.replace)
+        replacement(record, false, step);
+    else
+        step.text = text(record);
+    step.cursor = record.after;
+    step.more = current < records.size() && records[current].joined;
+    sealed = true;
+    return true;
+}
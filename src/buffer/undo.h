@@ -0,0 +1,96 @@
+#ifndef CP_EDITOR_UNDO_H
+#define CP_EDITOR_UNDO_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "line_view.h"
+#include "text_position.h"
+
+/**
+ * @brief undo/redo history of a buffer
+ *
+ * Every edit is an insertion or an erasure of some text at a position. The
+ * text of all records lives in one arena, and a run of single character
+ * edits next to each other (typing, backspace, delete) is merged into the
+ * last record instead of adding a new one. The records made between
+ * beginGroup() and endGroup() are undone and redone as one edit, and a
+ * replacement of every match of a text is one record of a few bytes per
+ * match. When the history uses more than its memory limit the oldest
+ * records are dropped, but never the newest one or one that can be redone.
+ */
+class UndoJournal {
+public:
+    // an edit to apply to the buffer
+    struct Step {
+        bool insert;  // insert text at (y, x), otherwise erase it from there
+        size_t y, x;
+        std::string text;
+        TextPosition cursor;  // where the cursor goes afterwards
+        bool more;  // the next undo() or redo() step is part of the same edit
+        // instead, replace the n characters at each position of at by text
+        bool replace;
+        size_t n;
+        std::vector<TextPosition> at;
+    };
+
+    explicit UndoJournal(size_t limit = 8 << 20);
+
+    void setLimit(size_t bytes);
+    size_t memoryUsage() const;
+    void clear();
+
+    // text was inserted at (y, x), moving the cursor from before to after
+    void recordInsert(size_t y, size_t x, LineView text, TextPosition before,
+                      TextPosition after);
+    // text was erased at (y, x)
+    void recordErase(size_t y, size_t x, LineView text, TextPosition before,
+                     TextPosition after);
+    // the needle at each position of at, in order, was replaced by with
+    void recordReplace(LineView needle, LineView with,
+                       const std::vector<TextPosition>& at,
+                       TextPosition before, TextPosition after);
+    // stop merging edits into the last record
+    void seal() { sealed = true; }
+    // the records up to endGroup() make one edit, which nothing merges into
+    // unless open is set; then typing on extends its last record
+    void beginGroup();
+    void endGroup(bool open = false);
+
+    // the edit that reverts the last record, false if there is none
+    bool undo(Step& step);
+    // the edit that repeats the last undone record
+    bool redo(Step& step);
+
+private:
+    struct Record {
+        bool insert;
+        bool reversed;  // text is stored back to front (backspace runs)
+        size_t y, x;
+        size_t offset, size;  // text in the arena, offsets count from start
+        TextPosition before, after;
+        bool joined;  // undone and redone with the record before it
+        bool replace;  // the text encodes a replacement, see recordReplace()
+    };
+
+    void push(const Record& record, LineView text);
+    void dropRedo();
+    void enforceLimit();
+    std::string text(const Record& record) const;
+    // the step of a replacement, the other way around if back is set
+    void replacement(const Record& record, bool back, Step& step) const;
+    bool mergeable(LineView text) const;
+
+    std::deque<Record> records;
+    size_t current;  // records before this index can be undone
+    std::string arena;
+    size_t arenaStart;  // offset of arena[0]
+    size_t limit;
+    bool sealed;
+    bool grouping;  // between beginGroup() and endGroup()
+    bool groupStarted;  // the group has a record
+};
+
+#endif  // CP_EDITOR_UNDO_H
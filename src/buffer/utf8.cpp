@@ -0,0 +1,120 @@
+#include "utf8.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+struct Range {
+    uint32_t first, last;
+};
+
+// characters that combine with the one before them
+const Range ZERO_WIDTH[] = {
+    {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x0610, 0x061A},
+    {0x064B, 0x065F}, {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E},
+    {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x20D0, 0x20FF},
+    {0x3099, 0x309A}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF},
+};
+
+// East Asian Wide and Fullwidth characters
+const Range WIDE[] = {
+    {0x1100, 0x115F},   {0x231A, 0x231B},   {0x2329, 0x232A},
+    {0x23E9, 0x23EC},   {0x23F0, 0x23F0},   {0x23F3, 0x23F3},
+    {0x25FD, 0x25FE},   {0x2614, 0x2615},   {0x2648, 0x2653},
+    {0x267F, 0x267F},   {0x2693, 0x2693},   {0x26A1, 0x26A1},
+    {0x26AA, 0x26AB},   {0x26BD, 0x26BE},   {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE},   {0x26D4, 0x26D4},   {0x26EA, 0x26EA},
+    {0x26F2, 0x26F3},   {0x26F5, 0x26F5},   {0x26FA, 0x26FA},
+    {0x26FD, 0x26FD},   {0x2705, 0x2705},   {0x270A, 0x270B},
+    {0x2728, 0x2728},   {0x274C, 0x274C},   {0x274E, 0x274E},
+    {0x2753, 0x2755},   {0x2757, 0x2757},   {0x2795, 0x2797},
+    {0x27B0, 0x27B0},   {0x27BF, 0x27BF},   {0x2B1B, 0x2B1C},
+    {0x2B50, 0x2B50},   {0x2B55, 0x2B55},   {0x2E80, 0x303E},
+    {0x3041, 0x3098},   {0x309B, 0x33FF},   {0x3400, 0x4DBF},
+    {0x4E00, 0x9FFF},   {0xA000, 0xA4CF},   {0xA960, 0xA97F},
+    {0xAC00, 0xD7A3},   {0xF900, 0xFAFF},   {0xFE10, 0xFE19},
+    {0xFE30, 0xFE6F},   {0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},
+    {0x16FE0, 0x16FE4}, {0x17000, 0x18CFF}, {0x1B000, 0x1B2FF},
+    {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E},
+    {0x1F191, 0x1F19A}, {0x1F200, 0x1F202}, {0x1F210, 0x1F23B},
+    {0x1F240, 0x1F248}, {0x1F250, 0x1F251}, {0x1F260, 0x1F265},
+    {0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF}, {0x1F7E0, 0x1F7EB},
+    {0x1F90C, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD},
+    {0x30000, 0x3FFFD},
+};
+
+template <size_t N>
+bool inRanges(const Range (&ranges)[N], uint32_t c) {
+    const Range* it = std::lower_bound(
+        ranges, ranges + N, c,
+        [](const Range& range, uint32_t c) { return range.last < c; });
+    return it != ranges + N && it->first <= c;
+}
+
+bool isContinuation(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+}  // namespace
+
+size_t decodeUtf8(const char* p, size_t n, uint32_t& codePoint) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+    if (n == 0) return 0;
+    if (s[0] < 0x80) {
+        codePoint = s[0];
+        return 1;
+    }
+
+    size_t length;
+    uint32_t c, min;
+    if ((s[0] & 0xE0) == 0xC0) {
+        length = 2;
+        c = s[0] & 0x1F;
+        min = 0x80;
+    } else if ((s[0] & 0xF0) == 0xE0) {
+        length = 3;
+        c = s[0] & 0x0F;
+        min = 0x800;
+    } else if ((s[0] & 0xF8) == 0xF0) {
+        length = 4;
+        c = s[0] & 0x07;
+        min = 0x10000;
+    } else {
+        return 0;
+    }
+    if (n < length) return 0;
+    for (size_t i = 1; i < length; ++i) {
+        if (!isContinuation(s[i])) return 0;
+        c = c << 6 | (s[i] & 0x3F);
+    }
+    // overlong forms, surrogates and values past the last code point
+    if (c < min || (0xD800 <= c && c <= 0xDFFF) || c > 0x10FFFF) return 0;
+    codePoint = c;
+    return length;
+}
+
+int codePointWidth(uint32_t codePoint) {
+    if (codePoint < 0x300) return 1;
+    if (inRanges(ZERO_WIDTH, codePoint)) return 0;
+    if (inRanges(WIDE, codePoint)) return 2;
+    return 1;
+}
+
+size_t plainSpan(const char* p, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // 16 bytes at a time: stop at the first non-ASCII byte or tab
+    const __m128i tab = _mm_set1_epi8('\t');
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        unsigned mask = _mm_movemask_epi8(v) |
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(v, tab));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+    while (i < n && static_cast<unsigned char>(p[i]) < 0x80 && p[i] != '\t')
+        i++;
+    return i;
+}
@@ -0,0 +1,21 @@
+#ifndef CP_EDITOR_UTF8_H
+#define CP_EDITOR_UTF8_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief decode the UTF-8 character at p
+ * @param n number of bytes available at p
+ * @return length of the character, 0 if the bytes are not valid UTF-8
+ */
+size_t decodeUtf8(const char* p, size_t n, uint32_t& codePoint);
+
+// columns a code point takes on a terminal: 0, 1 or 2 (East Asian wide)
+int codePointWidth(uint32_t codePoint);
+
+// length of the leading run of bytes at p that render one to one: ASCII
+// other than tab
+size_t plainSpan(const char* p, size_t n);
+
+#endif  // CP_EDITOR_UTF8_H
@@ -0,0 +1,76 @@
+#include "wrap_index.h"
+
+#include <algorithm>
+
+WrapIndex::WrapIndex() : ready(false), cols(1), wrapped(0) {}
+
+void WrapIndex::clear() {
+    tree.clear();
+    ready = false;
+}
+
+void WrapIndex::reset(size_t columns) {
+    clear();
+    cols = std::max<size_t>(columns, 1);
+    ready = true;
+}
+
+void WrapIndex::setWidth(size_t y, size_t width) {
+    if (!built()) return;
+    tree.set(y, lineOf(width));
+    wrapped++;
+}
+
+void WrapIndex::insertLines(size_t y, size_t n) {
+    if (!built()) return;
+    tree.insert(y, n, lineOf(0));
+}
+
+void WrapIndex::eraseLines(size_t y, size_t n) {
+    if (!built() || n == 0) return;
+    tree.erase(y, n);
+}
+
+void WrapIndex::setColumns(size_t columns) {
+    columns = std::max<size_t>(columns, 1);
+    if (columns == cols) return;
+    size_t min = std::min(columns, cols);
+    cols = columns;
+    if (!built()) return;
+    // one row whatever the columns below min
+    tree.modify([min](const Rows& lines) { return lines.widest >= min; },
+                [this, min](size_t, Rows& line) {
+                    if (line.widest < min) return;
+                    line.rows = rowsFor(line.widest);
+                    wrapped++;
+                });
+}
+
+size_t WrapIndex::rowOf(size_t y) const {
+    if (!built()) return y;
+    if (y >= lineCount()) return totalRows();
+    return tree.prefix(y).rows;
+}
+
+size_t WrapIndex::lineAt(size_t row, size_t& skip) const {
+    skip = 0;
+    if (row >= totalRows()) return lineCount();
+    LineTree<Lines>::Ref t = tree.root();
+    size_t base = 0;  // first line of t
+    while (true) {
+        uint64_t before = tree.sum(tree.left(t)).rows;
+        if (row < before) {
+            t = tree.left(t);
+            continue;
+        }
+        row -= before;
+        size_t y = base + tree.size(tree.left(t));
+        if (row < tree.value(t).rows) {
+            skip = row;
+            return y;
+        }
+        row -= tree.value(t).rows;
+        base = y + 1;
+        t = tree.right(t);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CP_EDITOR_WRAP_INDEX_H
+#define CP_EDITOR_WRAP_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "line_tree.h"
+
+/**
+ * @brief screen rows of soft-wrapped lines
+ *
+ * A line of width w takes w / columns + 1 rows, so the cursor after its
+ * last character always has a place. The rows of every line are summed up
+ * in a LineTree, which turns a line into its first screen row and a screen
+ * row into its line in O(log n).
+ *
+ * The widths of the lines are kept too, together with the widest line of
+ * every subtree. When the columns change, only the lines at least as wide
+ * as the narrower of the two widths can change their rows, and the walk
+ * down the tree only visits those.
+ *
+ * Inserting or erasing k lines costs O(k + log n) and leaves the other
+ * lines alone, without looking at any text.
+ */
+class WrapIndex {
+public:
+    WrapIndex();
+
+    void clear();
+    // false until build(), the edits are ignored meanwhile
+    bool built() const { return ready; }
+
+    // wrap lines at columns, widthOf(y) is the width of line y
+    template <typename F>
+    void build(size_t lines, size_t columns, F widthOf) {
+        reset(columns);
+        tree.assign(lines, [this, &widthOf](size_t y) {
+            return lineOf(widthOf(y));
+        });
+        wrapped += lines;
+    }
+
+    // line y now takes width columns
+    void setWidth(size_t y, size_t width);
+    // n empty lines were inserted before line y
+    void insertLines(size_t y, size_t n);
+    // lines [y, y + n) were erased
+    void eraseLines(size_t y, size_t n);
+    // the screen is this wide now
+    void setColumns(size_t columns);
+
+    size_t columns() const { return cols; }
+    size_t lineCount() const { return tree.size(); }
+    size_t totalRows() const { return tree.total().rows; }
+    size_t rowsOf(size_t y) const { return tree[y].rows; }
+    // first screen row of line y, totalRows() for y == lineCount()
+    size_t rowOf(size_t y) const;
+    // line holding screen row row, skip is set to the rows of it before;
+    // lineCount() past the last row
+    size_t lineAt(size_t row, size_t& skip) const;
+
+    // number of lines whose rows were worked out again, to check the work
+    size_t linesWrapped() const { return wrapped; }
+
+private:
+    // the rows of a line and its width, or of some lines and the widest
+    struct Rows {
+        uint64_t rows;
+        uint32_t widest;
+    };
+    struct Lines {
+        typedef Rows Value;
+        typedef Rows Sum;
+        static Rows sum(const Rows& line) { return line; }
+        static Rows combine(const Rows& a, const Rows& b) {
+            return Rows{a.rows + b.rows, a.widest > b.widest ? a.widest
+                                                             : b.widest};
+        }
+    };
+
+    void reset(size_t columns);
+    uint64_t rowsFor(size_t width) const { return width / cols + 1; }
+    Rows lineOf(size_t width) const {
+        return Rows{rowsFor(width), static_cast<uint32_t>(width)};
+    }
+
+    LineTree<Lines> tree;
+    bool ready;  // built
+    size_t cols;
+    size_t wrapped;
+};
+
+#endif  // CP_EDITOR_WRAP_INDEX_H
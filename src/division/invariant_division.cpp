@@ -0,0 +1,167 @@
+#include "invariant_division.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
+InvariantDivision::InvariantDivision(long long denominator)
+    : d(denominator),
+      magic(0),
+      wideMagic(0),
+      shift(0),
+      add(false),
+      negative(denominator < 0) {
+  if (d == 0) throw DivisionByZero();
+
+  unsigned long long absD = d;
+  if (negative) absD = 0 - absD;
+  unsigned log2 = 63 - __builtin_clzll(absD);
+  shift = log2;
+  if ((absD & (absD - 1)) == 0) return;
+
+  // m = 2^(64 + log2 - 1) / |d| is one bit short of the precision needed,
+  // unless the error of rounding it up is small enough
+  unsigned __int128 power = static_cast<unsigned __int128>(1) << (63 + log2);
+  unsigned long long m = static_cast<unsigned long long>(power / absD);
+  unsigned long long rem = static_cast<unsigned long long>(power % absD);
+  // twice the multiplier, 2^(64 + log2) / |d| rounded up, is enough for
+  // the absolute values of the numerators on their own
+  unsigned long long twice = rem + rem;
+  wideMagic = m + m + (twice >= absD || twice < rem) + 1;
+  if (absD - rem < (1ULL << log2)) {
+    shift = log2 - 1;
+  } else {
+    // the top bit of twice the multiplier doesn't fit and is made up for by
+    // adding the numerator
+    m = wideMagic - 1;
+    add = true;
+  }
+  m += 1;
+  magic = static_cast<long long>(negative ? 0 - m : m);
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_AVX2_KERNEL 1
+
+// AVX2 is only used where the processor has it, the rest of the build
+// doesn't assume it
+#define AVX2 __attribute__((target("avx2")))
+
+// -1 in the lanes of v that are negative, 0 in the others
+AVX2 static inline __m256i signsOf(__m256i v) {
+  return _mm256_srai_epi32(_mm256_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 1, 1)),
+                           31);
+}
+
+// arithmetic shift right of each lane, AVX2 only has it for 32 bits
+AVX2 static inline __m256i shiftRight(__m256i v, unsigned n) {
+  __m256i top = _mm256_set1_epi64x(static_cast<long long>(1ULL << (63 - n)));
+  __m256i x = _mm256_srl_epi64(v, _mm_cvtsi32_si128(n));
+  return _mm256_sub_epi64(_mm256_xor_si256(x, top), top);
+}
+
+// the power of two steps of quotient(), on four numerators at a time
+AVX2 size_t InvariantDivision::divideAvx2(const long long *numerators,
+                                          size_t count, long long *divisions,
+                                          long long *remainders) const {
+  const __m256i sign = _mm256_set1_epi64x(negative ? -1 : 0);
+  const __m256i bias =
+      _mm256_set1_epi64x(static_cast<long long>((1ULL << shift) - 1));
+  const __m128i bits = _mm_cvtsi32_si128(shift);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i n = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(numerators + i));
+    __m256i q = _mm256_add_epi64(n, _mm256_and_si256(signsOf(n), bias));
+    q = shiftRight(q, shift);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(divisions + i),
+                        _mm256_sub_epi64(_mm256_xor_si256(q, sign), sign));
+    // q * d is q << shift before the sign of d is applied
+    if (remainders)
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(remainders + i),
+                          _mm256_sub_epi64(n, _mm256_sll_epi64(q, bits)));
+  }
+  return i;
+}
+
+#define AVX512 __attribute__((target("avx512f")))
+
+// upper 64 bits of the unsigned products of the lanes of x and y, where y1
+// holds the upper halves of the lanes of y, from 32-bit multiplications
+AVX512 static inline __m512i mulhi(__m512i x, __m512i y, __m512i y1) {
+  __m512i x1 = _mm512_srli_epi64(x, 32);
+  __m512i x0y0 = _mm512_mul_epu32(x, y);
+  __m512i x0y1 = _mm512_mul_epu32(x, y1);
+  __m512i x1y0 = _mm512_mul_epu32(x1, y);
+  __m512i x1y1 = _mm512_mul_epu32(x1, y1);
+
+  __m512i low = _mm512_set1_epi64(0xffffffff);
+  __m512i middle = _mm512_add_epi64(x1y0, _mm512_srli_epi64(x0y0, 32));
+  __m512i carry = _mm512_srli_epi64(
+      _mm512_add_epi64(_mm512_and_si512(middle, low), x0y1), 32);
+  return _mm512_add_epi64(
+      _mm512_add_epi64(x1y1, _mm512_srli_epi64(middle, 32)), carry);
+}
+
+// the other denominators on eight numerators at a time. There is no
+// signed high multiplication to build on, so |n| is divided by |d| with
+// wideMagic and the signs are put back, which needs no adding of n either
+AVX512 size_t InvariantDivision::divideAvx512(const long long *numerators,
+                                              size_t count,
+                                              long long *divisions,
+                                              long long *remainders) const {
+  unsigned long long absD = negative ? 0 - d : d;
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i m = _mm512_set1_epi64(static_cast<long long>(wideMagic));
+  const __m512i m1 = _mm512_srli_epi64(m, 32);
+  const __m128i bits = _mm_cvtsi32_si128(63 - __builtin_clzll(absD));
+  // q has up to 63 bits when |d| has 32 and up to 31 when it is wider, so
+  // q * |d| takes one multiplication of the high halves either way
+  bool narrow = absD >> 32 == 0;
+  const __m512i d0 = _mm512_set1_epi64(absD & 0xffffffff);
+  const __m512i cross = _mm512_set1_epi64(narrow ? absD : absD >> 32);
+  const __m128i high = _mm_cvtsi32_si128(narrow ? 32 : 0);
+  const __mmask8 flip = negative ? 0xff : 0;
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m512i n = _mm512_loadu_si512(numerators + i);
+    __mmask8 below = _mm512_cmplt_epi64_mask(n, zero);  // and % too
+    __m512i u = _mm512_abs_epi64(n);
+    __m512i q = _mm512_srl_epi64(mulhi(u, m, m1), bits);
+    _mm512_storeu_si512(divisions + i,
+                        _mm512_mask_sub_epi64(q, below ^ flip, zero, q));
+    if (!remainders) continue;
+    __m512i p = _mm512_add_epi64(
+        _mm512_mul_epu32(q, d0),
+        _mm512_slli_epi64(
+            _mm512_mul_epu32(_mm512_srl_epi64(q, high), cross), 32));
+    __m512i r = _mm512_sub_epi64(u, p);
+    _mm512_storeu_si512(remainders + i,
+                        _mm512_mask_sub_epi64(r, below, zero, r));
+  }
+  return i;
+}
+
+#endif
+
+void InvariantDivision::divide(const long long *numerators, size_t count,
+                               long long *divisions,
+                               long long *remainders) const {
+  size_t i = 0;
+#ifdef HAVE_AVX2_KERNEL
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  static const bool avx512 = __builtin_cpu_supports("avx512f");
+  if (avx512 && magic != 0)
+    i = divideAvx512(numerators, count, divisions, remainders);
+  else if (avx2 && magic == 0)
+    i = divideAvx2(numerators, count, divisions, remainders);
+#endif
+  // a copy the stores to divisions and remainders can't alias, so that its
+  // fields stay in registers
+  const InvariantDivision by = *this;
+  for (; i < count; ++i) {
+    long long q = by.quotient(numerators[i]);
+    divisions[i] = q;
+    if (remainders) remainders[i] = by.remainder(numerators[i], q);
+  }
+}
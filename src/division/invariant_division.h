@@ -0,0 +1,77 @@
+#ifndef CMAKE_INVARIANT_DIVISION_H
+#define CMAKE_INVARIANT_DIVISION_H
+
+#include <cstddef>
+
+#include "division.h"
+
+// Divides many numerators by the same denominator. The denominator is
+// checked once and turned into a multiply-shift reciprocal, the way
+// libdivide does it, so that every division is a multiplication and a few
+// shifts instead of a hardware division. The batch divide() takes four
+// numerators at a time on processors with AVX2 when |d| is a power of two,
+// and eight at a time on processors with AVX-512 for the other
+// denominators. Neither has a 64-bit high multiplication; it is built from
+// four 32-bit ones, which only AVX-512 does fast enough to beat the scalar
+// imul.
+class InvariantDivision {
+public:
+  // throws DivisionByZero if denominator is 0
+  explicit InvariantDivision(long long denominator);
+
+  long long denominator() const { return d; }
+
+  // numerator / denominator(), rounded toward zero like the / operator
+  long long quotient(long long numerator) const {
+    typedef unsigned long long U;
+    U n = numerator;
+    U sign = negative ? ~0ULL : 0;  // (x ^ sign) - sign is x or -x
+    long long q;
+    if (magic == 0) {
+      // |d| is a power of two, negative numerators are rounded up first
+      U bias = (1ULL << shift) - 1;
+      q = static_cast<long long>(n + (static_cast<U>(numerator >> 63) & bias));
+      q >>= shift;
+      return static_cast<long long>((static_cast<U>(q) ^ sign) - sign);
+    }
+    q = static_cast<long long>(
+        (static_cast<__int128>(magic) * numerator) >> 64);
+    if (add) q = static_cast<long long>(q + ((n ^ sign) - sign));
+    q >>= shift;
+    return q + (q < 0);
+  }
+
+  DivisionResult divide(long long numerator) const {
+    long long q = quotient(numerator);
+    return DivisionResult{q, remainder(numerator, q)};
+  }
+
+  // divisions[i] = numerators[i] / d and remainders[i] = numerators[i] % d
+  // for the count numerators; remainders may be nullptr
+  void divide(const long long *numerators, size_t count, long long *divisions,
+              long long *remainders = nullptr) const;
+
+protected:
+  // the AVX2 kernel of divide() for powers of two and the AVX-512 one for
+  // the other denominators, return how many numerators they divided
+  size_t divideAvx2(const long long *numerators, size_t count,
+                    long long *divisions, long long *remainders) const;
+  size_t divideAvx512(const long long *numerators, size_t count,
+                      long long *divisions, long long *remainders) const;
+
+  long long remainder(long long numerator, long long q) const {
+    return static_cast<long long>(static_cast<unsigned long long>(numerator) -
+                                  static_cast<unsigned long long>(q) * d);
+  }
+
+  long long d;
+  long long magic;  // 0 when |d| is a power of two
+  // 2^(64 + log2 |d|) / |d| rounded up, which divides |numerator| with
+  // one unsigned high multiplication and a shift
+  unsigned long long wideMagic;
+  unsigned  shift;
+  bool      add;       // the numerator is added to the product once more
+  bool      negative;  // d < 0
+};
+
+#endif //CMAKE_INVARIANT_DIVISION_H
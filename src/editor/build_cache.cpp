@@ -0,0 +1,83 @@
+#include "build_cache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+const char* const DEFAULT_COMPILER = "g++";
+const char* const DEFAULT_FLAGS = "-std=gnu++17 -O2 -Wall";
+
+BuildCache::BuildCache(const std::string& dir)
+    : directory(dir.empty() ? defaultDir() : dir) {}
+
+std::string BuildCache::defaultDir() {
+    const char* cache = getenv("XDG_CACHE_HOME");
+    if (cache && *cache) return std::string(cache) + "/cp-editor";
+    const char* home = getenv("HOME");
+    if (home && *home) return std::string(home) + "/.cache/cp-editor";
+    return "/tmp/cp-editor-" + std::to_string(getuid());
+}
+
+std::vector<std::string> BuildCache::compiler() {
+    const char* cxx = getenv("CXX");
+    const char* flags = getenv("CXXFLAGS");
+    std::vector<std::string> command(1, cxx && *cxx ? cxx : DEFAULT_COMPILER);
+    std::istringstream words(flags ? flags : DEFAULT_FLAGS);
+    std::string word;
+    while (words >> word) command.push_back(word);
+    return command;
+}
+
+uint64_t BuildCache::key(const Snapshot& source,
+                         const std::vector<std::string>& command) {
+    uint64_t h = HASH_SEED;
+    for (const std::string& arg : command)
+        h = hashBytes(arg.c_str(), arg.size() + 1, h);  // with its NUL
+    return source.hash(h);
+}
+
+std::string BuildCache::path(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016" PRIx64, key);
+    return directory + name;
+}
+
+bool BuildCache::contains(uint64_t key) const {
+    return access(path(key).c_str(), X_OK) == 0;
+}
+
+// create dir and its parents like mkdir -p
+static bool makeDirectories(const std::string& dir) {
+    for (size_t i = 1; i <= dir.size(); ++i) {
+        if (i < dir.size() && dir[i] != '/') continue;
+        std::string part = dir.substr(0, i);
+        if (mkdir(part.c_str(), 0700) == -1 && errno != EEXIST) return false;
+    }
+    return true;
+}
+
+bool BuildCache::compileCommand(uint64_t key, const std::string& source,
+                                std::vector<std::string>& command) const {
+    if (!makeDirectories(directory)) return false;
+    command = compiler();
+    command.push_back(source);
+    command.push_back("-o");
+    command.push_back(tempPath(key));
+    return true;
+}
+
+bool BuildCache::commit(uint64_t key) const {
+    return rename(tempPath(key).c_str(), path(key).c_str()) == 0;
+}
+
+void BuildCache::discard(uint64_t key) const { unlink(tempPath(key).c_str()); }
+
+std::string BuildCache::tempPath(uint64_t key) const {
+    // another editor may compile the same key, each has a name of its own
+    return path(key) + ".tmp" + std::to_string(getpid());
+}
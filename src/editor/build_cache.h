@@ -0,0 +1,56 @@
+#ifndef CP_EDITOR_BUILD_CACHE_H
+#define CP_EDITOR_BUILD_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "snapshot.h"
+
+/**
+ * @brief compiled programs, found by a hash of their source and of the
+ * command that compiles them
+ *
+ * Compiling a file that didn't change since it was last compiled with the
+ * same command is skipped, the binary is taken from the cache. Binaries are
+ * compiled to a temporary name and renamed into place once the compiler
+ * succeeded, so a binary in the cache is always complete.
+ */
+class BuildCache {
+public:
+    // binaries go to dir, an empty dir means defaultDir()
+    explicit BuildCache(const std::string& dir = std::string());
+
+    // $XDG_CACHE_HOME/cp-editor, ~/.cache/cp-editor or under /tmp
+    static std::string defaultDir();
+    // $CXX and $CXXFLAGS, g++ and flags for contests when they aren't set
+    static std::vector<std::string> compiler();
+
+    const std::string& dir() const { return directory; }
+    // key of source compiled with command, which lacks the file names
+    static uint64_t key(const Snapshot& source,
+                        const std::vector<std::string>& command);
+    // where the binary of key is
+    std::string path(uint64_t key) const;
+    bool contains(uint64_t key) const;
+
+    /**
+     * @brief command compiling source for key
+     *
+     * The directory of the cache is created if needed.
+     * @return false with errno set if it can't be
+     */
+    bool compileCommand(uint64_t key, const std::string& source,
+                        std::vector<std::string>& command) const;
+    // the compiler succeeded, put the binary in place; false with errno set
+    bool commit(uint64_t key) const;
+    // the compiler failed, remove what it left
+    void discard(uint64_t key) const;
+
+private:
+    std::string tempPath(uint64_t key) const;
+
+    std::string directory;
+};
+
+#endif  // CP_EDITOR_BUILD_CACHE_H
@@ -0,0 +1,128 @@
+#include "child_process.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+extern char** environ;
+
+ChildProcess::ChildProcess() : pid(-1), fd(-1), waitStatus(0) {
+    memset(&used, 0, sizeof(used));
+}
+
+ChildProcess::~ChildProcess() { stop(); }
+
+bool ChildProcess::start(const std::vector<std::string>& argv,
+                         const std::string& input, bool withStderr) {
+    stop();
+    if (argv.empty()) {
+        errno = EINVAL;
+        return false;
+    }
+    int out[2];
+    if (pipe(out) == -1) return false;
+    fcntl(out[0], F_SETFL, fcntl(out[0], F_GETFL) | O_NONBLOCK);
+    fcntl(out[0], F_SETFD, FD_CLOEXEC);
+
+    std::vector<char*> args;
+    for (const std::string& arg : argv)
+        args.push_back(const_cast<char*>(arg.c_str()));
+    args.push_back(nullptr);
+
+    // posix_spawn only runs async-signal-safe code in the child, which
+    // fork() wouldn't guarantee with the saver and indexer threads around
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(
+        &actions, 0, input.empty() ? "/dev/null" : input.c_str(), O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out[1], 1);
+    if (withStderr)
+        posix_spawn_file_actions_adddup2(&actions, out[1], 2);
+    else
+        posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY,
+                                         0);
+    posix_spawn_file_actions_addclose(&actions, out[1]);
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+
+    int err = posix_spawnp(&pid, args[0], &actions, &attr, args.data(),
+                           environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(out[1]);
+    if (err != 0) {
+        pid = -1;
+        close(out[0]);
+        errno = err;
+        return false;
+    }
+    fd = out[0];
+    waitStatus = 0;
+    memset(&used, 0, sizeof(used));
+    started = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool ChildProcess::readOutput(std::string& out) {
+    bool read = false;
+    char buf[4096];
+    while (fd != -1) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            out.append(buf, n);
+            read = true;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            // EAGAIN means later, anything else is the end of the output
+            if (n == 0 || errno != EAGAIN) closeOutput();
+            break;
+        }
+    }
+    return read;
+}
+
+bool ChildProcess::finished() {
+    if (pid == -1) return true;
+    if (fd != -1) return false;
+    pid_t r;
+    while ((r = wait4(pid, &waitStatus, WNOHANG, &used)) == -1 &&
+           errno == EINTR) {
+    }
+    if (r == 0) return false;
+    reaped();
+    return true;
+}
+
+double ChildProcess::seconds() const {
+    std::chrono::steady_clock::time_point end =
+        pid == -1 ? ended : std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - started).count();
+}
+
+void ChildProcess::stop() {
+    closeOutput();
+    if (pid == -1) return;
+    kill(-pid, SIGKILL);
+    while (wait4(pid, &waitStatus, 0, &used) == -1 && errno == EINTR) {
+    }
+    reaped();
+}
+
+void ChildProcess::reaped() {
+    pid = -1;
+    ended = std::chrono::steady_clock::now();
+}
+
+void ChildProcess::closeOutput() {
+    if (fd == -1) return;
+    close(fd);
+    fd = -1;
+}
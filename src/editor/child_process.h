@@ -0,0 +1,67 @@
+#ifndef CP_EDITOR_CHILD_PROCESS_H
+#define CP_EDITOR_CHILD_PROCESS_H
+
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @brief a program run in the background, whose output is read without
+ * blocking
+ *
+ * Its stdout and stderr go to one pipe. The process leads a process group
+ * of its own, so stop() also reaches what it started, like the compiler
+ * proper under g++. What it used is taken from wait4() when it exits.
+ */
+class ChildProcess {
+public:
+    ChildProcess();
+    // stops the process if it still runs
+    ~ChildProcess();
+
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    /**
+     * @brief run argv[0], looked up in PATH
+     *
+     * @param input file for stdin, /dev/null if it is empty
+     * @param withStderr false to drop stderr rather than read it with stdout
+     * @return false with errno set on failure
+     */
+    bool start(const std::vector<std::string>& argv,
+               const std::string& input = std::string(),
+               bool withStderr = true);
+    // started and not waited for yet
+    bool running() const { return pid != -1; }
+    // end of the pipe to poll for output, -1 once it has all been read
+    int outputFd() const { return fd; }
+    // append the output available now to out, true if there was any
+    bool readOutput(std::string& out);
+    // true once the output is read and the process exited, status() is
+    // then its wait status
+    bool finished();
+    int status() const { return waitStatus; }
+    // resources used by the process once it is finished
+    const struct rusage& usage() const { return used; }
+    // wall time it ran, up to now while it runs
+    double seconds() const;
+    // kill the process group and wait for the process
+    void stop();
+
+private:
+    void closeOutput();
+
+    void reaped();
+
+    pid_t pid;
+    int fd;
+    int waitStatus;
+    struct rusage used;
+    std::chrono::steady_clock::time_point started, ended;
+};
+
+#endif  // CP_EDITOR_CHILD_PROCESS_H
@@ -0,0 +1,2252 @@
+#include "editor.h"
+
+#include <ctype.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "mapped_file.h"
+#include "search.h"
+#include "snapshot.h"
+
+EditorConfig g_E;
+
+/*** terminal ***/
+
+void writeTerminal(const void* buf, size_t n) {
+    if (write(STDOUT_FILENO,  // from unistd.h
+              buf, n)) {
+    } else {
+    }
+}
+
+void clearScreen(std::string& buf) {
+    buf += "\x1b[2J";  // \x1b -> escape character
+                       // \x1b[ instructs terminal to format texts
+                       // J command to clear screen
+                       // 2 for entire sreen
+    buf += "\x1b[H";   // H command to position the cursor
+}
+
+void die(const char* s) {
+    // clearScreen();
+    perror(s);
+    exit(1);
+}
+
+void wakeUp() {
+    if (g_E.wakePipe[1] == -1) return;  // nothing is waiting
+    int saved = errno;
+    if (write(g_E.wakePipe[1], "", 1)) {
+    }
+    errno = saved;
+}
+
+/*** editor ***/
+
+Document::Document(std::shared_ptr<BlockPool> pool)
+    : cursorX(0),
+      cursorY(0),
+      cursorRX(0),
+      rowOffset(0),
+      colOffset(0),
+      wrapSkip(0),
+      buffer(pool),
+      // keep a screen above and below the visible rows
+      renders(3 * std::max(g_E.screenRows, 0)),
+      highlight(false),
+      loaded(false),
+      modified(false),
+      viewing(false),
+      topOffset(0),
+      indexed(0),
+      indexDone(false),
+      wordsDone(false),
+      stopWords(false) {
+    undo.setLimit(UNDO_MEMORY_LIMIT);
+}
+
+Document::~Document() {
+    if (indexer.joinable()) indexer.join();
+    stopWords = true;
+    if (wordIndexer.joinable()) wordIndexer.join();
+}
+
+void initEditor() {
+    if (!g_E.pool) g_E.pool = TextBuffer::newPool();
+    g_E.documents.clear();
+    g_E.doc = nullptr;
+    g_E.saving = nullptr;
+    addDocument("").loaded = true;
+    g_E.current = 0;
+    g_E.doc = g_E.documents[0].get();
+
+    g_E.statusMsgTime = 0;
+    g_E.resized = 0;
+    g_E.saveDone = false;
+    g_E.search.active = false;
+    g_E.prompt.active = false;
+    g_E.completion.active = false;
+    g_E.build.process.stop();
+    g_E.build.samples.stop();
+    if (g_E.build.hasher.joinable()) g_E.build.hasher.join();
+    g_E.build.hashed = false;
+    g_E.build.step = BuildState::IDLE;
+    g_E.build.panel = false;
+    g_E.panelRows = 0;
+    g_E.wakePipe[0] = g_E.wakePipe[1] = -1;
+}
+
+void setWindowSize(int rows, int cols) {
+    g_E.windowRows = rows;
+    // the panel leaves at least a row of text
+    g_E.panelRows =
+        g_E.build.panel ? std::min(PANEL_ROWS, std::max(rows - 3, 0)) : 0;
+    g_E.screenRows = rows - 2 - g_E.panelRows;  // for status lines
+    g_E.screenCols = cols;
+
+    for (std::unique_ptr<Document>& doc : g_E.documents)
+        doc->renders.reset(3 * g_E.screenRows);
+    g_E.screen.resize(rows);
+
+    // room for a full redraw with a few escape sequences per column; a
+    // frame that needs more grows the buffers once and they stay that size
+    size_t row = 4 * g_E.screenCols + 32;
+    g_E.frame.row.reserve(row);
+    g_E.frame.out.reserve(rows * row);
+}
+
+Document& addDocument(const std::string& filename) {
+    g_E.documents.emplace_back(new Document(g_E.pool));
+    Document& doc = *g_E.documents.back();
+    doc.filename = filename;
+    return doc;
+}
+
+void showDocument(size_t i) {
+    g_E.current = i;
+    g_E.doc = g_E.documents[i].get();
+    g_E.screen.invalidate();
+    if (!g_E.doc->loaded) editorOpen(g_E.doc->filename);
+}
+
+void convertToRenderingRow(LineView line, RenderedLine& render) {
+    // replace tab by spaces up to the next tab stop
+    render.columns.build(line, TAB_SIZE);
+    render.columns.render(line, render.text);
+    render.highlighted = false;
+}
+
+/**
+ * @brief index the lines of file on other threads
+ *
+ * Meanwhile the file is shown read-only in the viewer, so the first screen
+ * doesn't wait for the whole file to be scanned. finishIndexing() loads it
+ * once the index is complete.
+ */
+void startIndexing(std::shared_ptr<MappedFile> file) {
+    Document& doc = *g_E.doc;
+    doc.viewing = true;
+    doc.highlight = false;
+    doc.topOffset = 0;
+    doc.indexing = file;
+    doc.indexed = 0;
+    doc.indexDone = false;
+    Document* indexed = &doc;
+    doc.indexer = std::thread([file, indexed]() {
+        file->indexLines(0, &indexed->indexed);
+        indexed->indexDone = true;
+        wakeUp();
+    });
+}
+
+void stopWordIndex(Document& doc) {
+    doc.stopWords = true;
+    if (doc.wordIndexer.joinable()) doc.wordIndexer.join();
+    doc.stopWords = false;
+    doc.wordsDone = false;
+    doc.words.clear();
+    doc.scannedWords.clear();
+}
+
+// scan the identifiers of the text on another thread
+void startWordIndex(Document& doc) {
+    stopWordIndex(doc);
+    std::shared_ptr<Snapshot> snapshot =
+        std::make_shared<Snapshot>(doc.buffer.snapshot());
+    Document* scanned = &doc;
+    doc.wordIndexer = std::thread([snapshot, scanned]() {
+        if (!scanned->scannedWords.addSnapshot(*snapshot, scanned->stopWords))
+            return;
+        scanned->wordsDone = true;
+        wakeUp();
+    });
+}
+
+/**
+ * @brief replay the swap journal an editor that didn't exit left for doc
+ *
+ * The journal is only replayed onto the version of the file it was made
+ * for. One made for another version is kept under a new name, so nothing
+ * overwrites the edits in it, and a file that isn't a journal is left
+ * alone.
+ */
+void recoverEdits(Document& doc) {
+    if (!doc.journal.attached()) return;
+    std::string path = doc.journal.path();
+    size_t edits, length;
+    char msg[160];
+    switch (SwapJournal::replay(path, doc.journal.base(), doc.buffer, edits,
+                                length)) {
+        case SwapJournal::NOTHING:
+            return;
+        case SwapJournal::RECOVERED:
+            if (!doc.journal.resume(length)) die("swap journal");
+            doc.renders.clear();
+            doc.syntax.clear();
+            doc.brackets.clear();
+            doc.modified = edits > 0;
+            snprintf(msg, sizeof(msg),
+                     "Recovered %zu edits from %.60s, Ctrl-s saves them",
+                     edits, path.c_str());
+            break;
+        case SwapJournal::FOREIGN:
+            doc.journal.detach();
+            snprintf(msg, sizeof(msg),
+                     "%.60s isn't a journal, edits aren't kept safe",
+                     path.c_str());
+            break;
+        case SwapJournal::OTHER_BASE: {
+            std::string kept;
+            if (doc.journal.setAside(kept))
+                snprintf(msg, sizeof(msg),
+                         "%.60s is for another version, kept as %.60s",
+                         path.c_str(), kept.c_str());
+            else
+                snprintf(msg, sizeof(msg),
+                         "Can't keep %.60s aside, edits aren't kept safe: %s",
+                         path.c_str(), strerror(errno));
+            break;
+        }
+    }
+    setStatusMessage(msg);
+}
+
+// the buffer of doc holds its file
+void documentLoaded(Document& doc) {
+    recoverEdits(doc);
+    startWordIndex(doc);
+    doc.wrap.clear();  // built again for the new text when it is shown
+    doc.wrapSkip = 0;
+}
+
+void finishIndexing() {
+    for (std::unique_ptr<Document>& d : g_E.documents) {
+        Document& doc = *d;
+        if (!doc.indexing || !doc.indexDone) continue;
+        if (doc.indexer.joinable()) doc.indexer.join();
+
+        doc.buffer.load(doc.indexing);
+        doc.renders.clear();
+        doc.undo.clear();
+        doc.highlight = SyntaxHighlighter::supports(doc.filename);
+        // stay on the line that is at the top of the viewer
+        doc.rowOffset = doc.cursorY = doc.indexing->lineOf(doc.topOffset);
+        doc.cursorX = 0;
+        doc.colOffset = 0;
+        doc.viewing = false;
+        doc.viewer.close();
+        doc.indexing.reset();
+        documentLoaded(doc);
+        if (&doc == g_E.doc) g_E.screen.invalidate();
+    }
+
+    for (std::unique_ptr<Document>& d : g_E.documents) {
+        Document& doc = *d;
+        if (!doc.wordsDone) continue;
+        if (doc.wordIndexer.joinable()) doc.wordIndexer.join();
+        doc.words.merge(doc.scannedWords);
+        doc.scannedWords.clear();
+        doc.wordsDone = false;
+    }
+}
+
+void editorOpen(const std::string& filename) {
+    Document& doc = *g_E.doc;
+    // forget what a file opened before left behind
+    if (doc.indexer.joinable()) doc.indexer.join();
+    doc.indexing.reset();
+    doc.viewing = false;
+    doc.viewer.close();
+    doc.journal.detach();
+    stopWordIndex(doc);
+
+    doc.filename = filename;
+    doc.loaded = true;
+    doc.highlight = SyntaxHighlighter::supports(filename);
+    doc.syntax.clear();
+    doc.brackets.clear();
+
+    struct stat st;
+    if (stat(filename.c_str(), &st) == 0 &&
+        static_cast<size_t>(st.st_size) >= g_E.viewThreshold) {
+        // nothing is read up front, the viewer maps what is on screen
+        if (doc.viewer.open(filename)) {
+            doc.viewing = true;
+            doc.highlight = false;
+            doc.topOffset = 0;
+            return;
+        }
+        if (errno != ENOENT) die("open");
+    }
+
+    if (g_E.journal && !filename.empty()) {
+        std::string swap = SwapJournal::pathFor(filename);
+        if (!doc.journal.attach(swap, SwapJournal::baseOf(filename))) {
+            char msg[160];
+            if (errno == EWOULDBLOCK)
+                snprintf(msg, sizeof(msg),
+                         "%.60s is in use, edits aren't kept safe",
+                         swap.c_str());
+            else
+                snprintf(msg, sizeof(msg), "Edits aren't kept safe, %.60s: %s",
+                         swap.c_str(), strerror(errno));
+            setStatusMessage(msg);
+        }
+    }
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->map(filename)) {
+        if (errno != ENOENT) die("open");
+        // start a new file, unless one was being written
+        documentLoaded(doc);
+        return;
+    }
+    if (file->size() >= BACKGROUND_INDEX_THRESHOLD &&
+        doc.viewer.open(filename)) {
+        startIndexing(file);
+        return;
+    }
+    file->indexLines();
+    doc.buffer.load(file);
+    doc.renders.clear();
+    doc.undo.clear();
+    documentLoaded(doc);
+}
+
+RenderedLine& renderedLine(int y) {
+    Document& doc = *g_E.doc;
+    RenderedLine* render = doc.renders.find(y);
+    if (render) return *render;
+
+    RenderedLine& fresh = doc.renders.put(y);
+    convertToRenderingRow(doc.buffer.line(y), fresh);
+    return fresh;
+}
+
+// rendered line y with its syntax classes up to date
+const RenderedLine& highlightedLine(int y) {
+    Document& doc = *g_E.doc;
+    RenderedLine& render = renderedLine(y);
+    if (!doc.highlight) return render;
+
+    SyntaxHighlighter::State state = doc.syntax.stateBefore(doc.buffer, y);
+    if (!render.highlighted || render.syntaxState != state) {
+        std::vector<unsigned char>& classes = g_E.frame.classes;
+        doc.syntax.highlight(doc.buffer.line(y), state, classes);
+        render.columns.render(classes, render.highlight);
+        render.highlighted = true;
+        render.syntaxState = state;
+    }
+    return render;
+}
+
+// invalidate the rows whose highlight changed through edits above them
+void checkHighlights() {
+    Document& doc = *g_E.doc;
+    for (int y = 0; y < g_E.screenRows; ++y) {
+        int filerow = y + doc.rowOffset;
+        if (filerow >= doc.buffer.lineCount()) break;
+        const RenderedLine* render = doc.renders.find(filerow);
+        if (!render || !render->highlighted ||
+            render->syntaxState != doc.syntax.stateBefore(doc.buffer, filerow))
+            g_E.screen.invalidateRow(y);
+    }
+}
+
+// rendered width of line y
+size_t lineWidth(size_t y) {
+    Document& doc = *g_E.doc;
+    const RenderedLine* render = doc.renders.find(y);
+    if (render) return render->columns.renderWidth();
+    ColumnIndex& columns = g_E.frame.widthLine;
+    columns.build(doc.buffer.line(y), TAB_SIZE);
+    return columns.renderWidth();
+}
+
+// line y was modified
+void lineChanged(int y) {
+    Document& doc = *g_E.doc;
+    doc.renders.invalidate(y);
+    doc.syntax.invalidate(y);
+    doc.brackets.invalidate(y);
+    if (doc.wrap.built()) doc.wrap.setWidth(y, lineWidth(y));
+    // wrapped lines below may move by rows, compose them all again
+    if (g_E.wrapLines)
+        g_E.screen.invalidate();
+    else
+        g_E.screen.invalidateRow(y - doc.rowOffset);
+}
+
+// n lines were inserted before line y
+void linesInserted(int y, int n) {
+    Document& doc = *g_E.doc;
+    doc.renders.insertLines(y, n);
+    doc.syntax.insertLines(y, n);
+    doc.brackets.insertLines(y, n);
+    if (doc.wrap.built()) {
+        doc.wrap.insertLines(y, n);
+        for (int i = y; i < y + n; ++i) doc.wrap.setWidth(i, lineWidth(i));
+    }
+    g_E.screen.invalidateFrom(g_E.wrapLines ? 0 : y - doc.rowOffset);
+}
+
+// lines [y, y + n) were erased
+void linesErased(int y, int n) {
+    Document& doc = *g_E.doc;
+    doc.renders.eraseLines(y, n);
+    doc.syntax.eraseLines(y, n);
+    doc.brackets.eraseLines(y, n);
+    doc.wrap.eraseLines(y, n);
+    g_E.screen.invalidateFrom(g_E.wrapLines ? 0 : y - doc.rowOffset);
+}
+
+/*** soft wrap ***/
+
+bool wrapping() { return g_E.wrapLines && !g_E.doc->viewing; }
+
+// screen row of the file, counting the wrapped rows, at the top
+size_t topWrappedRow() {
+    Document& doc = *g_E.doc;
+    return doc.wrap.rowOf(doc.rowOffset) + doc.wrapSkip;
+}
+
+size_t cursorWrappedRow() {
+    Document& doc = *g_E.doc;
+    size_t row = doc.wrap.rowOf(doc.cursorY);
+    if (doc.cursorY < doc.buffer.lineCount())
+        row += doc.cursorRX / doc.wrap.columns();
+    return row;
+}
+
+// editorScroll() with soft wrap: the screen shows rows, not lines
+void scrollWrapped(std::string& buf) {
+    Document& doc = *g_E.doc;
+    WrapIndex& wrap = doc.wrap;
+    size_t cols = std::max(g_E.screenCols, 1);
+    if (!wrap.built())
+        wrap.build(doc.buffer.lineCount(), cols, lineWidth);
+    else
+        wrap.setColumns(cols);  // after SIGWINCH, only long lines change
+    doc.colOffset = 0;
+    if (static_cast<size_t>(doc.rowOffset) < wrap.lineCount())
+        doc.wrapSkip = std::min(doc.wrapSkip, wrap.rowsOf(doc.rowOffset) - 1);
+    else
+        doc.wrapSkip = 0;
+
+    size_t rows = g_E.screenRows;
+    size_t top = topWrappedRow(), cursor = cursorWrappedRow();
+    size_t next = top;
+    if (cursor < top) next = cursor;
+    if (cursor >= top + rows) next = cursor - rows + 1;
+    if (next == top) return;
+    doc.rowOffset = wrap.lineAt(next, doc.wrapSkip);
+    g_E.screen.scroll(0, g_E.screenRows,
+                      static_cast<long>(next) - static_cast<long>(top), buf);
+}
+
+// soft wrap on or off, with Ctrl-w
+void toggleWrap() {
+    g_E.wrapLines = !g_E.wrapLines;
+    for (std::unique_ptr<Document>& doc : g_E.documents) {
+        doc->wrapSkip = 0;
+        if (!g_E.wrapLines) doc->wrap.clear();
+    }
+    g_E.screen.invalidate();
+    setStatusMessage(g_E.wrapLines ? "Soft wrap on" : "Soft wrap off");
+}
+
+// keep the cursor on screen; the escape sequences of a scroll go to buf
+void editorScroll(std::string& buf) {
+    Document& doc = *g_E.doc;
+    int rowOffset = doc.rowOffset, colOffset = doc.colOffset;
+
+    doc.cursorRX = 0;
+    if (doc.cursorY < doc.buffer.lineCount()) {
+        // tab key
+        doc.cursorRX =
+            renderedLine(doc.cursorY).columns.renderColumn(doc.cursorX);
+    }
+
+    if (wrapping()) {
+        if (doc.colOffset != 0) g_E.screen.invalidate();
+        scrollWrapped(buf);
+        return;
+    }
+
+    if (doc.cursorRX < doc.colOffset) {
+        doc.colOffset = doc.cursorRX;
+    }
+    if (doc.cursorRX >= doc.colOffset + g_E.screenCols) {
+        doc.colOffset = doc.cursorRX - g_E.screenCols + 1;
+    }
+    if (doc.cursorY < doc.rowOffset) {
+        doc.rowOffset = doc.cursorY;
+    }
+    if (doc.cursorY >= doc.rowOffset + g_E.screenRows) {
+        doc.rowOffset = doc.cursorY - g_E.screenRows + 1;
+    }
+
+    if (doc.colOffset != colOffset) {
+        g_E.screen.invalidate();
+    } else if (doc.rowOffset != rowOffset) {
+        // have the terminal move the rows it shows, only the ones that come
+        // into view are drawn
+        g_E.screen.scroll(0, g_E.screenRows, doc.rowOffset - rowOffset, buf);
+    }
+}
+
+void snapCursor();
+
+void moveCursor(int key) {
+    Document& doc = *g_E.doc;
+    LineView currentLine = (doc.cursorY >= doc.buffer.lineCount())
+                               ? LineView()
+                               : doc.buffer.line(doc.cursorY);
+    doc.undo.seal();  // typing after a move starts a new undo step
+    switch (key) {
+        case ARROW_LEFT:
+            if (doc.cursorX > 0) {  // not first character in current line
+                const ColumnIndex& columns = renderedLine(doc.cursorY).columns;
+                doc.cursorX = columns.charStart(doc.cursorX - 1);
+            } else if (doc.cursorY > 0) {  // not first line
+                // move cursor to the end of previous line
+                doc.cursorY--;
+                doc.cursorX = doc.buffer.line(doc.cursorY).size();
+            }
+            break;
+        case ARROW_RIGHT:
+            // limit cursor to the end of current line
+            if (currentLine.size() > 0 && doc.cursorX < currentLine.size())
+                doc.cursorX =
+                    renderedLine(doc.cursorY).columns.charEnd(doc.cursorX);
+            else if (doc.cursorY < doc.buffer.lineCount() &&
+                     doc.cursorX == currentLine.size()) {
+                // move cursor to the beginning of next line
+                doc.cursorY++;
+                doc.cursorX = 0;
+            }
+            break;
+        case ARROW_UP:
+            if (doc.cursorY > 0) doc.cursorY--;
+            break;
+        case ARROW_DOWN:
+            if (doc.cursorY < doc.buffer.lineCount()) doc.cursorY++;
+            break;
+    }
+    snapCursor();
+}
+
+// put the cursor back on its line after cursorY moved
+void snapCursor() {
+    Document& doc = *g_E.doc;
+    // snap back to the end of line if curosr is moved to the past of line
+    LineView currentLine = (doc.cursorY >= doc.buffer.lineCount())
+                               ? LineView()
+                               : doc.buffer.line(doc.cursorY);
+    int rowLen = currentLine.size() ? currentLine.size() : 0;
+    if (doc.cursorX > rowLen) doc.cursorX = rowLen;
+    // and to the start of a character a vertical move may end inside
+    if (doc.cursorX > 0)
+        doc.cursorX = renderedLine(doc.cursorY).columns.charStart(doc.cursorX);
+}
+
+/**
+ * @brief move the cursor straight to line y, in the column it is in
+ *
+ * Only line y is looked at, so jumps of any length cost one lookup in the
+ * buffer, which is O(log n).
+ */
+void moveCursorToLine(size_t y) {
+    Document& doc = *g_E.doc;
+    doc.undo.seal();
+    doc.cursorY = std::min(y, doc.buffer.lineCount());
+    snapCursor();
+}
+
+// a page up or down from the rows on screen
+void movePage(int key) {
+    Document& doc = *g_E.doc;
+    size_t top = doc.rowOffset;
+    size_t rows = g_E.screenRows;
+    if (key == PAGE_UP)
+        moveCursorToLine(top > rows ? top - rows : 0);
+    else
+        moveCursorToLine(top + 2 * rows - 1);
+}
+
+// the start of the next word, or of the previous one if back is set,
+// going to the next or the previous line at the ends of a line
+void moveWord(bool back) {
+    Document& doc = *g_E.doc;
+    doc.undo.seal();
+    if (doc.cursorY >= doc.buffer.lineCount()) {
+        if (back && doc.cursorY > 0) moveCursor(ARROW_LEFT);
+        return;
+    }
+    LineView line = doc.buffer.line(doc.cursorY);
+    size_t x = doc.cursorX;
+    if (back) {
+        if (x == 0) {
+            moveCursor(ARROW_LEFT);
+            return;
+        }
+        while (x > 0 && !IdentifierIndex::isWordChar(line[x - 1])) x--;
+        while (x > 0 && IdentifierIndex::isWordChar(line[x - 1])) x--;
+    } else {
+        if (x >= line.size()) {
+            moveCursor(ARROW_RIGHT);
+            if (doc.cursorY >= doc.buffer.lineCount()) return;
+            line = doc.buffer.line(doc.cursorY);
+            x = 0;
+        } else {
+            while (x < line.size() && IdentifierIndex::isWordChar(line[x])) x++;
+        }
+        while (x < line.size() && !IdentifierIndex::isWordChar(line[x])) x++;
+    }
+    doc.cursorX = x;
+}
+
+// go to the line typed at the Ctrl-g prompt
+void jumpToLine(const std::string& text) {
+    char* end;
+    errno = 0;
+    unsigned long long n = strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str() || errno != 0 || *end != '\0' || n == 0) {
+        setStatusMessage("Not a line number: " + text);
+        return;
+    }
+    size_t last = std::max<size_t>(g_E.doc->buffer.lineCount(), 1);
+    moveCursorToLine(std::min<unsigned long long>(n, last) - 1);
+}
+
+void setStatusMessage(const std::string& msg) {
+    g_E.statusMsg = msg;
+    g_E.statusMsgTime = time(nullptr);
+}
+
+/**
+ * @brief write the buffer to its file in the background
+ *
+ * The thread works on a snapshot, so editing can go on while it runs, and
+ * the file is replaced atomically once everything is on disk. A keyed save
+ * also finds the key of the binary of the snapshot for the build.
+ */
+void save(bool keyed) {
+    Document& doc = *g_E.doc;
+    if (doc.filename.size() == 0) return;
+    if (g_E.saver.joinable()) {
+        setStatusMessage("Still saving the previous version...");
+        return;
+    }
+
+    std::shared_ptr<Snapshot> snapshot =
+        std::make_shared<Snapshot>(doc.buffer.snapshot());
+    std::string filename = doc.filename;
+    doc.modified = false;  // edits made while saving set it again
+    doc.journal.checkpoint();
+    g_E.saving = &doc;
+    g_E.saveDone = false;
+    std::vector<std::string> command;
+    if (keyed) command = BuildCache::compiler();
+    g_E.saver = std::thread([snapshot, filename, keyed, command]() {
+        g_E.saveError = saveAtomically(*snapshot, filename) ? 0 : errno;
+        g_E.savedBytes = snapshot->size();
+        if (keyed) g_E.build.key = BuildCache::key(*snapshot, command);
+        g_E.saveDone = true;
+        wakeUp();
+    });
+}
+
+void flushJournals() {
+    for (std::unique_ptr<Document>& doc : g_E.documents) {
+        if (doc->journal.pending() == 0 || doc->journal.flush()) continue;
+        char msg[80];
+        snprintf(msg, sizeof(msg), "Edits aren't kept safe, %.30s: %s",
+                 doc->journal.path().c_str(), strerror(errno));
+        setStatusMessage(msg);
+    }
+}
+
+void findBinary();  // see build below
+
+// report the result of a background save once it is done
+void finishSave() {
+    if (!g_E.saver.joinable() || !g_E.saveDone) return;
+    g_E.saver.join();
+
+    char msg[80];
+    if (g_E.saveError == 0) {
+        snprintf(msg, sizeof(msg), "%zu bytes written to disk", g_E.savedBytes);
+        // the journal only has to hold what was edited since
+        Document* doc = g_E.saving;
+        if (doc && !doc->journal.rebase(SwapJournal::baseOf(doc->filename)))
+            snprintf(msg, sizeof(msg), "Saved, but can't reset %.30s: %s",
+                     doc->journal.path().c_str(), strerror(errno));
+    } else {
+        if (g_E.saving) g_E.saving->modified = true;
+        snprintf(msg, sizeof(msg), "Can't save! I/O error: %s",
+                 strerror(g_E.saveError));
+    }
+    setStatusMessage(msg);
+
+    // a build waits for the file it compiles
+    BuildState& build = g_E.build;
+    if (build.step == BuildState::SAVING) {
+        if (g_E.saveError == 0) {
+            findBinary();
+        } else {
+            build.step = BuildState::IDLE;
+            build.title = "Not compiled, " + build.file + " can't be saved";
+        }
+    }
+}
+
+TextPosition cursorPosition() {
+    Document& doc = *g_E.doc;
+    return TextPosition{static_cast<size_t>(doc.cursorY),
+                        static_cast<size_t>(doc.cursorX)};
+}
+
+void setCursor(TextPosition pos) {
+    Document& doc = *g_E.doc;
+    doc.cursorY = pos.y;
+    doc.cursorX = pos.x;
+}
+
+// insert text at (y, x) and return where it ends
+TextPosition insertTextAt(int y, int x, const std::string& text) {
+    Document& doc = *g_E.doc;
+    doc.words.remove(doc.buffer.line(y));
+    doc.buffer.insertText(y, x, text);
+    doc.journal.recordInsert(y, x, text);
+
+    TextPosition end{static_cast<size_t>(y), x + text.size()};
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\n') {
+            end.y++;
+            end.x = text.size() - i - 1;
+        }
+    }
+    for (size_t i = y; i <= end.y; ++i) doc.words.add(doc.buffer.line(i));
+    lineChanged(y);
+    if (end.y > y) linesInserted(y + 1, end.y - y);
+    doc.modified = true;
+    return end;
+}
+
+// erase text, which must be what the buffer holds at (y, x)
+void eraseTextAt(int y, int x, const std::string& text) {
+    Document& doc = *g_E.doc;
+    int lines = 0;
+    for (auto c : text)
+        if (c == '\n') lines++;
+    for (int i = y; i <= y + lines; ++i) doc.words.remove(doc.buffer.line(i));
+    doc.buffer.eraseText(y, x, text.size());
+    doc.journal.recordErase(y, x, text.size());
+    doc.words.add(doc.buffer.line(y));
+    lineChanged(y);
+    if (lines > 0) linesErased(y + 1, lines);
+    doc.modified = true;
+}
+
+// make the line y after the last one editable, inside an undo group
+void ensureLine(int y) {
+    Document& doc = *g_E.doc;
+    if (y > 0) {
+        // same as breaking the last line, so undo can take it back
+        TextPosition end{static_cast<size_t>(y - 1),
+                         doc.buffer.line(y - 1).size()};
+        insertTextAt(end.y, end.x, "\n");
+        doc.undo.recordInsert(end.y, end.x, "\n", cursorPosition(),
+                              cursorPosition());
+    } else {
+        // the first line of an empty buffer, the swap journal keeps it too
+        doc.buffer.appendLine("");
+        doc.journal.recordInsert(0, 0, "");
+        linesInserted(y, 1);
+    }
+}
+
+void insertAtCursor(const std::string& text) {
+    Document& doc = *g_E.doc;
+    // typing below the last line makes the line as part of the same edit,
+    // and the keys typed after it still join the text
+    bool below = doc.cursorY >= doc.buffer.lineCount();
+    if (below) {
+        doc.undo.seal();
+        doc.undo.beginGroup();
+        ensureLine(doc.cursorY);
+    }
+    TextPosition before = cursorPosition();
+    TextPosition after = insertTextAt(before.y, before.x, text);
+    doc.undo.recordInsert(before.y, before.x, text, before, after);
+    if (below) doc.undo.endGroup(true);
+    setCursor(after);
+}
+
+void deleteChar() {
+    Document& doc = *g_E.doc;
+    if (doc.cursorY == doc.buffer.lineCount()) return;
+    if (doc.cursorY == 0 && doc.cursorX == 0) return;
+    TextPosition before = cursorPosition();
+    TextPosition from;
+    std::string text;
+    if (doc.cursorX > 0) {
+        // the whole character before the cursor
+        size_t x = renderedLine(before.y).columns.charStart(before.x - 1);
+        from = TextPosition{before.y, x};
+        text = doc.buffer.line(from.y).substr(x, before.x - x).str();
+    } else {  // back space at the start of line
+        from = TextPosition{before.y - 1, doc.buffer.line(before.y - 1).size()};
+        text = "\n";
+    }
+    eraseTextAt(from.y, from.x, text);
+    doc.undo.recordErase(from.y, from.x, text, before, from);
+    setCursor(from);
+}
+
+void insertLine() { insertAtCursor("\n"); }
+
+void insertText(const std::string& pasted) {
+    // terminals send the line breaks of a paste as carriage returns
+    std::string text;
+    text.reserve(pasted.size());
+    for (size_t i = 0; i < pasted.size(); ++i) {
+        if (pasted[i] == '\r') {
+            text += '\n';
+            if (i + 1 < pasted.size() && pasted[i + 1] == '\n') i++;
+        } else {
+            text += pasted[i];
+        }
+    }
+    if (!text.empty()) insertAtCursor(text);
+}
+
+void replaceTextAt(const std::vector<TextPosition>& at, size_t n,
+                   const std::string& text);  // see replace below
+
+void undoEdit(bool redo) {
+    Document& doc = *g_E.doc;
+    UndoJournal::Step step;
+    if (!(redo ? doc.undo.redo(step) : doc.undo.undo(step))) {
+        setStatusMessage(redo ? "Nothing to redo" : "Nothing to undo");
+        return;
+    }
+    while (true) {
+        if (step.replace)
+            replaceTextAt(step.at, step.n, step.text);
+        else if (step.insert)
+            insertTextAt(step.y, step.x, step.text);
+        else
+            eraseTextAt(step.y, step.x, step.text);
+        // the steps of a column edit go back all at once
+        if (!step.more || !(redo ? doc.undo.redo(step) : doc.undo.undo(step)))
+            break;
+    }
+    setCursor(step.cursor);
+}
+
+/*** column cursors ***/
+
+void clearColumnCursors() {
+    Document& doc = *g_E.doc;
+    if (doc.cursors.empty()) return;
+    doc.cursors.clear();
+    g_E.screen.invalidate();
+}
+
+// add a cursor above or below the column of cursors with Alt-Up/Alt-Down,
+// or take the last one away when going back over it
+void extendColumn(int key) {
+    Document& doc = *g_E.doc;
+    int y = doc.cursorY + (key == ALT_DOWN ? 1 : -1);
+    if (y < 0 || y >= static_cast<int>(doc.buffer.lineCount())) return;
+    std::vector<TextPosition>& cursors = doc.cursors;
+    size_t i = 0;
+    while (i < cursors.size() && cursors[i].y != static_cast<size_t>(y)) i++;
+    if (i < cursors.size())
+        cursors.erase(cursors.begin() + i);
+    else
+        cursors.push_back(cursorPosition());
+    moveCursor(key == ALT_DOWN ? ARROW_DOWN : ARROW_UP);
+    g_E.screen.invalidate();
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "%zu cursors, Esc leaves them",
+             cursors.size() + 1);
+    setStatusMessage(cursors.empty() ? "" : msg);
+}
+
+/**
+ * @brief make the same edit at every cursor as one step
+ *
+ * edit(y, x) makes the edit at column x of line y and returns the new
+ * column of the cursor there. The edits are one undo record and cursors
+ * never share a line, so they don't move each other.
+ */
+template <typename F>
+void editColumns(F edit) {
+    Document& doc = *g_E.doc;
+    doc.undo.seal();
+    doc.undo.beginGroup();
+    doc.cursorX = edit(doc.cursorY, doc.cursorX);
+    for (TextPosition& cursor : doc.cursors)
+        cursor.x = edit(cursor.y, cursor.x);
+    doc.undo.endGroup();
+}
+
+void insertColumns(const std::string& text) {
+    Document& doc = *g_E.doc;
+    TextPosition before = cursorPosition();
+    TextPosition after{before.y, before.x + text.size()};
+    editColumns([&](size_t y, size_t x) -> size_t {
+        insertTextAt(y, x, text);
+        doc.undo.recordInsert(y, x, text, before, after);
+        return x + text.size();
+    });
+}
+
+// the character before every cursor, or after them with Delete
+void eraseColumns(bool backward) {
+    Document& doc = *g_E.doc;
+    TextPosition before = cursorPosition(), after = before;
+    editColumns([&](size_t y, size_t x) -> size_t {
+        LineView line = doc.buffer.line(y);
+        const ColumnIndex& columns = renderedLine(y).columns;
+        size_t from = x, to = x;
+        if (backward && x > 0)
+            from = columns.charStart(x - 1);
+        else if (!backward && x < line.size())
+            to = columns.charEnd(x);
+        if (from == to) return x;  // lines don't join
+        std::string text = line.substr(from, to - from).str();
+        eraseTextAt(y, from, text);
+        if (y == before.y) after.x = from;  // the main cursor comes first
+        doc.undo.recordErase(y, from, text, before, after);
+        return from;
+    });
+}
+
+void moveColumns(int key) {
+    Document& doc = *g_E.doc;
+    doc.undo.seal();
+    auto move = [&doc, key](size_t y, size_t x) -> size_t {
+        size_t length = doc.buffer.line(y).size();
+        const ColumnIndex& columns = renderedLine(y).columns;
+        switch (key) {
+            case ARROW_LEFT:
+                return x > 0 ? columns.charStart(x - 1) : 0;
+            case ARROW_RIGHT:
+                return x < length ? columns.charEnd(x) : length;
+            case HOME_KEY:
+                return 0;
+            default:
+                return length;
+        }
+    };
+    doc.cursorX = move(doc.cursorY, doc.cursorX);
+    for (TextPosition& cursor : doc.cursors)
+        cursor.x = move(cursor.y, cursor.x);
+    g_E.screen.invalidate();
+}
+
+/**
+ * @brief keys with column cursors
+ * @return false for the keys processKey() handles, all but Alt-Up and
+ * Alt-Down leave the column cursors
+ */
+bool processColumnKey(int c) {
+    switch (c) {
+        case ALT_UP:
+        case ALT_DOWN:
+            return false;
+        case BACKSPACE:
+        case ctrlWith('h'):
+        case DEL_KEY:
+            eraseColumns(c != DEL_KEY);
+            return true;
+        case ARROW_LEFT:
+        case ARROW_RIGHT:
+        case HOME_KEY:
+        case END_KEY:
+            moveColumns(c);
+            return true;
+        case '\x1b':
+            clearColumnCursors();
+            return true;
+        case PASTE:
+            if (g_E.input.paste().find_first_of("\r\n") == std::string::npos) {
+                insertColumns(g_E.input.paste());
+                return true;
+            }
+            break;
+        default:
+            if (c == '\t' || (c >= ' ' && c < 256 && c != BACKSPACE)) {
+                insertColumns(std::string(1, static_cast<char>(c)));
+                return true;
+            }
+            break;
+    }
+    clearColumnCursors();
+    return false;
+}
+
+/*** completion ***/
+
+/**
+ * @brief complete the identifier before the cursor
+ *
+ * The candidates are the identifiers of the text that start with what was
+ * typed, the most frequent first. Pressing Ctrl-n again replaces the
+ * candidate by the next one, any other key keeps it.
+ */
+void completeWord() {
+    Document& doc = *g_E.doc;
+    CompletionState& completion = g_E.completion;
+    if (completion.active) {
+        // take the last candidate back
+        const std::string& last = completion.candidates[completion.choice];
+        std::string rest = last.substr(completion.prefix.size());
+        TextPosition before = cursorPosition();
+        TextPosition from{completion.y,
+                          completion.x + completion.prefix.size()};
+        eraseTextAt(from.y, from.x, rest);
+        doc.undo.recordErase(from.y, from.x, rest, before, from);
+        setCursor(from);
+        completion.choice =
+            (completion.choice + 1) % completion.candidates.size();
+    } else {
+        if (doc.cursorY >= doc.buffer.lineCount()) return;
+        LineView line = doc.buffer.line(doc.cursorY);
+        size_t x = doc.cursorX;
+        while (x > 0 && IdentifierIndex::isWordChar(line[x - 1])) x--;
+        if (x == static_cast<size_t>(doc.cursorX) || isdigit(line[x])) {
+            setStatusMessage("No identifier before the cursor to complete");
+            return;
+        }
+        completion.prefix = line.substr(x, doc.cursorX - x).str();
+        doc.words.complete(completion.prefix, COMPLETION_LIMIT,
+                           completion.candidates);
+        if (completion.candidates.empty()) {
+            setStatusMessage("Nothing completes " + completion.prefix);
+            return;
+        }
+        completion.active = true;
+        completion.y = doc.cursorY;
+        completion.x = x;
+        completion.choice = 0;
+    }
+    insertAtCursor(completion.candidates[completion.choice].substr(
+        completion.prefix.size()));
+}
+
+/*** brackets ***/
+
+// the bracket at the cursor, or else the one just before it
+bool bracketAtCursor(TextPosition& at) {
+    Document& doc = *g_E.doc;
+    if (doc.cursorY >= doc.buffer.lineCount()) return false;
+    LineView line = doc.buffer.line(doc.cursorY);
+    size_t x = doc.cursorX;
+    if (x < line.size() && BracketIndex::isBracket(line[x])) {
+        at = TextPosition{static_cast<size_t>(doc.cursorY), x};
+        return true;
+    }
+    if (x > 0 && x <= line.size() && BracketIndex::isBracket(line[x - 1])) {
+        at = TextPosition{static_cast<size_t>(doc.cursorY), x - 1};
+        return true;
+    }
+    return false;
+}
+
+// redraw the rows of the brackets that stop or start being highlighted
+void showBrackets() {
+    Document& doc = *g_E.doc;
+    BracketPair now = BracketPair();
+    bool bracket = !doc.viewing && bracketAtCursor(now.at);
+    now.shown = bracket && doc.brackets.match(doc.buffer, now.at, now.match);
+    now.pending = bracket && doc.brackets.pending();
+
+    BracketPair& shown = g_E.brackets;
+    shown.pending = now.pending;
+    if (now.shown == shown.shown &&
+        (!now.shown ||
+         (now.at.y == shown.at.y && now.at.x == shown.at.x &&
+          now.match.y == shown.match.y && now.match.x == shown.match.x)))
+        return;
+    if (wrapping()) g_E.screen.invalidate();  // rows aren't lines
+    for (const BracketPair* pair : {&shown, &now}) {
+        if (!pair->shown) continue;
+        g_E.screen.invalidateRow(pair->at.y - doc.rowOffset);
+        g_E.screen.invalidateRow(pair->match.y - doc.rowOffset);
+    }
+    shown = now;
+}
+
+// move the cursor to the bracket matching the one at it, with Ctrl-]
+void jumpToBracket() {
+    Document& doc = *g_E.doc;
+    TextPosition at, match;
+    if (!bracketAtCursor(at)) {
+        setStatusMessage("No bracket at the cursor");
+        return;
+    }
+    if (!doc.brackets.match(doc.buffer, at, match)) {
+        setStatusMessage(doc.brackets.pending()
+                             ? "Still reading the file, try again"
+                             : "Nothing matches this bracket");
+        return;
+    }
+    setCursor(match);
+}
+
+/*** search ***/
+void startSearch() {
+    Document& doc = *g_E.doc;
+    SearchState& search = g_E.search;
+    search.active = true;
+    search.query.clear();
+    search.found = false;
+    search.match = cursorPosition();
+    search.savedX = doc.cursorX;
+    search.savedY = doc.cursorY;
+    search.savedRowOffset = doc.rowOffset;
+    search.savedColOffset = doc.colOffset;
+    doc.undo.seal();
+}
+
+void endSearch(bool restore) {
+    Document& doc = *g_E.doc;
+    SearchState& search = g_E.search;
+    search.active = false;
+    if (restore) {
+        doc.cursorX = search.savedX;
+        doc.cursorY = search.savedY;
+        doc.rowOffset = search.savedRowOffset;
+        doc.colOffset = search.savedColOffset;
+    }
+    g_E.screen.invalidate();  // remove the highlights
+}
+
+// move to the next match of the query from the last one, wrapping around
+void findMatch(bool forward, bool skipCurrent) {
+    Document& doc = *g_E.doc;
+    SearchState& search = g_E.search;
+    TextPosition from = search.match;
+    TextPosition match;
+    bool found;
+    if (forward) {
+        if (skipCurrent) from.x++;
+        found = doc.buffer.search(search.query, from, match) ||
+                doc.buffer.search(search.query, TextPosition{0, 0}, match);
+    } else {
+        TextPosition end{doc.buffer.lineCount(), 0};
+        found = doc.buffer.searchBackward(search.query, from, match) ||
+                doc.buffer.searchBackward(search.query, end, match);
+    }
+    search.found = found;
+    if (found) {
+        search.match = match;
+        doc.cursorY = match.y;
+        doc.cursorX = match.x;
+    }
+    g_E.screen.invalidate();
+}
+
+void processSearchKey(int c) {
+    SearchState& search = g_E.search;
+    switch (c) {
+        case '\x1b':
+            endSearch(true);
+            break;
+        case '\r':
+            endSearch(false);
+            break;
+
+        case ARROW_RIGHT:
+        case ARROW_DOWN:
+            if (search.found) findMatch(true, true);
+            break;
+        case ARROW_LEFT:
+        case ARROW_UP:
+            if (search.found) findMatch(false, false);
+            break;
+
+        case BACKSPACE:
+        case ctrlWith('h'):
+        case DEL_KEY:
+            if (search.query.empty()) break;
+            search.query.pop_back();
+            // a shorter query matches at least where the longer one did
+            if (search.query.empty()) {
+                search.found = false;
+                g_E.screen.invalidate();
+            } else {
+                findMatch(true, false);
+            }
+            break;
+
+        default:
+            if (c < 128 && isprint(c)) {
+                search.query += static_cast<char>(c);
+                // the longer query can only match from the current match on
+                findMatch(true, false);
+            } else {
+                // any other command finishes the search and runs as usual
+                endSearch(false);
+                processKey(c);
+            }
+            break;
+    }
+}
+
+/*** replace ***/
+
+/**
+ * @brief replace the n characters at each position of at by text
+ *
+ * The buffer takes all the replacements in one edit, and the caches of the
+ * lines are dropped once instead of line by line.
+ */
+void replaceTextAt(const std::vector<TextPosition>& at, size_t n,
+                   const std::string& text) {
+    Document& doc = *g_E.doc;
+    doc.buffer.replaceAll(at, n, text);
+    doc.journal.recordReplace(at, n, text);
+    doc.renders.clear();
+    doc.syntax.clear();
+    doc.brackets.clear();
+    if (doc.wrap.built()) {
+        for (size_t i = 0; i < at.size(); ++i)
+            if (i == 0 || at[i].y != at[i - 1].y)
+                doc.wrap.setWidth(at[i].y, lineWidth(at[i].y));
+    }
+    startWordIndex(doc);  // counted again from the text, on a thread
+    g_E.screen.invalidate();
+    doc.modified = true;
+}
+
+// replace every g_E.replaced by the text typed at the prompt, as one edit
+// that undo takes back at once
+void replaceAll(const std::string& with) {
+    Document& doc = *g_E.doc;
+    const std::string& needle = g_E.replaced;
+    std::vector<TextPosition> at;
+    doc.buffer.findAll(needle, at);
+    if (at.empty()) {
+        setStatusMessage("Not found: " + needle);
+        return;
+    }
+    doc.undo.seal();
+    TextPosition before = cursorPosition();
+    replaceTextAt(at, needle.size(), with);
+    snapCursor();
+    doc.undo.recordReplace(needle, with, at, before, cursorPosition());
+    char msg[64];
+    snprintf(msg, sizeof(msg), "Replaced %zu occurrences", at.size());
+    setStatusMessage(msg);
+}
+
+// the text typed at the Ctrl-\ prompt, ask for its replacement
+void askReplacement(const std::string& text) {
+    if (text.empty()) return;
+    g_E.replaced = text;
+    startPrompt("Replace with: ", replaceAll);
+}
+
+/*** prompt ***/
+void startPrompt(const char* label, void (*done)(const std::string& text)) {
+    PromptState& prompt = g_E.prompt;
+    prompt.active = true;
+    prompt.label = label;
+    prompt.text.clear();
+    prompt.done = done;
+}
+
+void processPromptKey(int c) {
+    PromptState& prompt = g_E.prompt;
+    switch (c) {
+        case '\x1b':
+            prompt.active = false;
+            break;
+        case '\r':
+            prompt.active = false;
+            prompt.done(prompt.text);
+            break;
+        case BACKSPACE:
+        case ctrlWith('h'):
+        case DEL_KEY:
+            if (!prompt.text.empty()) prompt.text.pop_back();
+            break;
+        default:
+            if (c < 128 && isprint(c)) {
+                prompt.text += static_cast<char>(c);
+            } else if (c != 0) {
+                // like in a search, other commands give up and run
+                prompt.active = false;
+                processKey(c);
+            }
+            break;
+    }
+}
+
+/*** viewer ***/
+// move the view n lines, down if n > 0, without going past the last line
+void scrollView(int n) {
+    Document& doc = *g_E.doc;
+    size_t top = doc.topOffset;
+    for (; n > 0; --n) {
+        size_t next = doc.viewer.nextLine(top);
+        if (next >= doc.viewer.size()) break;
+        top = next;
+    }
+    for (; n < 0 && top > 0; ++n) top = doc.viewer.previousLine(top);
+    if (top != doc.topOffset) g_E.screen.invalidate();
+    doc.topOffset = top;
+}
+
+// show the line holding a byte offset, or a percentage of the file
+void jumpToOffset(const std::string& text) {
+    Document& doc = *g_E.doc;
+    char* end;
+    errno = 0;
+    unsigned long long n = strtoull(text.c_str(), &end, 10);
+    bool percent = *end == '%';
+    if (end == text.c_str() || errno != 0 || *(end + percent) != '\0') {
+        setStatusMessage("Not an offset: " + text);
+        return;
+    }
+    size_t size = doc.viewer.size();
+    size_t offset = percent ? static_cast<size_t>(
+                                  static_cast<double>(size) * n / 100)
+                            : n;
+    doc.topOffset = doc.viewer.lineStart(std::min(offset, size));
+    g_E.screen.invalidate();
+}
+
+/**
+ * @brief keys of a file that is only viewed
+ * @return false for keys that work as they do when editing
+ */
+bool processViewKey(int c) {
+    Document& doc = *g_E.doc;
+    switch (c) {
+        case ARROW_UP:
+            scrollView(-1);
+            break;
+        case ARROW_DOWN:
+            scrollView(1);
+            break;
+        case PAGE_UP:
+            scrollView(-g_E.screenRows);
+            break;
+        case PAGE_DOWN:
+            scrollView(g_E.screenRows);
+            break;
+        case ARROW_LEFT:
+            if (doc.colOffset > 0) --doc.colOffset;
+            g_E.screen.invalidate();
+            break;
+        case ARROW_RIGHT:
+            ++doc.colOffset;
+            g_E.screen.invalidate();
+            break;
+        case HOME_KEY:
+            doc.colOffset = 0;
+            g_E.screen.invalidate();
+            break;
+
+        case ctrlWith('g'):
+            startPrompt("Go to offset (bytes or %): ", jumpToOffset);
+            break;
+        case CTRL_HOME:
+            jumpToOffset("0");
+            break;
+        case CTRL_END:
+            jumpToOffset("100%");
+            break;
+
+        case ctrlWith('q'):
+        case ctrlWith('b'):
+        case ctrlWith('p'):
+        case ctrlWith('l'):
+        case '\x1b':
+            return false;
+
+        default:
+            setStatusMessage(doc.indexing
+                                 ? "Still indexing lines, edit once it's done"
+                                 : "Read-only view | Ctrl-g = go to offset");
+            break;
+    }
+    return true;
+}
+
+/*** build ***/
+
+void openPanel(bool open) {
+    if (g_E.build.panel == open) return;
+    g_E.build.panel = open;
+    setWindowSize(g_E.windowRows, g_E.screenCols);  // the text makes room
+}
+
+// "exit 0" or "killed by signal 11 (Segmentation fault)"
+std::string describeStatus(int status) {
+    char buf[80];
+    if (WIFSIGNALED(status))
+        snprintf(buf, sizeof(buf), "killed by signal %d (%s)",
+                 WTERMSIG(status), strsignal(WTERMSIG(status)));
+    else
+        snprintf(buf, sizeof(buf), "exit %d", WEXITSTATUS(status));
+    return buf;
+}
+
+void startBuildProcess(BuildState::Step step,
+                       const std::vector<std::string>& argv) {
+    BuildState& build = g_E.build;
+    build.step = step;
+    build.output.clear();
+    if (!build.process.start(argv)) {
+        build.step = BuildState::IDLE;
+        build.title = "Can't run " + argv[0] + ": " + strerror(errno);
+    }
+}
+
+// run the binary of the build, how says where it comes from
+void runBinary(const std::string& how) {
+    BuildState& build = g_E.build;
+    build.title = "Running " + build.file + " (" + how + ")";
+    startBuildProcess(BuildState::RUNNING,
+                      std::vector<std::string>(1, g_E.cache.path(build.key)));
+}
+
+const char* verdictName(SampleCase::Verdict verdict) {
+    switch (verdict) {
+        case SampleCase::WAITING:
+            return "waiting";
+        case SampleCase::RUNNING:
+            return "running";
+        case SampleCase::PASSED:
+            return "AC";
+        case SampleCase::WRONG:
+            return "WA";
+        case SampleCase::RAN:
+            return "ran";  // no answer to compare with
+        case SampleCase::CRASHED:
+            return "RE";
+        case SampleCase::TIMED_OUT:
+            return "TLE";
+        default:
+            return "OLE";
+    }
+}
+
+// 0 for the cases that passed, 1 for those to come and 2 for failures
+int verdictRank(SampleCase::Verdict verdict) {
+    switch (verdict) {
+        case SampleCase::PASSED:
+        case SampleCase::RAN:
+            return 0;
+        case SampleCase::WAITING:
+        case SampleCase::RUNNING:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+// the results of the samples in the panel, one line per case
+void showSamples() {
+    BuildState& build = g_E.build;
+    const std::vector<SampleCase>& cases = build.samples.cases();
+    if (!build.samples.running()) build.step = BuildState::IDLE;
+
+    char line[160];
+    snprintf(line, sizeof(line), "%s %s (%s): %zu/%zu passed",
+             build.step == BuildState::TESTING ? "Testing" : "Tested",
+             build.file.c_str(), build.how.c_str(),
+             build.samples.count(SampleCase::PASSED), cases.size());
+    build.title = line;
+
+    // failures go last, the panel shows the end of the output
+    build.output.clear();
+    for (int rank = 0; rank < 3; ++rank) {
+        for (const SampleCase& sample : cases) {
+            if (verdictRank(sample.verdict) != rank) continue;
+            int n = snprintf(line, sizeof(line), "%-12.12s %-7s",
+                             sample.name.c_str(), verdictName(sample.verdict));
+            if (rank != 1)
+                snprintf(line + n, sizeof(line) - n,
+                         " %6.3fs cpu %6.3fs %7.1f MB", sample.wall,
+                         sample.cpu, sample.peakKb / 1024.0);
+            build.output += line;
+            if (sample.verdict == SampleCase::WRONG)
+                build.output +=
+                    "  line " + std::to_string(sample.wrongLine) + " differs";
+            else if (sample.verdict == SampleCase::CRASHED)
+                build.output += "  " + describeStatus(sample.status);
+            build.output += '\n';
+        }
+    }
+}
+
+// test the binary on the samples next to the file, or just run it if
+// there are none
+void runOrTest(const std::string& how) {
+    BuildState& build = g_E.build;
+    std::vector<std::string> inputs = SampleRunner::findInputs(build.file);
+    if (inputs.empty()) {
+        runBinary(how);
+        return;
+    }
+    build.how = how;
+    build.step = BuildState::TESTING;
+    build.samples.start(g_E.cache.path(build.key), inputs);
+    showSamples();
+}
+
+void startCompiler() {
+    BuildState& build = g_E.build;
+    std::vector<std::string> command;
+    if (!g_E.cache.compileCommand(build.key, build.file, command)) {
+        build.step = BuildState::IDLE;
+        build.title =
+            "Can't create " + g_E.cache.dir() + ": " + strerror(errno);
+        return;
+    }
+    build.title = "Compiling " + build.file + "...";
+    startBuildProcess(BuildState::COMPILING, command);
+}
+
+// the key is known, run the binary or compile it
+void findBinary() {
+    if (g_E.cache.contains(g_E.build.key))
+        runOrTest("cached binary");
+    else
+        startCompiler();
+}
+
+/**
+ * @brief compile and run the current file in the background
+ *
+ * The file is saved first if it was modified. Its binary is looked up in
+ * the cache by the hash of the text and of the compiler command, so a file
+ * that was already compiled runs at once. The saver hashes the text, or a
+ * thread of its own does when there is nothing to save, so that the keys
+ * aren't held up by big files. The output of the compiler and
+ * of the program stream into the panel as they come.
+ */
+void compileAndRun() {
+    Document& doc = *g_E.doc;
+    BuildState& build = g_E.build;
+    if (doc.filename.empty() || doc.viewing) {
+        setStatusMessage("Nothing to compile, open a source file first");
+        return;
+    }
+    if (g_E.saver.joinable()) {
+        setStatusMessage("Still saving the previous version...");
+        return;
+    }
+    if (build.hasher.joinable()) {
+        if (!build.hashed) {
+            setStatusMessage("Still hashing the previous version...");
+            return;
+        }
+        build.hasher.join();
+    }
+
+    // a new build replaces the one running
+    build.process.stop();
+    build.samples.stop();
+    build.file = doc.filename;
+    build.output.clear();
+    openPanel(true);
+
+    if (doc.modified) {
+        save(true);
+        build.step = BuildState::SAVING;  // finishSave() goes on
+        build.title = "Saving " + build.file + "...";
+        return;
+    }
+    std::shared_ptr<Snapshot> snapshot =
+        std::make_shared<Snapshot>(doc.buffer.snapshot());
+    std::vector<std::string> command = BuildCache::compiler();
+    build.hashed = false;
+    build.hasher = std::thread([snapshot, command]() {
+        g_E.build.key = BuildCache::key(*snapshot, command);
+        g_E.build.hashed = true;
+        wakeUp();
+    });
+    build.step = BuildState::HASHING;  // pollBuild() goes on
+    build.title = "Hashing " + build.file + "...";
+}
+
+void pollBuild() {
+    BuildState& build = g_E.build;
+    if (build.hasher.joinable() && build.hashed) {
+        build.hasher.join();
+        if (build.step == BuildState::HASHING) findBinary();
+        return;
+    }
+    if (build.step == BuildState::TESTING) {
+        if (build.samples.poll()) showSamples();
+        return;
+    }
+    if (!build.process.running()) return;
+    if (build.process.readOutput(build.output) &&
+        build.output.size() > BUILD_OUTPUT_LIMIT) {
+        // keep the last half, from the start of a line
+        size_t cut = build.output.size() - BUILD_OUTPUT_LIMIT / 2;
+        size_t nl = build.output.find('\n', cut);
+        build.output.erase(0, nl == std::string::npos ? cut : nl + 1);
+    }
+    if (!build.process.finished()) return;
+
+    int status = build.process.status();
+    char seconds[32];
+    snprintf(seconds, sizeof(seconds), " in %.2fs", build.process.seconds());
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (build.step == BuildState::COMPILING) {
+        if (ok && g_E.cache.commit(build.key)) {
+            runOrTest(std::string("compiled") + seconds);
+            return;
+        }
+        if (ok)
+            build.title = "Can't store the binary in " + g_E.cache.dir() +
+                          ": " + strerror(errno);
+        else
+            build.title = "Compilation failed, " + describeStatus(status) +
+                          seconds;
+        g_E.cache.discard(build.key);
+    } else {
+        build.title = build.file + ": " + describeStatus(status) + seconds;
+    }
+    build.step = BuildState::IDLE;
+}
+
+void buildOutputFds(std::vector<int>& fds) {
+    if (g_E.build.process.outputFd() != -1)
+        fds.push_back(g_E.build.process.outputFd());
+    g_E.build.samples.outputFds(fds);
+}
+
+// the panel is closed, what runs in it is stopped
+void closeBuild() {
+    g_E.build.process.stop();
+    g_E.build.samples.stop();
+    g_E.build.step = BuildState::IDLE;
+    openPanel(false);
+}
+
+void processKey(int c) {
+    Document& doc = *g_E.doc;
+    if (g_E.search.active) {
+        processSearchKey(c);
+        return;
+    }
+    if (g_E.prompt.active) {
+        processPromptKey(c);
+        return;
+    }
+
+    if (c == 0) return;  // no input
+    if (c != ctrlWith('n')) g_E.completion.active = false;
+    if (doc.viewing && processViewKey(c)) return;
+    if (!doc.cursors.empty() && processColumnKey(c)) return;
+    switch (c) {
+        case '\r':  // enter key
+            insertLine();
+            break;
+
+        case ctrlWith('q'): {
+            // let a running save finish, the file is only replaced at its end
+            if (g_E.saver.joinable()) g_E.saver.join();
+            if (g_E.build.hasher.joinable()) g_E.build.hasher.join();
+            // a clean exit, nothing will be recovered
+            for (std::unique_ptr<Document>& doc : g_E.documents)
+                doc->journal.remove();
+            std::string buf;
+            clearScreen(buf);
+            writeTerminal(buf.c_str(), buf.size());
+            exit(0);
+            break;
+        }
+
+        case ctrlWith('s'): {
+            save();
+            break;
+        }
+
+        case ctrlWith('p'):
+            g_E.profile.setOverlay(!g_E.profile.showOverlay());
+            break;
+
+        case ctrlWith('b'):  // the next document, doc is not it any more
+            showDocument((g_E.current + 1) % g_E.documents.size());
+            break;
+
+        case ctrlWith('f'):
+            startSearch();
+            break;
+
+        case ctrlWith('z'):
+        case ctrlWith('y'):
+            undoEdit(c == ctrlWith('y'));
+            break;
+
+        case HOME_KEY:
+            doc.undo.seal();
+            doc.cursorX = 0;
+            break;
+        case END_KEY:
+            doc.undo.seal();
+            if (doc.cursorY < doc.buffer.lineCount())
+                doc.cursorX = doc.buffer.line(doc.cursorY).size();
+            break;
+
+        case BACKSPACE:
+        case ctrlWith('h'):
+        case DEL_KEY:
+            if (c == DEL_KEY) moveCursor(ARROW_RIGHT);
+            deleteChar();
+            break;
+
+        case PAGE_UP:
+        case PAGE_DOWN:
+            movePage(c);
+            break;
+
+        case CTRL_HOME:
+            moveCursorToLine(0);
+            doc.cursorX = 0;
+            break;
+        case CTRL_END:
+            moveCursorToLine(std::max<size_t>(doc.buffer.lineCount(), 1) - 1);
+            if (doc.cursorY < doc.buffer.lineCount())
+                doc.cursorX = doc.buffer.line(doc.cursorY).size();
+            break;
+        case CTRL_LEFT:
+        case CTRL_RIGHT:
+            moveWord(c == CTRL_LEFT);
+            break;
+        case ctrlWith('g'):
+            startPrompt("Go to line: ", jumpToLine);
+            break;
+
+        case ARROW_DOWN:
+        case ARROW_UP:
+        case ARROW_LEFT:
+        case ARROW_RIGHT:
+            moveCursor(c);
+            break;
+
+        case PASTE:
+            insertText(g_E.input.paste());
+            break;
+
+        case ctrlWith('r'):
+            compileAndRun();
+            break;
+
+        case ctrlWith('n'):
+            completeWord();
+            break;
+
+        case ctrlWith(']'):
+            jumpToBracket();
+            break;
+
+        case ctrlWith('w'):
+            toggleWrap();
+            break;
+
+        case ctrlWith('\\'):
+            startPrompt("Replace: ", askReplacement);
+            break;
+
+        case ALT_UP:
+        case ALT_DOWN:
+            extendColumn(c);
+            break;
+
+        case ctrlWith('l'):  // refresh key in traditional terminal app
+            break;
+        case '\x1b':  // escape key, closes the build panel
+            if (g_E.build.panel) closeBuild();
+            break;
+
+        default:
+            insertAtCursor(std::string(1, c));
+            break;
+    }
+}
+
+int syntaxColor(unsigned char hl) {
+    switch (hl) {
+        case HL_COMMENT:
+            return 36;  // cyan
+        case HL_KEYWORD:
+            return 33;  // yellow
+        case HL_TYPE:
+            return 32;  // green
+        case HL_STRING:
+            return 35;  // magenta
+        case HL_NUMBER:
+            return 31;  // red
+        case HL_PREPROCESSOR:
+            return 34;  // blue
+        default:
+            return 39;  // default color
+    }
+}
+
+// append columns [begin, end) of render as they are
+void drawPlain(const RenderedLine& render, size_t begin, size_t end,
+               std::string& buf) {
+    // the characters are contiguous in the rendering, copy them at once; a
+    // wide character cut by an edge of the screen shows as spaces
+    const ColumnIndex& columns = render.columns;
+    ColumnIndex::Cell first = columns.cellAt(begin);
+    size_t from = first.rx < begin ? first.rx + first.width : begin;
+    ColumnIndex::Cell last = columns.cellAt(end - 1);
+    size_t to = last.rx + last.width > end ? last.rx : end;
+    buf.append(from - begin, ' ');
+    if (from < to) {
+        size_t offset = columns.cellAt(from).offset;
+        size_t endOffset = to < columns.renderWidth()
+                               ? columns.cellAt(to).offset
+                               : render.text.size();
+        buf.append(render.text, offset, endOffset - offset);
+    }
+    buf.append(end - std::max(from, to), ' ');
+}
+
+// append columns [begin, end) of line y in syntax colors, with the matches
+// of the search and the brackets at the cursor in reverse video
+void drawLine(int y, const RenderedLine& render, size_t begin, size_t end,
+              std::string& buf) {
+    // rendered columns [first, second) of every match
+    std::vector<std::pair<size_t, size_t>>& matches = g_E.frame.matches;
+    matches.clear();
+    if (g_E.search.active && !g_E.search.query.empty()) {
+        LineView line = g_E.doc->buffer.line(y);
+        LineView query(g_E.search.query);
+        const char* p = line.begin();
+        while ((p = findFirst(p, line.end() - p, query)) != nullptr) {
+            size_t x = p - line.begin();
+            matches.push_back(
+                std::make_pair(render.columns.renderColumn(x),
+                               render.columns.renderColumn(x + query.size())));
+            p += query.size();
+        }
+    }
+    // and the brackets of the pair at the cursor
+    const BracketPair& brackets = g_E.brackets;
+    if (brackets.shown && !g_E.doc->viewing) {
+        size_t before = matches.size();
+        for (const TextPosition& p : {brackets.at, brackets.match}) {
+            if (p.y != static_cast<size_t>(y)) continue;
+            matches.push_back(
+                std::make_pair(render.columns.renderColumn(p.x),
+                               render.columns.renderColumn(p.x + 1)));
+        }
+        if (matches.size() > before) std::sort(matches.begin(), matches.end());
+    }
+    // and the column cursors, the main one is the terminal's
+    if (!g_E.doc->viewing && !g_E.doc->cursors.empty()) {
+        size_t before = matches.size();
+        for (const TextPosition& cursor : g_E.doc->cursors) {
+            if (cursor.y != static_cast<size_t>(y)) continue;
+            size_t rx = render.columns.renderColumn(cursor.x);
+            if (rx < render.columns.renderWidth())
+                matches.push_back(std::make_pair(
+                    rx, render.columns.renderColumn(
+                            render.columns.charEnd(cursor.x))));
+        }
+        if (matches.size() > before) std::sort(matches.begin(), matches.end());
+    }
+    const ColumnIndex& columns = render.columns;
+
+    if (!render.highlighted && matches.empty()) {
+        drawPlain(render, begin, end, buf);
+        return;
+    }
+
+    int color = 39;
+    bool inverse = false;
+    size_t m = 0;
+    for (size_t rx = begin; rx < end;) {
+        while (m < matches.size() && matches[m].second <= rx) m++;
+        bool inside = m < matches.size() && matches[m].first <= rx;
+        if (inside != inverse) {
+            buf += inside ? "\x1b[7m" : "\x1b[27m";
+            inverse = inside;
+        }
+        int c = render.highlighted ? syntaxColor(render.highlight[rx]) : 39;
+        if (c != color) {
+            char esc[16];
+            snprintf(esc, sizeof(esc), "\x1b[%dm", c);
+            buf += esc;
+            color = c;
+        }
+        ColumnIndex::Cell cell = columns.cellAt(rx);
+        if (cell.rx < begin || cell.rx + cell.width > end) {
+            buf += ' ';  // the part of a wide character on the screen
+            rx++;
+        } else {
+            buf.append(render.text, cell.offset, cell.size);
+            rx += cell.width;
+        }
+    }
+    if (inverse) buf += "\x1b[27m";
+    if (color != 39) buf += "\x1b[39m";
+}
+
+// the columns of line y that are on screen
+void drawVisible(int y, const RenderedLine& render, std::string& buf) {
+    size_t width = render.columns.renderWidth();
+    if (static_cast<size_t>(g_E.doc->colOffset) < width) {
+        // clip to the screen, a wrapped line would spill into rows that are
+        // not redrawn
+        size_t begin = g_E.doc->colOffset;
+        size_t end = std::min(width, begin + g_E.screenCols);
+        drawLine(y, render, begin, end, buf);
+    }
+    // a column cursor after the end of the line
+    if (g_E.doc->viewing) return;
+    for (const TextPosition& cursor : g_E.doc->cursors) {
+        if (cursor.y != static_cast<size_t>(y)) continue;
+        size_t rx = render.columns.renderColumn(cursor.x);
+        if (rx < width || rx < static_cast<size_t>(g_E.doc->colOffset) ||
+            rx >= g_E.doc->colOffset + static_cast<size_t>(g_E.screenCols))
+            continue;
+        buf.append(rx - std::max(width, static_cast<size_t>(
+                                            g_E.doc->colOffset)),
+                   ' ');
+        buf += "\x1b[7m \x1b[27m";
+    }
+}
+
+void drawRow(int y, std::string& buf) {
+    Document& doc = *g_E.doc;
+    int filerow = y + doc.rowOffset;
+    if (filerow >= doc.buffer.lineCount()) {
+        if (doc.buffer.empty() && (y == g_E.screenRows / 3)) {
+            char welcome[80];
+            int wellen = snprintf(welcome, sizeof(welcome),
+                                  "cp editor -- version %s", "0.0.1");
+            if (wellen > g_E.screenCols) wellen = g_E.screenCols;
+            int padding = (g_E.screenCols - wellen) / 2;
+            if (padding) {
+                buf += "~";
+                padding--;
+            }
+            while (padding--) buf += " ";
+            buf += welcome;
+        } else {
+            // draw left side tilde
+            buf += "~";
+        }
+    } else {
+        drawVisible(filerow, highlightedLine(filerow), buf);
+    }
+}
+
+// rows of the viewer, the first one shows the line at topOffset
+void drawViewRows(std::string& buf) {
+    Document& doc = *g_E.doc;
+    std::string& row = g_E.frame.row;
+    RenderedLine& render = g_E.frame.viewLine;
+    size_t offset = doc.topOffset;
+    for (int y = 0; y < g_E.screenRows; ++y) {
+        bool inFile = offset < doc.viewer.size();
+        if (g_E.screen.isDirty(y)) {
+            row.clear();
+            if (inFile) {
+                convertToRenderingRow(doc.viewer.line(offset), render);
+                drawVisible(y, render, row);
+            } else {
+                row += "~";
+            }
+            g_E.screen.updateRow(y, row, buf);
+        }
+        if (inFile) offset = doc.viewer.nextLine(offset);
+    }
+}
+
+// rows with soft wrap, the first one shows row wrapSkip of line rowOffset
+void drawWrappedRows(std::string& buf) {
+    Document& doc = *g_E.doc;
+    std::string& row = g_E.frame.row;
+    size_t cols = doc.wrap.columns();
+    size_t y = doc.rowOffset, skip = doc.wrapSkip;
+    for (int r = 0; r < g_E.screenRows; ++r) {
+        bool inFile = y < doc.buffer.lineCount();
+        if (g_E.screen.isDirty(r)) {
+            row.clear();
+            if (inFile) {
+                const RenderedLine& render = highlightedLine(y);
+                size_t width = render.columns.renderWidth();
+                size_t begin = skip * cols;
+                if (begin < width)
+                    drawLine(y, render, begin, std::min(width, begin + cols),
+                             row);
+            } else {
+                row += "~";
+            }
+            g_E.screen.updateRow(r, row, buf);
+        }
+        if (inFile && ++skip >= doc.wrap.rowsOf(y)) {
+            y++;
+            skip = 0;
+        }
+    }
+}
+
+void drawRows(std::string& buf) {
+    if (g_E.doc->viewing) {
+        drawViewRows(buf);
+        return;
+    }
+    if (wrapping()) {
+        drawWrappedRows(buf);
+        return;
+    }
+    std::string& row = g_E.frame.row;
+    for (int y = 0; y < g_E.screenRows; ++y) {
+        if (!g_E.screen.isDirty(y)) continue;
+        row.clear();
+        drawRow(y, row);
+        g_E.screen.updateRow(y, row, buf);
+    }
+}
+
+void drawStatusBar(std::string& out, int currentC) {
+    Document& doc = *g_E.doc;
+    std::string& buf = g_E.frame.row;
+    buf.clear();
+    buf += "\x1b[7m";  // switch color mode to inverted
+
+    char status[80], rstatus[80];
+    int rlen;
+    if (g_E.profile.showOverlay()) {
+        // frame times instead of the cursor position, toggled with Ctrl-p
+        const LatencyHistogram& frames = g_E.profile.frames();
+        rlen = snprintf(rstatus, sizeof(rstatus),
+                        "frame p50 %.2fms p99 %.2fms %zuB",
+                        frames.percentile(50) / 1000,
+                        frames.percentile(99) / 1000,
+                        g_E.profile.lastFrameBytes());
+    } else if (doc.viewing) {
+        size_t size = std::max<size_t>(doc.viewer.size(), 1);
+        rlen = snprintf(rstatus, sizeof(rstatus), "Offset %zu (%d%%)",
+                        doc.topOffset,
+                        static_cast<int>(100.0 * doc.topOffset / size));
+    } else {
+        rlen = snprintf(rstatus, sizeof(rstatus), "CursorPosition Y : %d/%d",
+                        doc.cursorY + 1,
+                        static_cast<int>(doc.buffer.lineCount()));
+    }
+
+    // which document this is when there are several, Ctrl-b goes to the next
+    char which[32] = "";
+    if (g_E.documents.size() > 1)
+        snprintf(which, sizeof(which), " [%zu/%zu]", g_E.current + 1,
+                 g_E.documents.size());
+    // a viewed file has no line count, only its size is known
+    char size[32];
+    if (doc.indexing)
+        snprintf(size, sizeof(size), "indexing lines %d%%",
+                 static_cast<int>(100.0 * doc.indexed /
+                                  std::max<size_t>(doc.indexing->size(), 1)));
+    else if (doc.viewing)
+        snprintf(size, sizeof(size), "%zu bytes, view", doc.viewer.size());
+    else
+        snprintf(size, sizeof(size), "%d lines",
+                 static_cast<int>(doc.buffer.lineCount()));
+    int len =
+        snprintf(status, sizeof(status),
+                 "Filename: %.20s%s - %s, key pressed: %c(%d)",
+                 doc.filename.size() > 0 ? doc.filename.c_str() : "[No Name]",
+                 which, size, static_cast<char>(currentC), currentC);
+    if (len > g_E.screenCols) len = g_E.screenCols;
+    // the overlay was asked for, make room for it
+    if (g_E.profile.showOverlay() && len > g_E.screenCols - rlen)
+        len = std::max(g_E.screenCols - rlen, 0);
+    // a key without a character shows as NUL, the text stops there
+    buf.append(status, std::min(static_cast<size_t>(len), strlen(status)));
+
+    while (len < g_E.screenCols) {
+        if (g_E.screenCols - len == rlen) {
+            // append right-side status
+            buf.append(rstatus, rlen);
+            break;
+        }
+        buf += ' ';
+        len++;
+    }
+    buf += "\x1b[m";  // switch back to color mode normal
+    g_E.screen.updateRow(g_E.screenRows, buf, out);
+}
+
+void drawMessageBar(std::string& out) {
+    std::string& buf = g_E.frame.row;
+    buf.clear();
+    int len = g_E.statusMsg.size();
+    if (len > g_E.screenCols) len = g_E.screenCols;
+    if (g_E.search.active) {
+        buf += "Search: ";
+        buf += g_E.search.query;
+        if (!g_E.search.query.empty() && !g_E.search.found)
+            buf += " (no match)";
+        buf += " (ESC = cancel | Enter = done | Arrows = next/prev)";
+        if (buf.size() > static_cast<size_t>(g_E.screenCols))
+            buf.resize(g_E.screenCols);
+    } else if (g_E.prompt.active) {
+        buf += g_E.prompt.label;
+        buf += g_E.prompt.text;
+        if (buf.size() > static_cast<size_t>(g_E.screenCols))
+            buf.resize(g_E.screenCols);
+    } else if (g_E.completion.active) {
+        // the candidates, with the one in the text in brackets
+        const CompletionState& completion = g_E.completion;
+        buf += "Complete:";
+        for (size_t i = 0; i < completion.candidates.size(); ++i) {
+            bool chosen = i == completion.choice;
+            buf += chosen ? " [" : " ";
+            buf += completion.candidates[i];
+            if (chosen) buf += "]";
+        }
+        if (buf.size() > static_cast<size_t>(g_E.screenCols))
+            buf.resize(g_E.screenCols);
+    } else if (len &&
+               (time(nullptr) - g_E.statusMsgTime < STATUS_MSG_TIMEOUT)) {
+        buf.append(g_E.statusMsg, 0, len);
+    }
+    g_E.screen.updateRow(g_E.screenRows + 1, buf, out);
+}
+
+// the title of the build and the last lines of its output
+void drawPanel(std::string& out) {
+    if (g_E.panelRows == 0) return;
+    const BuildState& build = g_E.build;
+    std::string& buf = g_E.frame.row;
+    int top = g_E.screenRows + 2;
+
+    buf.clear();
+    buf += "\x1b[7m";
+    size_t cols = g_E.screenCols;
+    size_t width = std::min(cols, build.title.size());
+    const char* hint = " ESC = close";
+    buf.append(build.title.data(), width);
+    if (width + strlen(hint) <= cols) {
+        buf.append(cols - width - strlen(hint), ' ');
+        buf += hint;
+    } else {
+        buf.append(cols - width, ' ');
+    }
+    buf += "\x1b[m";
+    g_E.screen.updateRow(top, buf, out);
+
+    // start of the first line that fits, the last one may be unfinished
+    const std::string& text = build.output;
+    int lines = g_E.panelRows - 1;
+    size_t end = text.size();
+    if (end > 0 && text[end - 1] == '\n') end--;
+    size_t start = end;
+    int shown = 0;
+    if (!text.empty()) {
+        shown = 1;
+        while (true) {
+            size_t nl = start == 0 ? std::string::npos
+                                   : text.rfind('\n', start - 1);
+            start = nl == std::string::npos ? 0 : nl + 1;
+            if (shown == lines || start == 0) break;
+            start = nl;  // the end of the line before
+            shown++;
+        }
+    }
+
+    RenderedLine& render = g_E.frame.viewLine;
+    for (int y = 0; y < lines; ++y) {
+        buf.clear();
+        if (y < shown) {
+            size_t next = std::min(text.find('\n', start), end);
+            convertToRenderingRow(LineView(text.data() + start, next - start),
+                                  render);
+            size_t width = render.columns.renderWidth();
+            if (width > 0) drawPlain(render, 0, std::min(width, cols), buf);
+            start = next + 1;
+        }
+        g_E.screen.updateRow(top + 1 + y, buf, out);
+    }
+}
+
+const std::string& composeFrame(int currentC) {
+    Document& doc = *g_E.doc;
+    std::string& buf = g_E.frame.out;
+    buf.clear();
+    buf += "\x1b[?25l";  // hide cursor (l is reset command)
+
+    // only rows that changed since the last frame are written
+    size_t start = buf.size();
+    if (!doc.viewing) editorScroll(buf);  // the viewer scrolls as keys come
+    g_E.profile.mark(PHASE_SCROLL);
+    // with soft wrap every edit redraws all rows
+    if (doc.highlight && !wrapping()) checkHighlights();
+    showBrackets();
+
+    drawRows(buf);
+    drawStatusBar(buf, currentC);
+    drawMessageBar(buf);
+    drawPanel(buf);
+    bool drawn = buf.size() > start;
+    if (!drawn) buf.clear();  // no need to hide the cursor
+
+    if (doc.viewing)
+        g_E.screen.placeCursor(1, 1, buf);
+    else if (wrapping())
+        g_E.screen.placeCursor(cursorWrappedRow() - topWrappedRow() + 1,
+                               doc.cursorRX % doc.wrap.columns() + 1, buf);
+    else
+        g_E.screen.placeCursor((doc.cursorY - doc.rowOffset) + 1,
+                               (doc.cursorRX - doc.colOffset) + 1, buf);
+    if (drawn) buf += "\x1b[?25h";  // show cursor again (h is set command)
+    g_E.profile.mark(PHASE_COMPOSE);
+    return buf;
+}
+
+void refreshScreen(int currentC) {
+    const std::string& buf = composeFrame(currentC);
+    if (!buf.empty()) writeTerminal(buf.c_str(), buf.size());
+    g_E.profile.mark(PHASE_WRITE);
+    g_E.profile.endFrame(buf.size());
+}
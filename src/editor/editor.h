@@ -0,0 +1,239 @@
+#ifndef CP_EDITOR_EDITOR_H
+#define CP_EDITOR_EDITOR_H
+
+#include <signal.h>
+#include <termios.h>
+
+#include <atomic>
+#include <cstddef>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "block_pool.h"
+#include "bracket_index.h"
+#include "buffer.h"
+#include "build_cache.h"
+#include "child_process.h"
+#include "file_viewer.h"
+#include "identifier_index.h"
+#include "input.h"
+#include "mapped_file.h"
+#include "profile.h"
+#include "render_cache.h"
+#include "sample_runner.h"
+#include "screen.h"
+#include "swap_journal.h"
+#include "syntax.h"
+#include "text_position.h"
+#include "undo.h"
+#include "wrap_index.h"
+
+/**
+ * @brief the editor without its terminal
+ *
+ * Keys go in through processKey() and frames come out of composeFrame(),
+ * so the editor can be driven by a terminal, a benchmark or a test alike.
+ */
+
+constexpr int TAB_SIZE = 8;
+constexpr int STATUS_MSG_TIMEOUT = 5;  // seconds a status message stays
+constexpr size_t UNDO_MEMORY_LIMIT = 8 << 20;  // bytes kept for undo
+// files from this size on are opened in the viewer rather than loaded
+constexpr size_t VIEW_THRESHOLD = size_t(1) << 30;
+// files from this size on are shown before their lines are indexed
+constexpr size_t BACKGROUND_INDEX_THRESHOLD = 16 << 20;
+constexpr size_t COMPLETION_LIMIT = 16;  // candidates offered by Ctrl-n
+constexpr int PANEL_ROWS = 10;  // rows of the build panel with its title
+constexpr size_t BUILD_OUTPUT_LIMIT = 1 << 20;  // bytes of output kept
+
+struct SearchState {
+    bool active;
+    std::string query;
+    bool found;          // match holds a match of query
+    TextPosition match;  // where searching resumes
+    int savedX, savedY, savedRowOffset, savedColOffset;  // restored on ESC
+};
+
+// a line of input asked for in the message bar
+struct PromptState {
+    bool active;
+    const char* label;
+    std::string text;
+    void (*done)(const std::string& text);  // called on Enter
+};
+
+// the bracket at the cursor and the one matching it, shown highlighted
+struct BracketPair {
+    bool shown;
+    bool pending;  // the match is still looked for, over the next frames
+    TextPosition at, match;
+};
+
+// Ctrl-n going through the identifiers that complete the one typed
+struct CompletionState {
+    bool active;
+    size_t y, x;  // where the identifier starts
+    std::string prefix;  // what was typed of it
+    std::vector<std::string> candidates;
+    size_t choice;  // the candidate in the text
+};
+
+// compiling the current file and running it, shown in a panel under the
+// message bar
+struct BuildState {
+    enum Step { IDLE, SAVING, HASHING, COMPILING, RUNNING, TESTING };
+    Step step;
+    bool panel;  // the panel is open
+    std::string file;  // what is built
+    uint64_t key;      // of its binary in the cache
+    std::thread hasher;  // computes key when the file needn't be saved
+    std::atomic<bool> hashed;  // key is ready
+    std::string how;   // where the binary comes from, for the title
+    ChildProcess process;  // the compiler, then the program
+    SampleRunner samples;  // the program on the samples next to the file
+    std::string output;    // of the process, its last lines are shown
+    std::string title;     // what the panel is about
+};
+
+// memory reused by every frame, so that steady redraws don't allocate
+struct FrameBuffers {
+    std::string out;  // bytes for the terminal
+    std::string row;  // the row being composed
+    std::vector<std::pair<size_t, size_t>> matches;  // search matches in a row
+    std::vector<unsigned char> classes;  // syntax classes of a line
+    RenderedLine viewLine;  // a line of the viewer, which aren't cached
+    ColumnIndex widthLine;  // to measure lines that aren't cached
+};
+
+/**
+ * @brief a file being edited and everything that is only about it
+ *
+ * Switching to another document only changes which one the editor looks
+ * at, the text, rendered lines, undo history and cursor of each stay where
+ * they are.
+ */
+struct Document {
+    explicit Document(std::shared_ptr<BlockPool> pool);
+    ~Document();
+
+    int cursorX, cursorY;  // cursor positions in the file
+    int cursorRX;          // cursor position in the render line
+    int rowOffset, colOffset;  // screen position in the file
+    // column cursors besides the main one, each on a line of its own;
+    // edits at the cursor are made at all of them
+    std::vector<TextPosition> cursors;
+    // with soft wrap, rows of line rowOffset above the screen
+    size_t wrapSkip;
+    WrapIndex wrap;  // rows of the wrapped lines, built once wrap is on
+    TextBuffer buffer;     // actual data in the file opened
+    RenderCache renders;   // rendered lines around the screen
+    UndoJournal undo;      // edits that can be undone
+    SwapJournal journal;   // edits since the last save, on disk
+    SyntaxHighlighter syntax;
+    BracketIndex brackets;
+    bool highlight;  // the file is highlighted as C/C++
+    std::string filename;
+    bool loaded;  // the file was read, which waits until it is first shown
+    bool modified;
+    // a file too big to load is only viewed, from byte topOffset on
+    bool viewing;
+    FileViewer viewer;
+    size_t topOffset;
+    // a big file is viewed while its lines are indexed in the background
+    std::shared_ptr<MappedFile> indexing;  // the file, until it is loaded
+    std::thread indexer;
+    std::atomic<size_t> indexed;  // bytes of it scanned so far
+    std::atomic<bool> indexDone;
+    // identifiers of the text for completion. On load they are scanned on
+    // a thread into scannedWords, which is then merged into words; words
+    // gets the edits from the start.
+    IdentifierIndex words;
+    IdentifierIndex scannedWords;
+    std::thread wordIndexer;
+    std::atomic<bool> wordsDone, stopWords;
+};
+
+struct EditorConfig {
+    Document* doc;  // the document on screen
+    std::vector<std::unique_ptr<Document>> documents;
+    size_t current;  // index of doc in documents
+    std::shared_ptr<BlockPool> pool;  // nodes of the text of every document
+    int screenRows, screenCols;
+    int windowRows;  // of the terminal, the text gets what the bars and
+                     // the panel leave
+    int panelRows;
+    Screen screen;        // what the terminal shows
+    InputDecoder input;   // keys read from the terminal
+    SearchState search;   // incremental search in progress
+    PromptState prompt;
+    std::string replaced;  // the text Ctrl-\ replaces, while asking with what
+    CompletionState completion;
+    BracketPair brackets;
+    BuildState build;
+    BuildCache cache;  // binaries of what was compiled
+    size_t viewThreshold = VIEW_THRESHOLD;  // files this big are only viewed
+    bool journal = false;  // keep the edits of files in swap journals
+    bool wrapLines = false;  // soft wrap, toggled with Ctrl-w
+    FrameBuffers frame;
+    FrameProfile profile;  // where the time of the frames goes
+    std::string statusMsg;
+    time_t statusMsgTime;
+    struct termios orig_termios;
+    int wakePipe[2];  // wakes up the main loop from signals and threads
+    volatile sig_atomic_t resized;
+    std::thread saver;  // writes the file in the background
+    std::atomic<bool> saveDone;
+    Document* saving;  // what saver writes
+    int saveError;  // errno of the last save, 0 on success
+    size_t savedBytes;
+};
+
+extern EditorConfig g_E;
+
+constexpr char ctrlWith(char c) { return (c & 0x1f); }
+
+void writeTerminal(const void* buf, size_t n);
+void clearScreen(std::string& buf);
+void die(const char* s);
+// make the main loop return from waiting, safe to call from signal handlers
+// and threads
+void wakeUp();
+
+// start with a single empty document
+void initEditor();
+// size of the terminal, the last two rows show the status
+void setWindowSize(int rows, int cols);
+// read filename into the current document, or view it if it is too big
+void editorOpen(const std::string& filename);
+// add a document for filename, which is read when first shown
+Document& addDocument(const std::string& filename);
+// put documents[i] on screen, in constant time once it is loaded
+void showDocument(size_t i);
+void setStatusMessage(const std::string& msg);
+// ask for a line of text with label, done gets it unless ESC is pressed
+void startPrompt(const char* label, void (*done)(const std::string& text));
+void save(bool keyed = false);
+void finishSave();
+// write the edits made since the last call to the swap journals
+void flushJournals();
+// load the documents whose lines have been indexed in the background, and
+// take in the identifiers scanned
+void finishIndexing();
+// save the current file, compile it unless the cache has it and run it
+void compileAndRun();
+// read the output of the build and go on with its next step
+void pollBuild();
+// pipes the build reads from, for the main loop to poll
+void buildOutputFds(std::vector<int>& fds);
+
+void processKey(int c);
+// bytes that bring the terminal up to date, in g_E.frame.out
+const std::string& composeFrame(int currentC);
+// compose a frame and write it to the terminal
+void refreshScreen(int currentC);
+
+#endif  // CP_EDITOR_EDITOR_H
@@ -0,0 +1,127 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <cmath>
+
+const int LatencyHistogram::BUCKETS;
+
+LatencyHistogram::LatencyHistogram() { clear(); }
+
+void LatencyHistogram::clear() {
+    std::fill(counts, counts + BUCKETS, 0);
+    total = 0;
+}
+
+int LatencyHistogram::bucketOf(double us) {
+    if (us < 1) return 0;
+    // bucket b >= 1 holds [2^((b - 1) / 4), 2^(b / 4))
+    int b = 1 + static_cast<int>(4 * std::log2(us));
+    return std::min(b, BUCKETS - 1);
+}
+
+double LatencyHistogram::upperBound(int bucket) {
+    return std::exp2(bucket / 4.0);
+}
+
+void LatencyHistogram::add(double us) {
+    ++counts[bucketOf(us)];
+    ++total;
+}
+
+double LatencyHistogram::percentile(double p) const {
+    if (total == 0) return 0;
+    size_t rank = static_cast<size_t>(std::ceil(p / 100 * total));
+    rank = std::max<size_t>(rank, 1);
+    size_t seen = 0;
+    for (int b = 0; b < BUCKETS; ++b) {
+        seen += counts[b];
+        if (seen >= rank) return upperBound(b);
+    }
+    return upperBound(BUCKETS - 1);
+}
+
+FrameProfile::FrameProfile()
+    : overlay(false),
+      tracing(false),
+      lastBytes(0),
+      keys(0),
+      inFrame(false),
+      traceCapacity(0),
+      traced(0) {}
+
+void FrameProfile::setOverlay(bool on) {
+    if (on && !enabled()) {
+        // start from fresh numbers
+        frameTimes.clear();
+        for (LatencyHistogram& h : phases) h.clear();
+        lastBytes = 0;
+    }
+    overlay = on;
+    if (!enabled()) inFrame = false;
+}
+
+void FrameProfile::setTrace(size_t capacity) {
+    tracing = capacity > 0;
+    traceCapacity = capacity;
+    trace.clear();
+    trace.reserve(capacity);
+    traced = 0;
+    epoch = Clock::now();
+    if (!enabled()) inFrame = false;
+}
+
+void FrameProfile::begin() {
+    frameStart = lastMark = Clock::now();
+    std::fill(current, current + PHASE_COUNT, 0);
+    keys = 0;
+    inFrame = true;
+}
+
+void FrameProfile::charge(FramePhase phase) {
+    // a frame that wasn't begun, as from a replay, starts at its first mark
+    if (!inFrame) begin();
+    Clock::time_point now = Clock::now();
+    current[phase] +=
+        std::chrono::duration<double, std::micro>(now - lastMark).count();
+    lastMark = now;
+    if (phase == PHASE_PROCESS) ++keys;  // every key ends being processed
+}
+
+void FrameProfile::end(size_t bytes) {
+    if (!inFrame) return;
+    inFrame = false;
+    if (keys == 0 && bytes == 0) return;  // nothing happened, not a frame
+
+    Clock::time_point now = Clock::now();
+    frameTimes.add(
+        std::chrono::duration<double, std::micro>(now - frameStart).count());
+    for (int i = 0; i < PHASE_COUNT; ++i) phases[i].add(current[i]);
+    lastBytes = bytes;
+
+    if (!tracing) return;
+    TraceFrame frame;
+    frame.start =
+        std::chrono::duration<double, std::micro>(frameStart - epoch).count();
+    for (int i = 0; i < PHASE_COUNT; ++i) frame.phases[i] = current[i];
+    frame.bytes = static_cast<uint32_t>(bytes);
+    frame.keys = static_cast<uint32_t>(keys);
+    if (trace.size() < traceCapacity)
+        trace.push_back(frame);
+    else
+        trace[traced % traceCapacity] = frame;
+    ++traced;
+}
+
+void FrameProfile::writeTrace(FILE* out) const {
+    fprintf(out,
+            "# start_us decode_us process_us scroll_us compose_us write_us "
+            "bytes keys\n");
+    size_t first = traced > trace.size() ? traced % trace.size() : 0;
+    for (size_t i = 0; i < trace.size(); ++i) {
+        const TraceFrame& f = trace[(first + i) % trace.size()];
+        fprintf(out, "%.1f %.1f %.1f %.1f %.1f %.1f %u %u\n", f.start,
+                f.phases[PHASE_DECODE], f.phases[PHASE_PROCESS],
+                f.phases[PHASE_SCROLL], f.phases[PHASE_COMPOSE],
+                f.phases[PHASE_WRITE], f.bytes, f.keys);
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef CP_EDITOR_PROFILE_H
+#define CP_EDITOR_PROFILE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/**
+ * @brief counts of durations in buckets of fixed relative width
+ *
+ * Bucket 0 holds everything under a microsecond and every following bucket
+ * is a quarter of an octave wide, so percentiles are known within 19%
+ * whatever the scale. Adding a duration doesn't allocate.
+ */
+class LatencyHistogram {
+public:
+    static const int BUCKETS = 80;  // the last one is open, from ~0.9s
+
+    LatencyHistogram();
+
+    void add(double us);
+    void clear();
+    size_t count() const { return total; }
+    // upper bound of the bucket holding the p-th percentile, 0 if empty
+    double percentile(double p) const;
+
+private:
+    static int bucketOf(double us);
+    static double upperBound(int bucket);
+
+    size_t counts[BUCKETS];
+    size_t total;
+};
+
+// parts of a frame that are timed
+enum FramePhase {
+    PHASE_DECODE,   // reading and decoding input
+    PHASE_PROCESS,  // processKey()
+    PHASE_SCROLL,   // editorScroll()
+    PHASE_COMPOSE,  // drawing the frame into the buffer
+    PHASE_WRITE,    // writing it to the terminal
+    PHASE_COUNT
+};
+
+/**
+ * @brief where the time of each frame goes
+ *
+ * A frame starts with beginFrame() and each mark() charges the time since
+ * the previous mark to a phase. Frame and phase times go into histograms
+ * and, when tracing, the last frames are kept for writeTrace(). Every call
+ * returns before reading the clock while profiling is off.
+ */
+class FrameProfile {
+public:
+    FrameProfile();
+
+    bool enabled() const { return overlay || tracing; }
+    bool showOverlay() const { return overlay; }
+    // profile while the overlay is shown
+    void setOverlay(bool on);
+    // keep the last capacity frames for writeTrace(), 0 to stop
+    void setTrace(size_t capacity);
+
+    void beginFrame() {
+        if (enabled()) begin();
+    }
+    void mark(FramePhase phase) {
+        if (enabled()) charge(phase);
+    }
+    // the frame wrote bytes to the terminal
+    void endFrame(size_t bytes) {
+        if (enabled()) end(bytes);
+    }
+
+    const LatencyHistogram& frames() const { return frameTimes; }
+    const LatencyHistogram& phase(FramePhase p) const { return phases[p]; }
+    size_t lastFrameBytes() const { return lastBytes; }
+
+    // one line per frame kept, oldest first
+    void writeTrace(FILE* out) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct TraceFrame {
+        double start;  // microseconds since tracing started
+        float phases[PHASE_COUNT];
+        uint32_t bytes;
+        uint32_t keys;
+    };
+
+    void begin();
+    void charge(FramePhase phase);
+    void end(size_t bytes);
+
+    bool overlay, tracing;
+    LatencyHistogram frameTimes;
+    LatencyHistogram phases[PHASE_COUNT];
+    size_t lastBytes;
+
+    Clock::time_point epoch, frameStart, lastMark;
+    double current[PHASE_COUNT];  // time of each phase in this frame
+    size_t keys;                  // keys processed in this frame
+    bool inFrame;
+
+    std::vector<TraceFrame> trace;  // ring of the last frames
+    size_t traceCapacity;
+    size_t traced;  // frames ever put in trace
+};
+
+#endif  // CP_EDITOR_PROFILE_H
@@ -0,0 +1,63 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "editor.h"
+
+double ReplayStats::percentile(double p) const {
+    if (latencies.empty()) return 0;
+    std::vector<double> sorted(latencies);
+    std::sort(sorted.begin(), sorted.end());
+    // nearest rank
+    size_t rank = static_cast<size_t>(std::ceil(p / 100 * sorted.size()));
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+ReplayStats replayKeys(const std::string& input) {
+    typedef std::chrono::steady_clock Clock;
+
+    // the keys are meant for the loaded file, not for the viewer shown
+    // while a big one is indexed
+    for (std::unique_ptr<Document>& doc : g_E.documents)
+        if (doc->indexer.joinable()) doc->indexer.join();
+    finishIndexing();
+
+    ReplayStats stats;
+    stats.outputBytes = 0;
+    stats.quit = false;
+    g_E.input.feed(input.data(), input.size());
+    while (true) {
+        Clock::time_point start = Clock::now();
+        // the whole recording is there, nothing more is on its way
+        int c = g_E.input.next(true);
+        if (c == 0) break;
+        if (c == ctrlWith('q')) {
+            stats.quit = true;
+            break;
+        }
+        processKey(c);
+        stats.outputBytes += composeFrame(c).size();
+        std::chrono::duration<double, std::micro> took = Clock::now() - start;
+        stats.latencies.push_back(took.count());
+        finishSave();
+        finishIndexing();
+    }
+
+    // keep a save that was started until it is written
+    if (g_E.saver.joinable()) {
+        g_E.saver.join();
+        finishSave();
+        finishIndexing();
+    }
+    return stats;
+}
+
+void printReplayStats(const ReplayStats& stats, FILE* out) {
+    fprintf(out, "keys: %zu%s\n", stats.keys(), stats.quit ? " (quit)" : "");
+    fprintf(out, "output bytes: %zu\n", stats.outputBytes);
+    fprintf(out, "latency us: p50 %.1f | p90 %.1f | p99 %.1f | max %.1f\n",
+            stats.percentile(50), stats.percentile(90), stats.percentile(99),
+            stats.percentile(100));
+}
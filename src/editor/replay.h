@@ -0,0 +1,34 @@
+#ifndef CP_EDITOR_REPLAY_H
+#define CP_EDITOR_REPLAY_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// what replaying a recorded key stream cost
+struct ReplayStats {
+    std::vector<double> latencies;  // microseconds taken by each key
+    size_t outputBytes;             // written to the virtual terminal
+    bool quit;                      // the stream ended with Ctrl-Q
+
+    size_t keys() const { return latencies.size(); }
+    // latency that p percent of the keys didn't exceed, 0 without keys
+    double percentile(double p) const;
+};
+
+/**
+ * @brief type keys into the editor without a terminal
+ *
+ * input holds the bytes a terminal would send, as recorded, and is decoded
+ * like real input, so escape sequences and bracketed pastes become single
+ * keys. Every key is handled and followed by a frame, like a person typing
+ * slower than the screen is drawn, and the time for both is recorded. The
+ * frames only have their size counted. Replay stops at the end of input or
+ * at Ctrl-Q.
+ */
+ReplayStats replayKeys(const std::string& input);
+
+void printReplayStats(const ReplayStats& stats, FILE* out);
+
+#endif  // CP_EDITOR_REPLAY_H
@@ -0,0 +1,211 @@
+#include "sample_runner.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "mapped_file.h"
+
+SampleRunner::SampleRunner(double timeLimit)
+    : next(0), active(0), workers(1), timeLimit(timeLimit) {}
+
+// a before b with the runs of digits compared as numbers
+static bool naturalLess(const std::string& a, const std::string& b) {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (isdigit(a[i]) && isdigit(b[j])) {
+            size_t ei = i, ej = j;
+            while (ei < a.size() && isdigit(a[ei])) ei++;
+            while (ej < b.size() && isdigit(b[ej])) ej++;
+            // leading zeros aside, the longer run is the bigger number
+            size_t zi = i, zj = j;
+            while (zi + 1 < ei && a[zi] == '0') zi++;
+            while (zj + 1 < ej && b[zj] == '0') zj++;
+            if (ei - zi != ej - zj) return ei - zi < ej - zj;
+            int c = a.compare(zi, ei - zi, b, zj, ej - zj);
+            if (c != 0) return c < 0;
+            i = ei;
+            j = ej;
+        } else {
+            if (a[i] != b[j]) return a[i] < b[j];
+            i++;
+            j++;
+        }
+    }
+    return a.size() - i < b.size() - j;
+}
+
+std::vector<std::string> SampleRunner::findInputs(const std::string& source) {
+    size_t slash = source.rfind('/');
+    std::string dir =
+        slash == std::string::npos ? "." : source.substr(0, slash + 1);
+    std::vector<std::string> names;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return names;
+    while (struct dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, ".in") == 0)
+            names.push_back(name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end(), naturalLess);
+
+    std::vector<std::string> inputs;
+    for (const std::string& name : names)
+        inputs.push_back(slash == std::string::npos ? name : dir + name);
+    return inputs;
+}
+
+// end of the line starting at i of s without its trailing whitespace
+static size_t trimmedEnd(const std::string& s, size_t i, size_t& next) {
+    size_t end = s.find('\n', i);
+    next = end == std::string::npos ? s.size() : end + 1;
+    if (end == std::string::npos) end = s.size();
+    while (end > i && isspace(static_cast<unsigned char>(s[end - 1]))) end--;
+    return end;
+}
+
+// s has nothing but whitespace from i on
+static bool blankFrom(const std::string& s, size_t i) {
+    for (; i < s.size(); ++i)
+        if (!isspace(static_cast<unsigned char>(s[i]))) return false;
+    return true;
+}
+
+bool SampleRunner::sameAnswer(const std::string& output,
+                              const std::string& expected, size_t& line) {
+    size_t i = 0, j = 0;
+    for (line = 1;; ++line) {
+        bool outputDone = blankFrom(output, i);
+        bool expectedDone = blankFrom(expected, j);
+        if (outputDone || expectedDone) return outputDone && expectedDone;
+        size_t nextI, nextJ;
+        size_t endI = trimmedEnd(output, i, nextI);
+        size_t endJ = trimmedEnd(expected, j, nextJ);
+        if (output.compare(i, endI - i, expected, j, endJ - j) != 0)
+            return false;
+        i = nextI;
+        j = nextJ;
+    }
+}
+
+void SampleRunner::start(const std::string& binary,
+                         const std::vector<std::string>& inputs,
+                         unsigned workers) {
+    stop();
+    this->binary = binary;
+    this->workers =
+        workers ? workers : std::max(std::thread::hardware_concurrency(), 1u);
+    samples.clear();
+    processes.clear();
+    for (const std::string& input : inputs) {
+        SampleCase sample;
+        sample.input = input;
+        size_t slash = input.rfind('/');
+        size_t from = slash == std::string::npos ? 0 : slash + 1;
+        sample.name = input.substr(from, input.size() - 3 - from);
+        // the answer is read now, before the cases are timed
+        MappedFile answer;
+        std::string out = input.substr(0, input.size() - 3) + ".out";
+        sample.hasExpected = answer.map(out);
+        if (sample.hasExpected && answer.size() > 0)
+            sample.expected.assign(answer.data(), answer.size());
+        sample.verdict = SampleCase::WAITING;
+        sample.status = 0;
+        sample.wall = sample.cpu = 0;
+        sample.peakKb = 0;
+        sample.wrongLine = 0;
+        samples.push_back(sample);
+        processes.emplace_back(new ChildProcess());
+    }
+    next = active = 0;
+    fill();
+}
+
+void SampleRunner::stop() {
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (samples[i].verdict != SampleCase::RUNNING) continue;
+        processes[i]->stop();
+        samples[i].verdict = SampleCase::WAITING;
+    }
+    next = samples.size();  // nothing more starts
+    active = 0;
+}
+
+void SampleRunner::outputFds(std::vector<int>& fds) const {
+    for (size_t i = 0; i < samples.size(); ++i)
+        if (samples[i].verdict == SampleCase::RUNNING &&
+            processes[i]->outputFd() != -1)
+            fds.push_back(processes[i]->outputFd());
+}
+
+bool SampleRunner::poll() {
+    bool changed = false;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        SampleCase& sample = samples[i];
+        if (sample.verdict != SampleCase::RUNNING) continue;
+        ChildProcess& process = *processes[i];
+        process.readOutput(sample.output);
+        if (sample.output.size() > SAMPLE_OUTPUT_LIMIT) {
+            process.stop();
+            sample.verdict = SampleCase::TOO_MUCH_OUTPUT;
+        } else if (process.seconds() > timeLimit) {
+            process.stop();
+            sample.verdict = SampleCase::TIMED_OUT;
+        } else if (!process.finished()) {
+            continue;
+        }
+        judge(i);
+        changed = true;
+        active--;
+    }
+    fill();  // freed workers take the next cases
+    return changed;
+}
+
+size_t SampleRunner::count(SampleCase::Verdict verdict) const {
+    size_t n = 0;
+    for (const SampleCase& sample : samples)
+        if (sample.verdict == verdict) n++;
+    return n;
+}
+
+void SampleRunner::fill() {
+    while (active < workers && next < samples.size()) launch(next++);
+}
+
+void SampleRunner::launch(size_t i) {
+    SampleCase& sample = samples[i];
+    // stderr is for debugging, it is no part of the answer
+    if (!processes[i]->start(std::vector<std::string>(1, binary), sample.input,
+                             false)) {
+        sample.verdict = SampleCase::CRASHED;
+        return;
+    }
+    sample.verdict = SampleCase::RUNNING;
+    active++;
+}
+
+void SampleRunner::judge(size_t i) {
+    SampleCase& sample = samples[i];
+    const ChildProcess& process = *processes[i];
+    const struct rusage& used = process.usage();
+    sample.status = process.status();
+    sample.wall = process.seconds();
+    sample.cpu = used.ru_utime.tv_sec + used.ru_stime.tv_sec +
+                 (used.ru_utime.tv_usec + used.ru_stime.tv_usec) / 1e6;
+    sample.peakKb = used.ru_maxrss;
+    if (sample.verdict != SampleCase::RUNNING) return;  // already judged
+
+    if (!WIFEXITED(sample.status) || WEXITSTATUS(sample.status) != 0)
+        sample.verdict = SampleCase::CRASHED;
+    else if (!sample.hasExpected)
+        sample.verdict = SampleCase::RAN;
+    else if (sameAnswer(sample.output, sample.expected, sample.wrongLine))
+        sample.verdict = SampleCase::PASSED;
+    else
+        sample.verdict = SampleCase::WRONG;
+}
@@ -0,0 +1,91 @@
+#ifndef CP_EDITOR_SAMPLE_RUNNER_H
+#define CP_EDITOR_SAMPLE_RUNNER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "child_process.h"
+
+constexpr double SAMPLE_TIME_LIMIT = 10;  // seconds before a case is killed
+constexpr size_t SAMPLE_OUTPUT_LIMIT = 64 << 20;  // bytes a case may print
+
+// a sample test: an input file and the answer expected for it
+struct SampleCase {
+    enum Verdict {
+        WAITING,
+        RUNNING,
+        PASSED,
+        WRONG,
+        RAN,  // finished, but there is no answer to compare with
+        CRASHED,
+        TIMED_OUT,
+        TOO_MUCH_OUTPUT,
+    };
+
+    std::string name;      // the input file without .in
+    std::string input;     // path of the input
+    std::string expected;  // contents of the .out file
+    bool hasExpected;
+    Verdict verdict;
+    std::string output;  // what the program printed to stdout
+    int status;          // wait status of the program
+    double wall, cpu;    // seconds
+    long peakKb;         // peak resident set size
+    size_t wrongLine;    // first line that differs, from 1, if WRONG
+};
+
+/**
+ * @brief runs a program on sample inputs, several at once
+ *
+ * Up to one process per core runs at a time. Nothing blocks: the owner
+ * polls the output pipes of the running cases and calls poll(), which
+ * reads what came, collects the cases that ended with their wall time, CPU
+ * time and peak memory from wait4() and starts the next ones. Outputs are
+ * compared with the expected ones line by line, ignoring the whitespace at
+ * the end of the lines and the empty lines at the end.
+ */
+class SampleRunner {
+public:
+    explicit SampleRunner(double timeLimit = SAMPLE_TIME_LIMIT);
+
+    // the *.in files next to source, in natural order (2.in before 10.in)
+    static std::vector<std::string> findInputs(const std::string& source);
+    // true if output is an accepted answer for expected, line set to the
+    // first line that differs otherwise
+    static bool sameAnswer(const std::string& output,
+                           const std::string& expected, size_t& line);
+
+    // run binary on every input, workers at a time or one per core if 0
+    void start(const std::string& binary,
+               const std::vector<std::string>& inputs, unsigned workers = 0);
+    // kill the cases that run, the others stay WAITING
+    void stop();
+    bool running() const { return active > 0; }
+
+    // output pipes of the cases running
+    void outputFds(std::vector<int>& fds) const;
+    // read the outputs and go on, true if a verdict changed
+    bool poll();
+
+    const std::vector<SampleCase>& cases() const { return samples; }
+    size_t count(SampleCase::Verdict verdict) const;
+
+private:
+    // start cases until every worker has one
+    void fill();
+    void launch(size_t i);
+    // the process of case i is finished
+    void judge(size_t i);
+
+    std::string binary;
+    std::vector<SampleCase> samples;
+    std::vector<std::unique_ptr<ChildProcess>> processes;  // of every case
+    size_t next;      // first case not started
+    size_t active;    // cases running
+    size_t workers;
+    double timeLimit;
+};
+
+#endif  // CP_EDITOR_SAMPLE_RUNNER_H
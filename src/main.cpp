@@ -1,6 +1,7 @@
 /*** includes ***/
-#include <ctype.h>
-#include <stdarg.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <termios.h>
@@ -9,65 +10,27 @@
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
-#include <fstream>
+#include <cstring>
+#include <ctime>
 #include <string>
 #include <vector>
 
-constexpr int TAB_SIZE = 8;
-
-enum EditorKey {
-    BACKSPACE = 127,
-    ARROW_LEFT = 1000,
-    ARROW_RIGHT,
-    ARROW_UP,
-    ARROW_DOWN,
-    DEL_KEY,
-    HOME_KEY,
-    END_KEY,
-    PAGE_UP,
-    PAGE_DOWN
-};
-
-/*** data ***/
-struct EditorConfig {
-    int cursorX, cursorY;  // cursor positions in the file
-    int cursorRX;          // cursor position in the render line
-    int screenRows, screenCols;
-    int rowOffset, colOffset;          // screen position in the file
-    std::vector<std::string> lines;    // actual data in the file opened
-    std::vector<std::string> renders;  // rendered data on this editor
-    std::string filename;
-    std::string statusMsg;
-    time_t statusMsgTime;
-    struct termios orig_termios;
-    bool modified;
-};
-
-EditorConfig g_E;
+#include "editor.h"
+#include "mapped_file.h"
+#include "replay.h"
 
-/*** terminal ***/
-void writeTerminal(const void* buf, size_t n) {
-    if (write(STDOUT_FILENO,  // from unistd.h
-              buf, n)) {
-    } else {
-    }
-}
+const int INDEX_PROGRESS_MS = 100;  // between redraws while indexing
+const int SAMPLE_TICK_MS = 100;  // between checks of the sample time limits
 
-void clearScreen(std::string& buf) {
-    buf += "\x1b[2J";  // \x1b -> escape character
-                       // \x1b[ instructs terminal to format texts
-                       // J command to clear screen
-                       // 2 for entire sreen
-    buf += "\x1b[H";   // H command to position the cursor
-}
+const char* const HELP_MESSAGE =
+    "Help: Ctrl-s = save | Ctrl-f = find | Ctrl-z/y = undo/redo | "
+    "Ctrl-n = complete | Ctrl-r = run | Ctrl-q = quit";
 
-void die(const char* s) {
-    // clearScreen();
-    perror(s);
-    exit(1);
-}
+/*** terminal ***/
 
 void disableRawMode() {
+    const char* buf = "\x1b[?2004l";  // bracketed paste off
+    writeTerminal(buf, strlen(buf));
     if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_E.orig_termios) == -1)
         die("tcsetattr");
 }
@@ -95,76 +58,39 @@ void enableRawMode() {
     raw.c_cflag |= (CS8);   // set character size to 8bits per byte
     raw.c_oflag &= ~(OPOST  // not translate '\n' to "\r\n"
     );
+    // the main loop waits for input with poll(), the timeout only limits
+    // how long readKey() waits for the rest of an escape sequence
     raw.c_cc[VMIN] =
         0;  // mimumum number of bytes of input needed before read()
     raw.c_cc[VTIME] =
         1;  // maximum amount of time to wait before read() returns in 100ms
 
     if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) die("tcsetattr");
+
+    // let the terminal mark pasted text, so it is inserted in one go
+    const char* buf = "\x1b[?2004h";
+    writeTerminal(buf, strlen(buf));
 }
 
-int readKey() {
-    int c = '\0';
-    if (read(STDIN_FILENO, &c, 1) == -1 &&
+// read whatever input is available, waiting at most 100ms for it
+bool readInput() {
+    char buf[4096];
+    int n = read(STDIN_FILENO, buf, sizeof(buf));
+    if (n == -1 &&
         errno != EAGAIN  // errno will be set EAGAIN on timeout in Cygwin
     )
         die("read");
+    if (n <= 0) return false;
+    g_E.input.feed(buf, n);
+    return true;
+}
 
-    if (c == '\x1b') {
-        char seq[3];
-
-        // try to read two more bytes, if fails input must have been escape key
-        if (read(STDOUT_FILENO, &seq[0], 1) != 1) return '\x1b';
-        if (read(STDOUT_FILENO, &seq[1], 1) != 1) return '\x1b';
-
-        if (seq[0] == '[') {
-            if (seq[1] >= '0' && seq[1] <= '9') {
-                // read one more bytes
-                if (read(STDIN_FILENO, &seq[2], 1) != 1) return '\x1b';
-                if (seq[2] == '~') {
-                    switch (seq[1]) {
-                        case '1':
-                            return HOME_KEY;
-                        case '3':
-                            return DEL_KEY;
-                        case '4':
-                            return END_KEY;
-                        case '5':
-                            return PAGE_UP;
-                        case '6':
-                            return PAGE_DOWN;
-                        case '7':
-                            return HOME_KEY;
-                        case '8':
-                            return END_KEY;
-                    }
-                }
-            } else {
-                switch (seq[1]) {
-                    case 'A':
-                        return ARROW_UP;
-                    case 'B':
-                        return ARROW_DOWN;
-                    case 'C':
-                        return ARROW_RIGHT;
-                    case 'D':
-                        return ARROW_LEFT;
-                    case 'H':
-                        return HOME_KEY;
-                    case 'F':
-                        return END_KEY;
-                }
-            }
-        } else if (seq[0] == '0') {
-            switch (seq[1]) {
-                case 'H':
-                    return HOME_KEY;
-                case 'F':
-                    return END_KEY;
-            }
-        }
-
-        return '\x1b';
+// next key of the input read so far, 0 if there is none
+int readKey() {
+    int c = g_E.input.next();
+    while (c == InputDecoder::INCOMPLETE) {
+        // the rest of an escape sequence may still be on its way
+        c = readInput() ? g_E.input.next() : g_E.input.next(true);
     }
     return c;
 }
@@ -198,7 +124,7 @@ int getWindowSize(int* rows, int* cols) {
     struct winsize ws;
     if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) {
         if (write(STDOUT_FILENO, "\x1b[999C\x1b[999B", 12) != 12) return -1;
-        return getCursorPosition(&g_E.screenRows, &g_E.screenCols);
+        return getCursorPosition(rows, cols);
     } else {
         *cols = ws.ws_col;
         *rows = ws.ws_row;
@@ -206,349 +132,201 @@ int getWindowSize(int* rows, int* cols) {
     }
 }
 
-void initEditor() {
-    g_E.cursorX = 0;
-    g_E.cursorY = 0;
-    g_E.cursorRX = 0;
-    g_E.rowOffset = 0;
-    g_E.colOffset = 0;
-    g_E.modified = false;
-    if (getWindowSize(&g_E.screenRows, &g_E.screenCols) == -1)
-        die("getWindowSize");
-
-    g_E.statusMsgTime = 0;
-
-    g_E.screenRows -= 2;  // for status lines
-}
-
-std::string convertToRenderingRow(const std::string& line) {
-    // replace tab by spaces
-    std::string render;
-    for (auto& c : line) {
-        if (c == '\t')
-            for (int i = 0; i < TAB_SIZE; ++i) render.push_back(' ');
-        else
-            render.push_back(c);
-    }
-    return render;
+void updateWindowSize() {
+    int rows, cols;
+    if (getWindowSize(&rows, &cols) == -1) die("getWindowSize");
+    setWindowSize(rows, cols);
 }
 
-void editorOpen(const std::string& filename) {
-    std::ifstream ifs(filename);
-    g_E.filename = filename;
-    std::string line;
-    while (std::getline(ifs, line)) {
-        g_E.lines.emplace_back(line);
-        g_E.renders.emplace_back(convertToRenderingRow(line));
-    }
+void handleResize(int) {
+    // only wake up the main loop, it is not safe to redraw from here
+    g_E.resized = 1;
+    wakeUp();
 }
 
-void editorScroll() {
-    if (g_E.cursorY < g_E.lines.size()) {
-        // tab key
-        int rx = 0;
-        for (int i = 0; i < g_E.cursorX; ++i) {
-            if (g_E.lines[g_E.cursorY][i] == '\t')
-                rx += (TAB_SIZE - 1) - (rx % TAB_SIZE);
-            rx++;
-        }
-        g_E.cursorRX = rx;
-    }
+// a build process exited, the main loop collects it
+void handleChild(int) { wakeUp(); }
 
-    if (g_E.cursorRX < g_E.colOffset) {
-        g_E.colOffset = g_E.cursorRX;
+void enableResizeEvents() {
+    if (pipe(g_E.wakePipe) == -1) die("pipe");
+    for (int fd : g_E.wakePipe) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
     }
-    if (g_E.cursorRX >= g_E.colOffset + g_E.screenCols) {
-        g_E.colOffset = g_E.cursorRX - g_E.screenCols + 1;
-    }
-    if (g_E.cursorY < g_E.rowOffset) {
-        g_E.rowOffset = g_E.cursorY;
-    }
-    if (g_E.cursorY >= g_E.rowOffset + g_E.screenRows) {
-        g_E.rowOffset = g_E.cursorY - g_E.screenRows + 1;
-    }
-}
 
-constexpr char ctrlWith(char c) { return (c & 0x1f); }
-
-void moveCursor(int key) {
-    std::string currentLine =
-        (g_E.cursorY >= g_E.lines.size()) ? "" : g_E.lines[g_E.cursorY];
-    switch (key) {
-        case ARROW_LEFT:
-            if (g_E.cursorX > 0) {  // not first character in current line
-                g_E.cursorX--;
-            } else if (g_E.cursorY > 0) {  // not first line
-                // move cursor to the end of previous line
-                g_E.cursorY--;
-                g_E.cursorX = g_E.lines[g_E.cursorY].size();
-            }
-            break;
-        case ARROW_RIGHT:
-            // limit cursor to the end of current line
-            if (currentLine.size() > 0 && g_E.cursorX < currentLine.size())
-                g_E.cursorX++;
-            else if (g_E.cursorY < g_E.lines.size() &&
-                     g_E.cursorX == currentLine.size()) {
-                // move cursor to the beginning of next line
-                g_E.cursorY++;
-                g_E.cursorX = 0;
-            }
-            break;
-        case ARROW_UP:
-            if (g_E.cursorY > 0) g_E.cursorY--;
-            break;
-        case ARROW_DOWN:
-            if (g_E.cursorY < g_E.lines.size()) g_E.cursorY++;
-            break;
-    }
-    // snap back to the end of line if curosr is moved to the past of line
-    currentLine =
-        (g_E.cursorY >= g_E.lines.size()) ? "" : g_E.lines[g_E.cursorY];
-    int rowLen = currentLine.size() ? currentLine.size() : 0;
-    if (g_E.cursorX > rowLen) g_E.cursorX = rowLen;
+    struct sigaction sa;
+    sa.sa_handler = handleResize;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    if (sigaction(SIGWINCH, &sa, nullptr) == -1) die("sigaction");
+    sa.sa_handler = handleChild;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    if (sigaction(SIGCHLD, &sa, nullptr) == -1) die("sigaction");
 }
 
-void save() {
-    if (g_E.filename.size() == 0) return;
-
-    std::string out;
-    for (auto& line : g_E.lines) {
-        out += line + "\n";
+/**
+ * @brief block until something happens that may change the screen
+ *
+ * Wakes up on input, on a window resize, when a background save or
+ * indexing is done, when a build process prints something or exits and
+ * when the status message expires, so an idle editor does not use any CPU.
+ * While the file on screen is indexed it also wakes up to show the
+ * progress, and while samples run to enforce their time limit. While the
+ * match of the bracket at the cursor is pending it doesn't wait at all.
+ * @return true if a key can be read
+ */
+bool waitForEvent() {
+    static std::vector<int> outputs;
+    static std::vector<struct pollfd> fds;
+    outputs.clear();
+    buildOutputFds(outputs);
+    fds.resize(2 + outputs.size());
+    fds[0].fd = STDIN_FILENO;
+    fds[1].fd = g_E.wakePipe[0];
+    for (size_t i = 0; i < outputs.size(); ++i) fds[2 + i].fd = outputs[i];
+    for (struct pollfd& fd : fds) fd.events = POLLIN;
+
+    int timeout = -1;
+    if (!g_E.statusMsg.empty()) {
+        time_t left = g_E.statusMsgTime + STATUS_MSG_TIMEOUT - time(nullptr);
+        if (left > 0) timeout = left * 1000;
     }
-
-    std::ofstream ofs(g_E.filename);
-    ofs << out;
-}
-
-void deleteChar() {
-    if (g_E.cursorY == g_E.lines.size()) return;
-    if (g_E.cursorY == 0 && g_E.cursorX == 0) return;
-    if (g_E.cursorX > 0) {
-        int xpos = g_E.cursorX;
-        const std::string& org = g_E.lines[g_E.cursorY];
-        g_E.lines[g_E.cursorY] =
-            org.substr(0, xpos - 1) + org.substr(xpos, org.size() - (xpos));
-        g_E.renders[g_E.cursorY] =
-            convertToRenderingRow(g_E.lines[g_E.cursorY]);
-        g_E.cursorX--;
-    } else {  // back space at the start of line
-        g_E.cursorX = g_E.lines[g_E.cursorY - 1].size();
-        g_E.lines[g_E.cursorY - 1] += g_E.lines[g_E.cursorY];
-        g_E.renders[g_E.cursorY - 1] += g_E.renders[g_E.cursorY];
-        g_E.lines.erase(g_E.lines.begin() + g_E.cursorY);
-        g_E.renders.erase(g_E.renders.begin() + g_E.cursorY);
-        g_E.cursorY--;
+    // redraw the progress of the indexing now and then
+    if (g_E.doc->indexing && (timeout == -1 || timeout > INDEX_PROGRESS_MS))
+        timeout = INDEX_PROGRESS_MS;
+    if (g_E.build.step == BuildState::TESTING &&
+        (timeout == -1 || timeout > SAMPLE_TICK_MS))
+        timeout = SAMPLE_TICK_MS;
+    // the bracket at the cursor is matched over the next frames
+    if (g_E.brackets.pending) timeout = 0;
+
+    if (poll(fds.data(), fds.size(), timeout) == -1) {
+        if (errno == EINTR) return false;
+        die("poll");
     }
-    g_E.modified = true;
-}
-
-void insertLine() {
-    int ypos = g_E.cursorY;
-    g_E.lines.insert(g_E.lines.begin() + ypos + 1, "");
-    g_E.renders.insert(g_E.renders.begin() + ypos + 1, "");
-    int xpos = g_E.cursorX;
-    g_E.renders[ypos + 1] =
-        g_E.renders[ypos].substr(xpos, g_E.renders[ypos].size() - xpos);
-    g_E.renders[ypos] = g_E.renders[ypos].substr(0, xpos);
-    g_E.lines[ypos + 1] =
-        g_E.lines[ypos].substr(xpos, g_E.lines[ypos].size() - xpos);
-    g_E.lines[ypos] = g_E.lines[ypos].substr(0, xpos);
-    g_E.cursorY++;
-    g_E.cursorX = 0;
-}
-
-void processKey(int c) {
-    if (c == 0) return;  // no input
-    switch (c) {
-        case '\r':  // enter key
-            insertLine();
-            break;
-
-        case ctrlWith('q'): {
-            std::string buf;
-            clearScreen(buf);
-            writeTerminal(buf.c_str(), buf.size());
-            exit(0);
-            break;
-        }
-
-        case ctrlWith('s'): {
-            save();
-            break;
-        }
-
-        case HOME_KEY:
-            g_E.cursorX = 0;
-            break;
-        case END_KEY:
-            if (g_E.cursorY < g_E.lines.size())
-                g_E.cursorX = g_E.lines[g_E.cursorY].size();
-            break;
-
-        case BACKSPACE:
-        case ctrlWith('h'):
-        case DEL_KEY:
-            if (c == DEL_KEY) moveCursor(ARROW_RIGHT);
-            deleteChar();
-            break;
-
-        case PAGE_UP:
-        case PAGE_DOWN: {
-            if (c == PAGE_UP) {
-                // set cursor position to top of screen
-                g_E.cursorY = g_E.rowOffset;
-            } else if (c == PAGE_DOWN) {
-                // set curosr position to bottom of screen
-                g_E.cursorY = g_E.rowOffset + g_E.screenRows - 1;
-                if (g_E.cursorY > g_E.lines.size())
-                    g_E.cursorY = g_E.lines.size();
-            }
-            // go up number of screen row times
-            int times = g_E.screenRows;
-            while (times--) moveCursor(c == PAGE_UP ? ARROW_UP : ARROW_DOWN);
-            break;
-        }
 
-        case ARROW_DOWN:
-        case ARROW_UP:
-        case ARROW_LEFT:
-        case ARROW_RIGHT:
-            moveCursor(c);
-            break;
-
-        case ctrlWith('l'):  // refresh key in traditional terminal app
-        case '\x1b':         // escape key
-            break;
-
-        default: {
-            if (g_E.cursorY == g_E.lines.size()) {
-                std::string toBeAdd = "";
-                g_E.lines.emplace_back(toBeAdd);
-                g_E.renders.emplace_back(convertToRenderingRow(toBeAdd));
-            }
-            int y = g_E.cursorY;
-            g_E.lines[y].insert(g_E.cursorX, 1, c);
-            g_E.renders[y] = convertToRenderingRow(g_E.lines[y]);
-            g_E.cursorX++;
-            break;
+    if (fds[1].revents & POLLIN) {
+        char drain[64];
+        while (read(g_E.wakePipe[0], drain, sizeof(drain)) > 0) {
         }
-    }
-}
-
-void drawRows(std::string& buf) {
-    for (int y = 0; y < g_E.screenRows; ++y) {
-        int filerow = y + g_E.rowOffset;
-        if (filerow >= g_E.lines.size()) {
-            if ((g_E.lines.size() == 0) && (y == g_E.screenRows / 3)) {
-                char welcome[80];
-                int wellen = snprintf(welcome, sizeof(welcome),
-                                      "cp editor -- version %s", "0.0.1");
-                if (wellen > g_E.screenCols) wellen = g_E.screenCols;
-                int padding = (g_E.screenCols - wellen) / 2;
-                if (padding) {
-                    buf += "~";
-                    padding--;
-                }
-                while (padding--) buf += " ";
-                buf += welcome;
-            } else {
-                // draw left side tilde
-                buf += "~";
-            }
-        } else {
-            int len = g_E.renders[filerow].size();
-            if (len > g_E.screenCols) len = g_E.screenCols;
-            const std::string& toBeAdd = g_E.renders[filerow];
-            if (0 < toBeAdd.size() && (g_E.colOffset < toBeAdd.size()))
-                buf += toBeAdd.substr(g_E.colOffset);
+        if (g_E.resized) {
+            g_E.resized = 0;
+            updateWindowSize();
         }
-
-        buf += "\x1b[K";  // clear one line
-        // if (y < g_E.screenRows - 1)
-        buf += "\r\n";
+        finishSave();
+        finishIndexing();
     }
+    pollBuild();
+    return fds[0].revents & POLLIN;
 }
 
-void drawStatusBar(std::string& buf, int currentC) {
-    buf += "\x1b[7m";  // switch color mode to inverted
-
-    char status[80], rstatus[80];
-    int len =
-        snprintf(status, sizeof(status),
-                 "Filename: %.20s - %d lines, key pressed: %c(%d)",
-                 g_E.filename.size() > 0 ? g_E.filename.c_str() : "[No Name]",
-                 static_cast<int>(g_E.lines.size()),
-                 static_cast<char>(currentC), currentC);
-    if (len > g_E.screenCols) len = g_E.screenCols;
-    buf += std::string(status);
-
-    int rlen = snprintf(rstatus, sizeof(rstatus), "CursorPosition Y : %d/%d",
-                        g_E.cursorY + 1, static_cast<int>(g_E.lines.size()));
-
-    while (len < g_E.screenCols) {
-        if (g_E.screenCols - len == rlen) {
-            // append right-side status
-            buf += std::string(rstatus);
-            break;
-        }
-        buf += " ";
-        len++;
-    }
-    buf += "\x1b[m";  // switch back to color mode normal
-    buf += "\r\n";
-}
+/*** documents ***/
 
-void drawMessageBar(std::string& buf) {
-    buf += "\x1b[K";  // clear one line
-    int len = g_E.statusMsg.size();
-    if (len > g_E.screenCols) len = g_E.screenCols;
-    if (len && (time(nullptr) - g_E.statusMsgTime < 5)) {
-        buf += g_E.statusMsg.substr(0, len);
-    }
+// open the first file, the others are read when they are first shown
+void openFiles(const std::vector<const char*>& files) {
+    if (files.empty()) return;
+    editorOpen(files[0]);
+    for (size_t i = 1; i < files.size(); ++i) addDocument(files[i]);
 }
 
-void refreshScreen(int currentC) {
-    editorScroll();
+/*** replay ***/
 
-    std::string buf;
-    buf += "\x1b[?25l";  // hide cursor (l is reset command)
-    buf += "\x1b[H";     // H command to position the cursor
-    drawRows(buf);
-    drawStatusBar(buf, currentC);
-    drawMessageBar(buf);
+/**
+ * @brief run the keys recorded in path without a terminal
+ *
+ * The screen is rows x cols and what the keys cost is printed to stdout.
+ */
+int replay(const char* path, int rows, int cols,
+           const std::vector<const char*>& files) {
+    MappedFile keys;
+    if (!keys.open(path)) die(path);
 
-    char cbuf[32];
-    snprintf(cbuf, sizeof(cbuf), "\x1b[%d;%dH",
-             (g_E.cursorY - g_E.rowOffset) + 1,
-             (g_E.cursorRX - g_E.colOffset) + 1);
-    buf += std::string(cbuf);
+    initEditor();
+    setWindowSize(rows, cols);
+    openFiles(files);
+    setStatusMessage(HELP_MESSAGE);
+    composeFrame(0);
+
+    std::string input;
+    if (keys.size() > 0) input.assign(keys.data(), keys.size());
+    ReplayStats stats = replayKeys(input);
+    printReplayStats(stats, stdout);
+    return 0;
+}
 
-    buf += "\x1b[?25h";  // show cursor again (h is set command)
+/*** profile ***/
 
-    writeTerminal(buf.c_str(), buf.size());
-}
+const size_t TRACE_FRAMES = 1 << 16;  // the last frames kept for --trace
+const char* g_tracePath = nullptr;
 
-void setStatusMessage(const std::string& msg) {
-    g_E.statusMsg = msg;
-    g_E.statusMsgTime = time(nullptr);
+void writeTraceFile() {
+    FILE* out = fopen(g_tracePath, "w");
+    if (!out) {
+        perror(g_tracePath);
+        return;
+    }
+    g_E.profile.writeTrace(out);
+    fclose(out);
 }
 
 /*** init ***/
 int main(int argc, const char* argv[]) {
+    std::vector<const char*> files;
+    const char* keys = nullptr;
+    int rows = 24, cols = 80;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            keys = argv[++i];
+        } else if (strcmp(argv[i], "--view") == 0) {
+            g_E.viewThreshold = 0;  // every file
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            g_tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &rows, &cols) != 2 || rows < 3 ||
+                cols < 1) {
+                fprintf(stderr, "--size wants ROWSxCOLS, like 50x200\n");
+                return 1;
+            }
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (keys) return replay(keys, rows, cols, files);
+
     enableRawMode();
     initEditor();
-
-    if (argc >= 2) {
-        editorOpen(argv[1]);
+    g_E.journal = true;
+    updateWindowSize();
+    enableResizeEvents();
+    if (g_tracePath) {
+        // written when the editor exits
+        g_E.profile.setTrace(TRACE_FRAMES);
+        atexit(writeTraceFile);
     }
 
-    setStatusMessage("Help: Ctrl-q = quit");
+    // a message about opening the files, like a recovery, goes over the help
+    setStatusMessage(HELP_MESSAGE);
+    openFiles(files);
 
+    refreshScreen(0);
     while (true) {
-        int c = readKey();
+        int c = 0;
+        bool input = waitForEvent();
+        g_E.profile.beginFrame();
+        if (input && readInput()) {
+            // handle every key that has arrived before drawing a frame
+            int key;
+            while ((key = readKey()) != 0) {
+                g_E.profile.mark(PHASE_DECODE);
+                processKey(key);
+                g_E.profile.mark(PHASE_PROCESS);
+                c = key;
+            }
+            g_E.profile.mark(PHASE_DECODE);
+            flushJournals();  // one write for every key of the frame
+            g_E.profile.mark(PHASE_PROCESS);
+        }
         refreshScreen(c);
-        processKey(c);
     }
 
     return 0;
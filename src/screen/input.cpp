@@ -0,0 +1,161 @@
+#include "input.h"
+
+#include <algorithm>
+
+namespace {
+const char PASTE_END[] = "\x1b[201~";
+const size_t PASTE_END_LEN = sizeof(PASTE_END) - 1;
+}  // namespace
+
+const int InputDecoder::INCOMPLETE;
+
+InputDecoder::InputDecoder() : pos(0), inPaste(false), pasteScan(0) {}
+
+void InputDecoder::feed(const char* data, size_t n) {
+    // drop the decoded bytes before they pile up
+    if (pos > 0 && pos == pending.size()) {
+        pending.clear();
+        pasteScan = pos = 0;
+    } else if (pos > 4096 && pos * 2 > pending.size()) {
+        pending.erase(0, pos);
+        pasteScan -= pos;
+        pos = 0;
+    }
+    pending.append(data, n);
+}
+
+int InputDecoder::next(bool flush) {
+    while (true) {
+        if (inPaste) {
+            int key = decodePaste(flush);
+            if (key != 0 || inPaste) return key;
+            continue;  // an empty paste
+        }
+        if (empty()) return 0;
+
+        char c = pending[pos];
+        if (c != '\x1b') {
+            pos++;
+            return static_cast<unsigned char>(c);
+        }
+        int key = decodeEscape(flush);
+        if (key != 0) return key;
+        // the sequence was consumed without producing a key
+    }
+}
+
+int InputDecoder::decodeEscape(bool flush) {
+    size_t end = pending.size();
+    size_t p = pos + 1;
+    if (p == end) {
+        if (!flush) return INCOMPLETE;
+        pos = p;
+        return '\x1b';
+    }
+
+    if (pending[p] == 'O') {
+        if (p + 1 == end) {
+            if (!flush) return INCOMPLETE;
+            pos = end;
+            return '\x1b';
+        }
+        pos = p + 2;
+        switch (pending[p + 1]) {
+            case 'H':
+                return HOME_KEY;
+            case 'F':
+                return END_KEY;
+        }
+        return '\x1b';
+    }
+
+    if (pending[p] != '[') {
+        // an escape followed by a normal key, e.g. Alt-x
+        pos = p;
+        return '\x1b';
+    }
+
+    // control sequence: parameter bytes followed by a final byte
+    size_t params = ++p;
+    while (p < end && 0x20 <= pending[p] && pending[p] < 0x40) p++;
+    if (p == end) {
+        if (!flush) return INCOMPLETE;
+        pos = end;
+        return '\x1b';
+    }
+    std::string arg = pending.substr(params, p - params);
+    char final = pending[p];
+    pos = p + 1;
+
+    if (final == '~') {
+        if (arg == "1" || arg == "7") return HOME_KEY;
+        if (arg == "4" || arg == "8") return END_KEY;
+        if (arg == "3") return DEL_KEY;
+        if (arg == "5") return PAGE_UP;
+        if (arg == "6") return PAGE_DOWN;
+        if (arg == "200") {
+            inPaste = true;
+            pasteScan = pos;
+            return 0;
+        }
+        if (arg == "201") return 0;  // end of a paste we didn't see start
+        return '\x1b';
+    }
+    if (arg == "1;3" && (final == 'A' || final == 'B'))  // Alt is 3
+        return final == 'A' ? ALT_UP : ALT_DOWN;
+    if (arg == "1;5") {  // xterm reports Ctrl as modifier 5
+        switch (final) {
+            case 'C':
+                return CTRL_RIGHT;
+            case 'D':
+                return CTRL_LEFT;
+            case 'H':
+                return CTRL_HOME;
+            case 'F':
+                return CTRL_END;
+        }
+    }
+    switch (final) {
+        case 'A':
+            return ARROW_UP;
+        case 'B':
+            return ARROW_DOWN;
+        case 'C':
+            return ARROW_RIGHT;
+        case 'D':
+            return ARROW_LEFT;
+        case 'H':
+            return HOME_KEY;
+        case 'F':
+            return END_KEY;
+    }
+    return '\x1b';
+}
+
+int InputDecoder::decodePaste(bool flush) {
+    size_t end = pending.find(PASTE_END, pasteScan);
+    if (end != std::string::npos) {
+        pasted.assign(pending, pos, end - pos);
+        pos = end + PASTE_END_LEN;
+        inPaste = false;
+        return pasted.empty() ? 0 : PASTE;
+    }
+
+    // the end marker may be cut off at the end of the input
+    size_t safe = pending.size();
+    for (size_t k = std::min(safe - pos, PASTE_END_LEN - 1); k > 0; --k) {
+        if (pending.compare(safe - k, k, PASTE_END, k) == 0) {
+            safe -= k;
+            break;
+        }
+    }
+    pasteScan = safe;
+    if (!flush) return INCOMPLETE;
+
+    // the terminal paused in the middle of a paste, hand out what we have
+    // and keep collecting the rest
+    pasted.assign(pending, pos, safe - pos);
+    pos = safe;
+    if (pasted.empty()) return 0;
+    return PASTE;
+}
@@ -0,0 +1,67 @@
+#ifndef CP_EDITOR_INPUT_H
+#define CP_EDITOR_INPUT_H
+
+#include <cstddef>
+#include <string>
+
+enum EditorKey {
+    BACKSPACE = 127,
+    ARROW_LEFT = 1000,
+    ARROW_RIGHT,
+    ARROW_UP,
+    ARROW_DOWN,
+    DEL_KEY,
+    HOME_KEY,
+    END_KEY,
+    PAGE_UP,
+    PAGE_DOWN,
+    CTRL_LEFT,  // arrows and Home/End with Ctrl held
+    CTRL_RIGHT,
+    CTRL_HOME,
+    CTRL_END,
+    ALT_UP,  // arrows with Alt held
+    ALT_DOWN,
+    PASTE  // text of a bracketed paste, see InputDecoder::paste()
+};
+
+/**
+ * @brief turns the bytes read from the terminal into keys
+ *
+ * Bytes are appended with feed() in whatever chunks read() returns them,
+ * and next() decodes one key at a time. Text between the bracketed paste
+ * markers is returned as a single PASTE key.
+ */
+class InputDecoder {
+public:
+    // next() needs more bytes to decide what the key is
+    static const int INCOMPLETE = -1;
+
+    InputDecoder();
+
+    void feed(const char* data, size_t n);
+    bool empty() const { return pos == pending.size(); }
+
+    /**
+     * @brief decode the next key
+     *
+     * Returns 0 if there is no input. If the input ends in the middle of an
+     * escape sequence, returns INCOMPLETE unless flush is set, in which case
+     * the bytes seen so far are decoded as they are (a lone escape key).
+     */
+    int next(bool flush = false);
+
+    // text of the last PASTE key
+    const std::string& paste() const { return pasted; }
+
+private:
+    int decodeEscape(bool flush);
+    int decodePaste(bool flush);
+
+    std::string pending;  // bytes not decoded yet start at pos
+    size_t pos;
+    bool inPaste;
+    size_t pasteScan;  // where to continue looking for the end of a paste
+    std::string pasted;
+};
+
+#endif  // CP_EDITOR_INPUT_H
@@ -0,0 +1,99 @@
+#include "screen.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+Screen::Screen() : cursorRow(0), cursorCol(0) {}
+
+void Screen::resize(int rows) {
+    shown.assign(rows, std::string());
+    known.assign(rows, false);
+    dirty.assign(rows, true);
+    cursorRow = cursorCol = 0;
+}
+
+void Screen::invalidate() { dirty.assign(dirty.size(), true); }
+
+void Screen::invalidateRow(int row) {
+    if (0 <= row && row < rows()) dirty[row] = true;
+}
+
+void Screen::invalidateFrom(int row) {
+    if (row < 0) row = 0;
+    for (; row < rows(); ++row) dirty[row] = true;
+}
+
+void Screen::scroll(int top, int bottom, int n, std::string& buf) {
+    top = std::max(top, 0);
+    bottom = std::min(bottom, rows());
+    if (n == 0 || top >= bottom) return;
+    if (std::abs(n) >= bottom - top) {
+        for (int row = top; row < bottom; ++row) dirty[row] = true;
+        return;
+    }
+
+    // the region is reset right away, the cursor goes home with it
+    char cbuf[48];
+    snprintf(cbuf, sizeof(cbuf), "\x1b[%d;%dr\x1b[%d%c\x1b[r", top + 1, bottom,
+             std::abs(n), n > 0 ? 'S' : 'T');
+    buf += cbuf;
+    cursorRow = cursorCol = 0;
+
+    if (n > 0) {
+        for (int row = top; row < bottom - n; ++row) {
+            shown[row].swap(shown[row + n]);
+            known[row] = known[row + n];
+            dirty[row] = dirty[row + n];
+        }
+    } else {
+        for (int row = bottom - 1; row >= top - n; --row) {
+            shown[row].swap(shown[row + n]);
+            known[row] = known[row + n];
+            dirty[row] = dirty[row + n];
+        }
+    }
+    int first = n > 0 ? bottom - n : top, last = n > 0 ? bottom : top - n;
+    for (int row = first; row < last; ++row) {
+        shown[row].clear();
+        known[row] = true;  // blank
+        dirty[row] = true;
+    }
+}
+
+void Screen::updateRow(int row, const std::string& content, std::string& buf) {
+    dirty[row] = false;
+    if (known[row] && shown[row] == content) return;
+
+    // keep the unchanged beginning of the row as long as every byte of it is
+    // one column wide, so the byte offset is also the column
+    size_t same = 0;
+    if (known[row]) {
+        const std::string& old = shown[row];
+        while (same < old.size() && same < content.size() &&
+               old[same] == content[same] && 0x20 <= content[same] &&
+               content[same] < 0x7f)
+            same++;
+    }
+
+    char cbuf[32];
+    snprintf(cbuf, sizeof(cbuf), "\x1b[%d;%dH", row + 1,
+             static_cast<int>(same) + 1);
+    buf += cbuf;
+    buf.append(content, same, std::string::npos);
+    buf += "\x1b[K";  // clear the rest of the line
+
+    shown[row] = content;
+    known[row] = true;
+    cursorRow = cursorCol = 0;
+}
+
+void Screen::placeCursor(int row, int col, std::string& buf) {
+    if (row == cursorRow && col == cursorCol) return;
+
+    char cbuf[32];
+    snprintf(cbuf, sizeof(cbuf), "\x1b[%d;%dH", row, col);
+    buf += cbuf;
+    cursorRow = row;
+    cursorCol = col;
+}
@@ -0,0 +1,57 @@
+#ifndef CP_EDITOR_SCREEN_H
+#define CP_EDITOR_SCREEN_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief model of what the terminal currently shows
+ *
+ * Rows are marked dirty when the data behind them changes. Only dirty rows
+ * are composed again, and only the ones whose contents actually differ from
+ * the previous frame are sent to the terminal.
+ */
+class Screen {
+public:
+    Screen();
+
+    // forget everything shown, the next frame redraws every row
+    void resize(int rows);
+    int rows() const { return static_cast<int>(shown.size()); }
+
+    // every row has to be composed again (e.g. after scrolling)
+    void invalidate();
+    void invalidateRow(int row);
+    // rows from row to the bottom
+    void invalidateFrom(int row);
+    bool isDirty(int row) const { return dirty[row]; }
+
+    /**
+     * @brief scroll rows [top, bottom) up by n rows, or down if n < 0
+     *
+     * Appends the escape sequences that make the terminal move the rows
+     * itself to buf: a scroll region (DECSTBM) with CSI S or CSI T. The rows
+     * that come into view are blank and dirty, the others keep what they
+     * show. If the whole region scrolls away, it is only invalidated.
+     */
+    void scroll(int top, int bottom, int n, std::string& buf);
+
+    /**
+     * @brief set the contents of a row
+     *
+     * Appends the escape sequences and text to redraw the row to buf unless
+     * the terminal already shows content there.
+     */
+    void updateRow(int row, const std::string& content, std::string& buf);
+
+    // place the terminal cursor (1-based), if it isn't there already
+    void placeCursor(int row, int col, std::string& buf);
+
+private:
+    std::vector<std::string> shown;  // contents on the terminal
+    std::vector<bool> known;         // false if the terminal row is unknown
+    std::vector<bool> dirty;
+    int cursorRow, cursorCol;  // 0 if unknown
+};
+
+#endif  // CP_EDITOR_SCREEN_H
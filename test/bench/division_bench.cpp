@@ -0,0 +1,90 @@
+#include <division.h>
+#include <invariant_division.h>
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using namespace std;
+
+static const size_t COUNT = 1 << 16;  // numerators divided per iteration
+
+// numerators of every size and sign
+static vector<long long> numerators() {
+  vector<long long> out(COUNT);
+  unsigned long long x = 88172645463325252ULL;  // xorshift64
+  for (size_t i = 0; i < COUNT; ++i) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    out[i] = static_cast<long long>(x) >> (i % 48);
+  }
+  return out;
+}
+
+// the denominators of the runs: a modulus, a small one and a power of two
+static long long denominator(benchmark::State &state) {
+  static const long long DENOMINATORS[] = {1000000007, -7, 1 << 20};
+  // unknown to the compiler, like a modulus that is read
+  volatile long long d = DENOMINATORS[state.range(0)];
+  return d;
+}
+
+static void finish(benchmark::State &state) {
+  state.SetItemsProcessed(state.iterations() * COUNT);
+}
+
+static void BM_Operators(benchmark::State &state) {
+  vector<long long> n = numerators(), q(COUNT), r(COUNT);
+  long long d = denominator(state);
+  for (auto _ : state) {
+    for (size_t i = 0; i < COUNT; ++i) {
+      q[i] = n[i] / d;
+      r[i] = n[i] % d;
+    }
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_Operators)->DenseRange(0, 2);
+
+static void BM_Division(benchmark::State &state) {
+  vector<long long> n = numerators();
+  vector<DivisionResult> results(COUNT);
+  long long d = denominator(state);
+  for (auto _ : state) {
+    for (size_t i = 0; i < COUNT; ++i)
+      results[i] = Division(Fraction{n[i], d}).divide();
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_Division)->DenseRange(0, 2);
+
+// the reciprocal one numerator at a time
+static void BM_InvariantScalar(benchmark::State &state) {
+  vector<long long> n = numerators(), q(COUNT), r(COUNT);
+  InvariantDivision division(denominator(state));
+  for (auto _ : state) {
+    for (size_t i = 0; i < COUNT; ++i) {
+      DivisionResult result = division.divide(n[i]);
+      q[i] = result.division;
+      r[i] = result.remainder;
+    }
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_InvariantScalar)->DenseRange(0, 2);
+
+static void BM_InvariantBatch(benchmark::State &state) {
+  vector<long long> n = numerators(), q(COUNT), r(COUNT);
+  InvariantDivision division(denominator(state));
+  for (auto _ : state) {
+    division.divide(n.data(), COUNT, q.data(), r.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_InvariantBatch)->DenseRange(0, 2);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,278 @@
+#include <bracket_index.h>
+#include <editor.h>
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace std;
+
+// every allocation made by the process, to report allocations per operation
+static size_t g_allocations = 0;
+
+// the replacements stay out of line, GCC takes malloc() or free() inlined
+// into a new or delete expression for a mismatched pair
+#define REPLACED __attribute__((noinline))
+
+REPLACED void* operator new(size_t n) {
+  ++g_allocations;
+  void* p = malloc(n ? n : 1);
+  if (!p) throw bad_alloc();
+  return p;
+}
+
+REPLACED void* operator new[](size_t n) { return operator new(n); }
+
+// the whole set the replaced new is paired with
+REPLACED void operator delete(void* p) noexcept { free(p); }
+REPLACED void operator delete[](void* p) noexcept { free(p); }
+REPLACED void operator delete(void* p, size_t) noexcept { free(p); }
+REPLACED void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static const int ROWS = 50;
+static const int COLS = 200;
+
+// C++ looking file of about size bytes, written once under /tmp
+static string syntheticFile(size_t size) {
+  string path = "/tmp/cp_editor_bench_" + to_string(size) + ".cpp";
+  FILE* f = fopen(path.c_str(), "r");
+  if (f) {
+    fclose(f);
+    return path;
+  }
+
+  static const char* lines[] = {
+      "#include <vector>\n",
+      "// sum of the values in the range, in O(n)\n",
+      "long long sum(const std::vector<int>& values) {\n",
+      "    long long total = 0;\n",
+      "    for (size_t i = 0; i < values.size(); ++i) total += values[i];\n",
+      "    return total;  /* never overflows for n < 1e6 */\n",
+      "}\n",
+      "\n",
+      "const char* name = \"cp-editor\\tbenchmark\";\n",
+  };
+  string chunk;
+  while (chunk.size() < 64 * 1024)
+    for (const char* line : lines) chunk += line;
+
+  string tmp = path + ".tmp";
+  f = fopen(tmp.c_str(), "w");
+  if (!f) {
+    perror("fopen");
+    exit(1);
+  }
+  for (size_t written = 0; written < size; written += chunk.size())
+    fwrite(chunk.data(), 1, min(chunk.size(), size - written), f);
+  fclose(f);
+  rename(tmp.c_str(), path.c_str());
+  return path;
+}
+
+// load path whatever its size, up to when it can be edited
+static void load(const string& path) {
+  g_E.viewThreshold = SIZE_MAX;
+  editorOpen(path);
+  if (g_E.doc->indexer.joinable()) g_E.doc->indexer.join();
+  finishIndexing();
+}
+
+static void openFile(const string& path) {
+  initEditor();
+  setWindowSize(ROWS, COLS);
+  g_E.screen.invalidate();
+  load(path);
+  composeFrame(0);
+}
+
+static void reportAllocations(benchmark::State& state, size_t before) {
+  state.counters["allocs"] =
+      benchmark::Counter(static_cast<double>(g_allocations - before),
+                         benchmark::Counter::kAvgIterations);
+}
+
+static void BM_Load(benchmark::State& state) {
+  size_t size = state.range(0);
+  string path = syntheticFile(size);
+  initEditor();
+  size_t before = g_allocations;
+  for (auto _ : state) {
+    load(path);
+    benchmark::DoNotOptimize(g_E.doc->buffer.lineCount());
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_Load)
+    ->RangeMultiplier(32)
+    ->Range(1 << 10, 1 << 30)
+    ->Unit(benchmark::kMillisecond);
+
+// a key and the frame that shows it
+static void BM_Typing(benchmark::State& state) {
+  openFile(syntheticFile(state.range(0)));
+  size_t before = g_allocations;
+  int typed = 0;
+  for (auto _ : state) {
+    // break the line now and then, like a person would
+    int c = ++typed % 64 == 0 ? '\r' : 'a' + typed % 26;
+    processKey(c);
+    benchmark::DoNotOptimize(composeFrame(c).size());
+  }
+  state.SetItemsProcessed(state.iterations());
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_Typing)->Arg(1 << 20)->Arg(1 << 30);
+
+static void splitJoin(benchmark::State& state) {
+  // split the line in its middle
+  for (int i = 0; i < 8; ++i) processKey(ARROW_RIGHT);
+  size_t before = g_allocations;
+  for (auto _ : state) {
+    processKey('\r');
+    composeFrame('\r');
+    processKey(BACKSPACE);
+    benchmark::DoNotOptimize(composeFrame(BACKSPACE).size());
+  }
+  state.SetItemsProcessed(2 * state.iterations());
+  reportAllocations(state, before);
+}
+
+static void BM_SplitJoin(benchmark::State& state) {
+  openFile(syntheticFile(state.range(0)));
+  splitJoin(state);
+}
+BENCHMARK(BM_SplitJoin)->Arg(1 << 20)->Arg(1 << 30);
+
+// the same with the lexer states of the whole file cached, after a look at
+// its end
+static void BM_SplitJoinAllLexed(benchmark::State& state) {
+  openFile(syntheticFile(state.range(0)));
+  processKey(CTRL_END);
+  composeFrame(0);
+  processKey(CTRL_HOME);
+  composeFrame(0);
+  splitJoin(state);
+}
+BENCHMARK(BM_SplitJoinAllLexed)->Arg(1 << 20)->Arg(1 << 27);
+
+// the same with soft wrap on, the wrapped rows follow every edit
+static void BM_WrappedSplitJoin(benchmark::State& state) {
+  openFile(syntheticFile(state.range(0)));
+  processKey(ctrlWith('w'));
+  composeFrame(0);
+  splitJoin(state);
+  processKey(ctrlWith('w'));
+}
+BENCHMARK(BM_WrappedSplitJoin)->Arg(1 << 20)->Arg(1 << 27);
+
+static void BM_PageScrolling(benchmark::State& state) {
+  openFile(syntheticFile(state.range(0)));
+  size_t last = g_E.doc->buffer.lineCount() - 1;
+  size_t before = g_allocations;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    if (static_cast<size_t>(g_E.doc->cursorY) >= last) {
+      // back to the top without timing it
+      state.PauseTiming();
+      g_E.doc->cursorY = g_E.doc->rowOffset = 0;
+      composeFrame(0);
+      state.ResumeTiming();
+    }
+    processKey(PAGE_DOWN);
+    bytes += composeFrame(PAGE_DOWN).size();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["output"] = benchmark::Counter(
+      static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_PageScrolling)->Arg(1 << 20)->Arg(1 << 30);
+
+static void typeKeys(const string& keys) {
+  for (char c : keys) processKey(c);
+}
+
+// replace-all of a name that occurs about once every hundred bytes, and
+// back, from the keys to the frame that shows it
+static void BM_ReplaceAll(benchmark::State& state) {
+  size_t size = state.range(0);
+  openFile(syntheticFile(size));
+  size_t before = g_allocations;
+  bool back = false;
+  for (auto _ : state) {
+    processKey(ctrlWith('\\'));
+    typeKeys(back ? "xs\r" : "values\r");
+    typeKeys(back ? "values\r" : "xs\r");
+    back = !back;
+    benchmark::DoNotOptimize(composeFrame(0).size());
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_ReplaceAll)
+    ->Arg(1 << 20)
+    ->Arg(1 << 27)
+    ->Unit(benchmark::kMillisecond);
+
+// a line broken and joined again in the middle of a function of lines
+// lines, and the match of its brace after each edit
+static void BM_BracketMatch(benchmark::State& state) {
+  size_t lines = state.range(0);
+  TextBuffer buffer;
+  buffer.appendLine("int main() {");
+  for (size_t y = 2; y < lines; ++y) buffer.appendLine("    f(y);");
+  buffer.appendLine("}");
+  BracketIndex index;
+  TextPosition brace{0, 11}, match;
+  // the tree is built over a few matches
+  while (!index.match(buffer, brace, match) && index.pending()) {
+  }
+  size_t y = lines / 2, before = g_allocations;
+  for (auto _ : state) {
+    buffer.splitLine(y, 4);
+    index.invalidate(y);
+    index.insertLines(y + 1, 1);
+    index.match(buffer, brace, match);
+    buffer.joinLines(y);
+    index.eraseLines(y + 1, 1);
+    index.invalidate(y);
+    index.match(buffer, brace, match);
+    benchmark::DoNotOptimize(match.y);
+  }
+  state.SetItemsProcessed(2 * state.iterations());
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_BracketMatch)->Arg(1 << 10)->Arg(1 << 20);
+
+// every row composed again, the terminal already shows all of them
+static void BM_ComposeFrame(benchmark::State& state) {
+  openFile(syntheticFile(1 << 20));
+  size_t before = g_allocations;
+  for (auto _ : state) {
+    g_E.screen.invalidate();
+    benchmark::DoNotOptimize(composeFrame(0).size());
+  }
+  state.SetItemsProcessed(state.iterations());
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_ComposeFrame);
+
+// a full redraw, as after the terminal lost what it showed
+static void BM_RedrawFrame(benchmark::State& state) {
+  openFile(syntheticFile(1 << 20));
+  size_t before = g_allocations;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    g_E.screen.resize(ROWS);
+    bytes += composeFrame(0).size();
+  }
+  state.SetBytesProcessed(bytes);
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_RedrawFrame);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,59 @@
+#include <block_pool.h>
+#include <buffer.h>
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST(BlockPoolTest, ReusesReleasedBlocks) {
+  BlockPool pool(24, 4);
+  EXPECT_EQ(pool.blockSize() % alignof(max_align_t), 0u);
+  EXPECT_GE(pool.blockSize(), 24u);
+
+  vector<void*> blocks;
+  for (int i = 0; i < 6; ++i) blocks.push_back(pool.allocate());
+  EXPECT_EQ(set<void*>(blocks.begin(), blocks.end()).size(), 6u);
+  EXPECT_EQ(pool.used(), 6u);
+  EXPECT_EQ(pool.reserved(), 8u);
+  for (void* p : blocks)
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignof(max_align_t), 0u);
+
+  pool.release(blocks[2]);
+  EXPECT_EQ(pool.allocate(), blocks[2]);
+  for (void* p : blocks) pool.release(p);
+  EXPECT_EQ(pool.used(), 0u);
+  for (int i = 0; i < 8; ++i) pool.allocate();
+  EXPECT_EQ(pool.reserved(), 8u);
+}
+
+TEST(BlockPoolTest, BuffersShareNodes) {
+  shared_ptr<BlockPool> pool = TextBuffer::newPool();
+  {
+    TextBuffer a(pool);
+    for (int i = 0; i < 100; ++i) a.appendLine(to_string(i));
+    EXPECT_EQ(pool->used(), 100u);
+  }
+  EXPECT_EQ(pool->used(), 0u);
+  size_t reserved = pool->reserved();
+
+  TextBuffer b(pool), c(pool);
+  for (int i = 0; i < 50; ++i) {
+    b.appendLine("b");
+    c.appendLine("c");
+  }
+  EXPECT_EQ(pool->reserved(), reserved);  // the nodes of a were reused
+  EXPECT_EQ(b.line(49).str(), "b");
+  EXPECT_EQ(c.line(0).str(), "c");
+  b.eraseLine(0);
+  EXPECT_EQ(pool->used(), 99u);
+}
+
+TEST(BlockPoolTest, RejectsSmallBlocks) {
+  EXPECT_THROW(TextBuffer(make_shared<BlockPool>(8)), invalid_argument);
+}
@@ -0,0 +1,173 @@
+#include <bracket_index.h>
+#include <buffer.h>
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class BracketIndexTest : public ::testing::Test {
+
+protected:
+  TextBuffer buffer;
+  BracketIndex index;
+
+  void fill(const vector<string>& lines) {
+    buffer.clear();
+    for (const string& line : lines) buffer.appendLine(line);
+    index.clear();
+  }
+
+  // position of the match of the bracket at (y, x), or (-1, -1)
+  pair<long, long> matchOf(size_t y, size_t x) {
+    TextPosition match;
+    if (!index.match(buffer, TextPosition{y, x}, match))
+      return make_pair(-1L, -1L);
+    return make_pair(static_cast<long>(match.y), static_cast<long>(match.x));
+  }
+
+  // the same, scanning every character
+  pair<long, long> naiveMatchOf(size_t y, size_t x) {
+    char c = buffer.line(y)[x];
+    string open = "([{", close = ")]}";
+    bool forward = open.find(c) != string::npos;
+    char o = forward ? c : open[close.find(c)];
+    char e = forward ? close[open.find(c)] : c;
+    long depth = 0;
+    long cy = y, cx = x;
+    while (cy >= 0 && cy < static_cast<long>(buffer.lineCount())) {
+      LineView line = buffer.line(cy);
+      while (cx >= 0 && cx < static_cast<long>(line.size())) {
+        if (line[cx] == o) depth += forward ? 1 : -1;
+        if (line[cx] == e) depth += forward ? -1 : 1;
+        if (depth == 0) return make_pair(cy, cx);
+        cx += forward ? 1 : -1;
+      }
+      cy += forward ? 1 : -1;
+      if (cy >= 0 && cy < static_cast<long>(buffer.lineCount()))
+        cx = forward ? 0 : static_cast<long>(buffer.line(cy).size()) - 1;
+    }
+    return make_pair(-1L, -1L);
+  }
+};
+
+TEST_F(BracketIndexTest, MatchesWithinALine) {
+  fill({"f(a[1], (b)) {}"});
+  EXPECT_EQ(matchOf(0, 1), make_pair(0L, 11L));
+  EXPECT_EQ(matchOf(0, 11), make_pair(0L, 1L));
+  EXPECT_EQ(matchOf(0, 3), make_pair(0L, 5L));
+  EXPECT_EQ(matchOf(0, 13), make_pair(0L, 14L));
+  EXPECT_EQ(matchOf(0, 0), make_pair(-1L, -1L));  // not a bracket
+  EXPECT_EQ(index.linesLexed(), 4u);  // no tree for that
+}
+
+TEST_F(BracketIndexTest, MatchesAcrossLines) {
+  fill({"int main() {", "  for (;;) {", "    g(x);", "  }", "  {", "}"});
+  EXPECT_EQ(matchOf(0, 11), make_pair(-1L, -1L));  // the { of line 4 is open
+  EXPECT_EQ(matchOf(1, 11), make_pair(3L, 2L));
+  EXPECT_EQ(matchOf(3, 2), make_pair(1L, 11L));
+  EXPECT_EQ(matchOf(5, 0), make_pair(4L, 2L));
+}
+
+TEST_F(BracketIndexTest, SkipsLiteralsAndComments) {
+  fill({"f(\")\", ')',  // )", "  1'000 /* ) */ )"});
+  EXPECT_EQ(matchOf(0, 1), make_pair(1L, 16L));
+  EXPECT_EQ(matchOf(1, 16), make_pair(0L, 1L));
+  EXPECT_EQ(matchOf(0, 3), make_pair(-1L, -1L));  // in a string
+}
+
+TEST_F(BracketIndexTest, LexesOnlyTheEditedLines) {
+  vector<string> lines(10000, "  g(x);");
+  lines[0] = "{";
+  lines.back() = "}";
+  fill(lines);
+  EXPECT_EQ(matchOf(0, 0), make_pair(9999L, 0L));
+  size_t lexed = index.linesLexed();
+
+  buffer.setLine(5000, "  if (x) {");
+  index.invalidate(5000);
+  EXPECT_EQ(matchOf(0, 0), make_pair(-1L, -1L));
+  buffer.insertLine(6000, "  }");
+  index.insertLines(6000, 1);
+  EXPECT_EQ(matchOf(0, 0), make_pair(10000L, 0L));
+  EXPECT_EQ(matchOf(5000, 9), make_pair(6000L, 2L));
+  EXPECT_LT(index.linesLexed() - lexed, 20u);
+}
+
+TEST_F(BracketIndexTest, LexesABoundedNumberOfLinesPerMatch) {
+  const size_t per = BracketIndex::LINES_PER_MATCH;
+  vector<string> lines(3 * per + 10, "  g(x);");
+  lines[0] = "{";
+  lines.back() = "}";
+  fill(lines);
+
+  // the file is read over a few matches, none of them lexing it all
+  pair<long, long> match;
+  int matches = 0;
+  do {
+    size_t lexed = index.linesLexed();
+    match = matchOf(0, 0);
+    EXPECT_LE(index.linesLexed() - lexed, per + 2);
+    matches++;
+  } while (index.pending() && matches < 10);
+  EXPECT_FALSE(index.pending());
+  EXPECT_EQ(matches, 4);
+  EXPECT_EQ(match, make_pair(static_cast<long>(lines.size() - 1), 0L));
+
+  // the same for edits: a match that runs out of lines says so
+  for (size_t y = 1; y <= per + 5; ++y) {
+    buffer.setLine(y, "  f(y);");
+    index.invalidate(y);
+  }
+  size_t lexed = index.linesLexed();
+  EXPECT_EQ(matchOf(lines.size() - 1, 0), make_pair(-1L, -1L));
+  EXPECT_TRUE(index.pending());
+  EXPECT_LE(index.linesLexed() - lexed, per + 2);
+  EXPECT_EQ(matchOf(lines.size() - 1, 0), make_pair(0L, 0L));
+  EXPECT_FALSE(index.pending());
+
+  // a match that has none isn't pending
+  buffer.setLine(0, "");
+  index.invalidate(0);
+  EXPECT_EQ(matchOf(lines.size() - 1, 0), make_pair(-1L, -1L));
+  EXPECT_FALSE(index.pending());
+}
+
+TEST_F(BracketIndexTest, AgreesWithAScanAfterEdits) {
+  srand(7);
+  const char pieces[] = "(){}[] x";
+  vector<string> lines;
+  for (int i = 0; i < 200; ++i) {
+    string line;
+    for (int j = rand() % 6; j > 0; --j) line += pieces[rand() % 8];
+    lines.push_back(line);
+  }
+  fill(lines);
+
+  for (int round = 0; round < 300; ++round) {
+    size_t y = rand() % buffer.lineCount();
+    int edit = rand() % 3;
+    string line;
+    for (int j = rand() % 6; j > 0; --j) line += pieces[rand() % 8];
+    if (edit == 0) {
+      buffer.setLine(y, line);
+      index.invalidate(y);
+    } else if (edit == 1) {
+      buffer.insertLine(y, line);
+      index.insertLines(y, 1);
+    } else if (buffer.lineCount() > 1) {
+      buffer.eraseLine(y);
+      index.eraseLines(y, 1);
+    }
+
+    size_t py = rand() % buffer.lineCount();
+    LineView probe = buffer.line(py);
+    for (size_t x = 0; x < probe.size(); ++x) {
+      if (!BracketIndex::isBracket(probe[x])) continue;
+      ASSERT_EQ(matchOf(py, x), naiveMatchOf(py, x))
+          << "round " << round << " at " << py << ":" << x;
+    }
+  }
+}
@@ -0,0 +1,233 @@
+#include <buffer.h>
+#include <mapped_file.h>
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static vector<string> contents(const TextBuffer &buffer) {
+  vector<string> lines;
+  buffer.forEachLine([&lines](LineView line) { lines.push_back(line.str()); });
+  return lines;
+}
+
+static string positions(const vector<TextPosition> &at) {
+  string out;
+  for (const TextPosition &pos : at)
+    out += " " + to_string(pos.y) + ":" + to_string(pos.x);
+  return out;
+}
+
+TEST(TextBufferTest, StartsEmpty) {
+  TextBuffer buffer;
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(buffer.lineCount(), 0u);
+  EXPECT_THROW(buffer.line(0), out_of_range);
+}
+
+TEST(TextBufferTest, InsertAndEraseLines) {
+  TextBuffer buffer;
+  buffer.appendLine("a");
+  buffer.appendLine("c");
+  buffer.insertLine(1, "b");
+  buffer.insertLine(0, "start");
+  buffer.insertLine(4, "end");
+  EXPECT_EQ(contents(buffer), (vector<string>{"start", "a", "b", "c", "end"}));
+
+  buffer.eraseLine(0);
+  buffer.eraseLine(3);
+  buffer.eraseLine(1);
+  EXPECT_EQ(contents(buffer), (vector<string>{"a", "c"}));
+  EXPECT_EQ(buffer.line(1).str(), "c");
+}
+
+TEST(TextBufferTest, EditCharacters) {
+  TextBuffer buffer;
+  buffer.appendLine("int x;");
+  buffer.insertChar(0, 5, '1');
+  EXPECT_EQ(buffer.line(0).str(), "int x1;");
+  buffer.eraseChar(0, 0);
+  EXPECT_EQ(buffer.line(0).str(), "nt x1;");
+}
+
+TEST(TextBufferTest, SplitAndJoinLines) {
+  TextBuffer buffer;
+  buffer.appendLine("hello world");
+  buffer.splitLine(0, 5);
+  EXPECT_EQ(contents(buffer), (vector<string>{"hello", " world"}));
+  buffer.splitLine(1, 6);
+  EXPECT_EQ(contents(buffer), (vector<string>{"hello", " world", ""}));
+  buffer.joinLines(0);
+  EXPECT_EQ(contents(buffer), (vector<string>{"hello world", ""}));
+}
+
+TEST(TextBufferTest, InsertText) {
+  TextBuffer buffer;
+  buffer.appendLine("int main() {}");
+  buffer.insertText(0, 4, "x, ");
+  EXPECT_EQ(contents(buffer), (vector<string>{"int x, main() {}"}));
+  buffer.insertText(0, 15, "\n    return 0;\n");
+  EXPECT_EQ(contents(buffer),
+            (vector<string>{"int x, main() {", "    return 0;", "}"}));
+  buffer.insertText(2, 1, "\n");
+  EXPECT_EQ(buffer.lineCount(), 4u);
+  EXPECT_EQ(buffer.line(3).str(), "");
+}
+
+TEST(TextBufferTest, EraseText) {
+  TextBuffer buffer;
+  buffer.appendLine("int main() {");
+  buffer.appendLine("    return 0;");
+  buffer.appendLine("}");
+  buffer.eraseText(0, 3, 1);
+  EXPECT_EQ(buffer.line(0).str(), "intmain() {");
+  // the rest of line 0, its line break and the indent of line 1
+  buffer.eraseText(0, 11, 5);
+  EXPECT_EQ(contents(buffer), (vector<string>{"intmain() {return 0;", "}"}));
+  buffer.eraseText(0, 20, 2);
+  EXPECT_EQ(contents(buffer), (vector<string>{"intmain() {return 0;"}));
+}
+
+TEST(TextBufferTest, ManyLines) {
+  const int n = 200000;
+  TextBuffer buffer;
+  for (int i = 0; i < n; ++i) buffer.appendLine(to_string(i));
+  for (int i = 0; i < 1000; ++i) buffer.splitLine(0, 0);
+  EXPECT_EQ(buffer.lineCount(), static_cast<size_t>(n + 1000));
+  EXPECT_EQ(buffer.line(1000).str(), "0");
+  EXPECT_EQ(buffer.line(n + 999).str(), to_string(n - 1));
+  for (int i = 0; i < 1000; ++i) buffer.joinLines(0);
+  EXPECT_EQ(buffer.line(0).str(), "0");
+  EXPECT_EQ(buffer.line(12345).str(), "12345");
+}
+
+class MappedBufferTest : public ::testing::Test {
+
+protected:
+  string path = "mapped_buffer_test.txt";
+
+  virtual void TearDown() {
+    remove(path.c_str());
+  };
+
+  shared_ptr<MappedFile> mapFile(const string &contents) {
+    ofstream(path) << contents;
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    EXPECT_TRUE(file->open(path));
+    return file;
+  }
+};
+
+TEST_F(MappedBufferTest, IndexesLines) {
+  EXPECT_EQ(mapFile("")->lineCount(), 0u);
+  EXPECT_EQ(mapFile("a\n")->lineCount(), 1u);
+  EXPECT_EQ(mapFile("a\n\nb")->lineCount(), 3u);
+
+  shared_ptr<MappedFile> file = mapFile("first\n\nlast");
+  EXPECT_EQ(file->line(0).str(), "first");
+  EXPECT_EQ(file->line(1).str(), "");
+  EXPECT_EQ(file->line(2).str(), "last");
+}
+
+TEST_F(MappedBufferTest, IndexesChunksInParallel) {
+  // several chunks, with lines across their boundaries
+  string contents;
+  while (contents.size() < (9 << 20))
+    contents += "line " + to_string(contents.size()) + "\n";
+  contents += "no newline";
+  shared_ptr<MappedFile> serial = mapFile(contents);
+
+  MappedFile file;
+  ASSERT_TRUE(file.map(path));
+  EXPECT_EQ(file.lineCount(), 0u);
+  atomic<size_t> progress(0);
+  file.indexLines(3, &progress);
+  EXPECT_EQ(progress, contents.size());
+  ASSERT_EQ(file.lineCount(), serial->lineCount());
+  for (size_t i = 0; i <= file.lineCount(); ++i)
+    ASSERT_EQ(file.lineStart(i), serial->lineStart(i));
+  EXPECT_EQ(file.line(file.lineCount() - 1).str(), "no newline");
+}
+
+TEST_F(MappedBufferTest, MissingFile) {
+  MappedFile file;
+  EXPECT_FALSE(file.open("no/such/file"));
+  EXPECT_EQ(errno, ENOENT);
+}
+
+TEST_F(MappedBufferTest, EditsLeaveSourceUntouched) {
+  shared_ptr<MappedFile> file = mapFile("zero\none\ntwo\nthree\n");
+  TextBuffer buffer;
+  buffer.load(file);
+  EXPECT_EQ(buffer.lineCount(), 4u);
+  EXPECT_EQ(buffer.line(2).data(), file->line(2).data());
+
+  buffer.insertChar(1, 3, '!');
+  buffer.splitLine(2, 1);
+  buffer.eraseLine(0);
+  EXPECT_EQ(contents(buffer), (vector<string>{"one!", "t", "wo", "three"}));
+  EXPECT_EQ(buffer.line(3).data(), file->line(3).data());
+  EXPECT_EQ(file->line(1).str(), "one");
+}
+
+TEST_F(MappedBufferTest, FindsAndReplacesAll) {
+  shared_ptr<MappedFile> file = mapFile("a = aaa;\nb;\naa\nno newline a");
+  TextBuffer buffer;
+  buffer.load(file);
+  buffer.setLine(1, "ba");  // an edited line among the untouched ones
+
+  vector<TextPosition> at;
+  buffer.findAll("aa", at);
+  // a match starts after the one before it
+  EXPECT_EQ(positions(at), " 0:4 2:0");
+  buffer.findAll("a", at, 2);
+  EXPECT_EQ(positions(at), " 0:0 0:4 0:5 0:6 1:1 2:0 2:1 3:11");
+
+  buffer.replaceAll(at, 1, "xy");
+  EXPECT_EQ(contents(buffer),
+            (vector<string>{"xy = xyxyxy;", "bxy", "xyxy", "no newline xy"}));
+  buffer.findAll("xy", at);
+  buffer.replaceAll(at, 2, "");
+  EXPECT_EQ(contents(buffer),
+            (vector<string>{" = ;", "b", "", "no newline "}));
+  EXPECT_EQ(file->line(0).str(), "a = aaa;");
+
+  at = vector<TextPosition>{{1, 1}, {1, 0}};
+  EXPECT_THROW(buffer.replaceAll(at, 1, "z"), out_of_range);
+  at = vector<TextPosition>{{0, 4}};
+  EXPECT_THROW(buffer.replaceAll(at, 1, "z"), out_of_range);
+  EXPECT_EQ(buffer.line(0).str(), " = ;");  // nothing changed
+}
+
+TEST_F(MappedBufferTest, ReplacesAllInParallel) {
+  // many ranges of lines, some of them edited
+  string text;
+  for (int i = 0; i < 100000; ++i)
+    text += i % 3 ? "int x" + to_string(i) + " = x;\n" : "\n";
+  TextBuffer buffer;
+  buffer.load(mapFile(text));
+  for (size_t y = 5; y < buffer.lineCount(); y += 7919)
+    buffer.setLine(y, "x, x");
+
+  vector<string> expected = contents(buffer);
+  size_t count = 0;
+  for (string& line : expected) {
+    for (size_t x = 0; (x = line.find('x', x)) != string::npos; x += 3) {
+      line.replace(x, 1, "y_z");
+      count++;
+    }
+  }
+
+  vector<TextPosition> at;
+  buffer.findAll("x", at, 4);
+  ASSERT_EQ(at.size(), count);
+  buffer.replaceAll(at, 1, "y_z", 4);
+  EXPECT_EQ(contents(buffer), expected);
+  EXPECT_EQ(buffer.line(99998).str(), "int y_z99998 = y_z;");
+}
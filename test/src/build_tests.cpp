@@ -0,0 +1,177 @@
+#include <build_cache.h>
+#include <editor.h>
+#include "gtest/gtest.h"
+
+#include <poll.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static uint64_t keyOf(const string& text, const vector<string>& command) {
+  TextBuffer buffer;
+  buffer.appendLine(text);
+  return BuildCache::key(buffer.snapshot(), command);
+}
+
+class BuildTest : public ::testing::Test {
+
+protected:
+  // a directory of its own, the *.in files next to the source are run
+  string dir = "build_test_dir";
+  string source = dir + "/a.cpp";
+  string cache = "build_test_cache";
+
+  virtual void SetUp() {
+    mkdir(dir.c_str(), 0755);
+    setenv("CXXFLAGS", "-O0", 1);  // quicker to compile
+    initEditor();
+    setWindowSize(20, 60);
+    g_E.cache = BuildCache(cache);
+  }
+
+  virtual void TearDown() {
+    initEditor();  // stops what is still running
+    unsetenv("CXXFLAGS");
+    system(("rm -rf " + dir + " " + cache).c_str());
+  };
+
+  // wait for the key of the binary, as the main loop would
+  void waitForKey() {
+    for (int i = 0; i < 3000 && g_E.build.step == BuildState::HASHING; ++i) {
+      poll(nullptr, 0, 1);
+      pollBuild();
+    }
+    ASSERT_NE(g_E.build.step, BuildState::HASHING);
+  }
+
+  // run the build to its end, as the main loop would
+  void waitForBuild() {
+    for (int i = 0; i < 3000 && g_E.build.step != BuildState::IDLE; ++i) {
+      if (g_E.saver.joinable() && g_E.saveDone) finishSave();
+      struct pollfd fd = {g_E.build.process.outputFd(), POLLIN, 0};
+      poll(&fd, 1, 10);
+      pollBuild();
+    }
+    ASSERT_EQ(g_E.build.step, BuildState::IDLE);
+  }
+};
+
+TEST_F(BuildTest, KeyDependsOnSourceAndCommand) {
+  vector<string> gxx{"g++", "-O2"};
+  EXPECT_EQ(keyOf("int main() {}", gxx), keyOf("int main() {}", gxx));
+  EXPECT_NE(keyOf("int main() {}", gxx), keyOf("int main(){}", gxx));
+  EXPECT_NE(keyOf("int main() {}", gxx),
+            keyOf("int main() {}", vector<string>{"g++", "-O0"}));
+  // the arguments are told apart
+  EXPECT_NE(keyOf("", vector<string>{"g++", "-O2"}),
+            keyOf("", vector<string>{"g++-O2"}));
+}
+
+TEST_F(BuildTest, OnlyKeepsWhatCompiled) {
+  vector<string> command;
+  ASSERT_TRUE(g_E.cache.compileCommand(42, source, command));
+  ASSERT_GE(command.size(), 4u);
+  EXPECT_EQ(command[command.size() - 3], source);
+  EXPECT_EQ(command[command.size() - 2], "-o");
+  string output = command.back();
+  EXPECT_NE(output, g_E.cache.path(42));
+
+  ofstream(output) << "#!/bin/sh\n";
+  chmod(output.c_str(), 0755);
+  g_E.cache.discard(42);
+  EXPECT_FALSE(g_E.cache.commit(42));
+  EXPECT_FALSE(g_E.cache.contains(42));
+
+  ofstream(output) << "#!/bin/sh\n";
+  chmod(output.c_str(), 0755);
+  ASSERT_TRUE(g_E.cache.commit(42));
+  EXPECT_TRUE(g_E.cache.contains(42));
+}
+
+TEST_F(BuildTest, CompilesRunsAndCaches) {
+  ofstream(source) << "#include <cstdio>\n"
+                   << "int main() { puts(\"hello\"); return 2; }\n";
+  editorOpen(source);
+  processKey(ctrlWith('r'));
+  // the text is hashed in the background
+  EXPECT_EQ(g_E.build.step, BuildState::HASHING);
+  EXPECT_EQ(g_E.panelRows, PANEL_ROWS);
+  EXPECT_EQ(g_E.screenRows, 20 - 2 - PANEL_ROWS);
+  waitForKey();
+  EXPECT_EQ(g_E.build.step, BuildState::COMPILING);
+  waitForBuild();
+  EXPECT_EQ(g_E.build.output, "hello\n");
+  EXPECT_NE(g_E.build.title.find("exit 2"), string::npos);
+  EXPECT_NE(composeFrame(0).find("hello"), string::npos);
+
+  // nothing changed, the binary runs without compiling
+  processKey(ctrlWith('r'));
+  waitForKey();
+  EXPECT_EQ(g_E.build.step, BuildState::RUNNING);
+  EXPECT_NE(g_E.build.title.find("cached"), string::npos);
+  waitForBuild();
+  EXPECT_EQ(g_E.build.output, "hello\n");
+
+  processKey('\x1b');
+  EXPECT_EQ(g_E.panelRows, 0);
+  EXPECT_EQ(g_E.screenRows, 20 - 2);
+}
+
+TEST_F(BuildTest, SavesBeforeCompilingAndShowsErrors) {
+  ofstream(source) << "int main() { return 0; }\n";
+  editorOpen(source);
+  processKey('x');
+  processKey(ctrlWith('r'));
+  EXPECT_EQ(g_E.build.step, BuildState::SAVING);
+  waitForBuild();
+  EXPECT_NE(g_E.build.title.find("Compilation failed"), string::npos);
+  EXPECT_NE(g_E.build.output.find("error"), string::npos);
+  EXPECT_NE(composeFrame(0).find("error"), string::npos);
+  EXPECT_FALSE(g_E.doc->modified);
+
+  // a failed compilation leaves nothing in the cache
+  EXPECT_FALSE(g_E.cache.contains(g_E.build.key));
+}
+
+TEST_F(BuildTest, TestsTheSamplesNextToTheFile) {
+  ofstream(source) << "#include <cstdio>\n"
+                   << "int main() {\n"
+                   << "  int a, b;\n"
+                   << "  if (scanf(\"%d %d\", &a, &b) != 2) return 1;\n"
+                   << "  printf(\"%d\\n\", a + b);\n"
+                   << "}\n";
+  ofstream(dir + "/1.in") << "1 2\n";
+  ofstream(dir + "/1.out") << "3\n";
+  ofstream(dir + "/2.in") << "2 2\n";
+  ofstream(dir + "/2.out") << "5\n";
+  ofstream(dir + "/10.in") << "nothing\n";
+  ofstream(dir + "/10.out") << "0\n";
+  ofstream(dir + "/11.in") << "5 5\n";  // no answer to compare with
+
+  editorOpen(source);
+  processKey(ctrlWith('r'));
+  waitForBuild();
+  const vector<SampleCase>& cases = g_E.build.samples.cases();
+  ASSERT_EQ(cases.size(), 4u);
+  EXPECT_EQ(cases[0].name, "1");
+  EXPECT_EQ(cases[0].verdict, SampleCase::PASSED);
+  EXPECT_EQ(cases[1].verdict, SampleCase::WRONG);
+  EXPECT_EQ(cases[2].name, "10");
+  EXPECT_EQ(cases[2].verdict, SampleCase::CRASHED);
+  EXPECT_EQ(cases[3].verdict, SampleCase::RAN);
+  EXPECT_GT(cases[0].peakKb, 0);
+  EXPECT_NE(g_E.build.title.find("1/4 passed"), string::npos);
+
+  // the failures come last, where the panel shows them
+  const string& results = g_E.build.output;
+  EXPECT_NE(results.find("line 1 differs"), string::npos);
+  EXPECT_NE(results.find("exit 1"), string::npos);
+  EXPECT_LT(results.find("AC"), results.find("WA"));
+  EXPECT_NE(composeFrame(0).find("WA"), string::npos);
+}
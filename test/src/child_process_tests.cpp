@@ -0,0 +1,73 @@
+#include <child_process.h>
+#include "gtest/gtest.h"
+
+#include <poll.h>
+#include <sys/wait.h>
+
+#include <cerrno>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// read everything p prints until it exits, as the main loop would
+static string runToEnd(ChildProcess& p) {
+  string out;
+  while (!p.finished()) {
+    struct pollfd fd = {p.outputFd(), POLLIN, 0};
+    poll(&fd, 1, 10);
+    p.readOutput(out);
+  }
+  return out;
+}
+
+static vector<string> shell(const string& script) {
+  return vector<string>{"sh", "-c", script};
+}
+
+TEST(ChildProcessTest, ReadsStdoutAndStderr) {
+  ChildProcess p;
+  ASSERT_TRUE(p.start(shell("echo out; echo err >&2; exit 3")));
+  EXPECT_TRUE(p.running());
+  string out = runToEnd(p);
+  EXPECT_FALSE(p.running());
+  EXPECT_EQ(p.outputFd(), -1);
+  EXPECT_EQ(out, "out\nerr\n");
+  ASSERT_TRUE(WIFEXITED(p.status()));
+  EXPECT_EQ(WEXITSTATUS(p.status()), 3);
+}
+
+TEST(ChildProcessTest, ReadingDoesNotBlock) {
+  ChildProcess p;
+  // stdin is /dev/null, so read doesn't wait for the terminal
+  ASSERT_TRUE(p.start(shell("read line || echo no input; sleep 30")));
+  string out;
+  while (out.empty()) {
+    struct pollfd fd = {p.outputFd(), POLLIN, 0};
+    poll(&fd, 1, 1000);
+    p.readOutput(out);
+  }
+  EXPECT_EQ(out, "no input\n");
+  EXPECT_FALSE(p.readOutput(out));
+  EXPECT_FALSE(p.finished());
+  p.stop();
+  EXPECT_FALSE(p.running());
+  EXPECT_TRUE(WIFSIGNALED(p.status()));
+}
+
+TEST(ChildProcessTest, StopKillsWhatTheProcessStarted) {
+  ChildProcess p;
+  // the grandchild keeps the pipe open, it has to be killed too
+  ASSERT_TRUE(p.start(shell("sleep 30 & wait")));
+  p.stop();
+  EXPECT_EQ(p.outputFd(), -1);
+  EXPECT_TRUE(p.finished());
+}
+
+TEST(ChildProcessTest, ReportsMissingPrograms) {
+  ChildProcess p;
+  EXPECT_FALSE(p.start(vector<string>{"no-such-program-cp-editor"}));
+  EXPECT_EQ(errno, ENOENT);
+  EXPECT_FALSE(p.running());
+  EXPECT_FALSE(p.start(vector<string>()));
+}
@@ -0,0 +1,93 @@
+#include <column_index.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST(ColumnIndexTest, PlainLineMapsOneToOne) {
+  ColumnIndex columns;
+  string line = "int main()";
+  columns.build(line, 8);
+  EXPECT_EQ(columns.renderColumn(0), 0u);
+  EXPECT_EQ(columns.renderColumn(4), 4u);
+  EXPECT_EQ(columns.renderWidth(), line.size());
+}
+
+TEST(ColumnIndexTest, TabsExpandToNextStop) {
+  ColumnIndex columns;
+  string line = "\tab\tc";
+  columns.build(line, 8);
+  EXPECT_EQ(columns.renderColumn(0), 0u);
+  EXPECT_EQ(columns.renderColumn(1), 8u);
+  EXPECT_EQ(columns.renderColumn(3), 10u);
+  EXPECT_EQ(columns.renderColumn(4), 16u);
+  EXPECT_EQ(columns.renderColumn(5), 17u);
+  EXPECT_EQ(columns.renderColumn(99), 17u);
+
+  string render;
+  columns.render(line, render);
+  EXPECT_EQ(render, string(8, ' ') + "ab" + string(6, ' ') + "c");
+  EXPECT_EQ(columns.renderWidth(), render.size());
+}
+
+TEST(ColumnIndexTest, WideAndMultibyteCharacters) {
+  ColumnIndex columns;
+  // "a", U+00E9 (2 bytes, 1 column), U+6F22 (3 bytes, 2 columns), "b"
+  string line = "a\xC3\xA9\xE6\xBC\xA2" "b";
+  columns.build(line, 8);
+  EXPECT_EQ(columns.renderColumn(1), 1u);
+  EXPECT_EQ(columns.renderColumn(3), 2u);
+  EXPECT_EQ(columns.renderColumn(4), 2u);  // inside the wide character
+  EXPECT_EQ(columns.renderColumn(6), 4u);
+  EXPECT_EQ(columns.renderWidth(), 5u);
+
+  EXPECT_EQ(columns.charStart(2), 1u);
+  EXPECT_EQ(columns.charEnd(1), 3u);
+  EXPECT_EQ(columns.charEnd(3), 6u);
+  EXPECT_EQ(columns.charStart(6), 6u);
+
+  ColumnIndex::Cell cell = columns.cellAt(3);
+  EXPECT_EQ(cell.rx, 2u);
+  EXPECT_EQ(cell.width, 2u);
+  EXPECT_EQ(cell.offset, 3u);
+  EXPECT_EQ(cell.size, 3u);
+  cell = columns.cellAt(4);
+  EXPECT_EQ(cell.offset, 6u);
+  EXPECT_EQ(cell.size, 1u);
+
+  string render;
+  columns.render(line, render);
+  EXPECT_EQ(render, line);
+}
+
+TEST(ColumnIndexTest, TabStopsCountRenderedColumns) {
+  ColumnIndex columns;
+  // the wide character takes two columns before the tab
+  string line = "\xE6\xBC\xA2\tx";
+  columns.build(line, 8);
+  EXPECT_EQ(columns.renderColumn(4), 8u);
+  string render;
+  columns.render(line, render);
+  EXPECT_EQ(render, "\xE6\xBC\xA2" + string(6, ' ') + "x");
+}
+
+TEST(ColumnIndexTest, CombiningMarksAndInvalidBytes) {
+  ColumnIndex columns;
+  // "e" followed by U+0301, then a stray continuation byte
+  string line = "e\xCC\x81\x80z";
+  columns.build(line, 8);
+  EXPECT_EQ(columns.renderWidth(), 3u);
+  EXPECT_EQ(columns.charEnd(0), 3u);
+  ColumnIndex::Cell cell = columns.cellAt(0);
+  EXPECT_EQ(cell.size, 3u);
+
+  string render;
+  columns.render(line, render);
+  EXPECT_EQ(render, "e\xCC\x81?z");
+
+  vector<unsigned char> values = {1, 2, 2, 3, 4}, spread;
+  columns.render(values, spread);
+  EXPECT_EQ(spread, (vector<unsigned char>{1, 3, 4}));
+}
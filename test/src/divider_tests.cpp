@@ -2,8 +2,12 @@
 // Created by Konstantin Gredeskoul on 5/16/17.
 //
 #include <division.h>
+#include <invariant_division.h>
 #include "gtest/gtest.h"
 
+#include <climits>
+#include <vector>
+
 using namespace std;
 
 
@@ -61,3 +65,73 @@ TEST_F(DividerTest, DivisionByZero) {
   }
 }
 
+class InvariantDivisionTest : public ::testing::Test {
+
+protected:
+  VI denominators = {1, -1, 2, -2, 3, 7, -7, 10, 64, 1000000007, -999999937,
+                     (1LL << 40) + 1, -(1LL << 40) - 3, 1LL << 62, LLONG_MAX,
+                     LLONG_MIN, LLONG_MIN + 1};
+  VI numerators;
+
+  virtual void SetUp() {
+    numerators = {0, 1, -1, 5, -5, 17, -17, 1LL << 40, -(1LL << 40),
+                  LLONG_MAX, LLONG_MAX - 1, LLONG_MIN + 1, LLONG_MIN};
+    unsigned long long x = 88172645463325252ULL;  // xorshift64
+    for (int i = 0; i < 1000; ++i) {
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      numerators.push_back(static_cast<long long>(x) >> (i % 64));
+    }
+  };
+
+  // LLONG_MIN / -1 overflows
+  bool defined(long long numerator, long long denominator) {
+    return !(numerator == LLONG_MIN && denominator == -1);
+  }
+};
+
+TEST_F(InvariantDivisionTest, MatchesTheOperators) {
+  for (long long d : denominators) {
+    InvariantDivision division(d);
+    EXPECT_EQ(division.denominator(), d);
+    for (long long n : numerators) {
+      if (!defined(n, d)) continue;
+      DivisionResult result = division.divide(n);
+      ASSERT_EQ(result.division, n / d) << n << " / " << d;
+      ASSERT_EQ(result.remainder, n % d) << n << " % " << d;
+    }
+  }
+}
+
+TEST_F(InvariantDivisionTest, DividesArrays) {
+  for (long long d : denominators) {
+    InvariantDivision division(d);
+    VI input;
+    for (long long n : numerators)
+      if (defined(n, d)) input.push_back(n);
+    // every tail after the blocks of four and of eight, and counts
+    // without a block
+    VI counts = {1, 2, 3, 4, 7, 8, 9, 15};
+    for (long long tail = 7; tail >= 0; --tail)
+      counts.push_back(input.size() - tail);
+    for (size_t count : counts) {
+      VI divisions(count), remainders(count);
+      division.divide(input.data(), count, divisions.data(),
+                      remainders.data());
+      for (size_t i = 0; i < count; ++i) {
+        ASSERT_EQ(divisions[i], input[i] / d) << input[i] << " / " << d;
+        ASSERT_EQ(remainders[i], input[i] % d) << input[i] << " % " << d;
+      }
+    }
+    VI quotients(input.size());
+    division.divide(input.data(), input.size(), quotients.data());
+    EXPECT_EQ(quotients.back(), input.back() / d);
+  }
+}
+
+TEST_F(InvariantDivisionTest, ChecksTheDenominatorOnce) {
+  EXPECT_THROW(InvariantDivision(0), DivisionByZero);
+  InvariantDivision division(3);
+  division.divide(nullptr, 0, nullptr);  // nothing to divide
+}
@@ -0,0 +1,468 @@
+#include <editor.h>
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace std;
+
+class DocumentTest : public ::testing::Test {
+
+protected:
+  string first = "document_test_first.txt";
+  string second = "document_test_second.txt";
+
+  virtual void SetUp() {
+    ofstream(first) << "one\ntwo\nthree\n";
+    ofstream(second) << "alpha\nbeta\n";
+    initEditor();
+    setWindowSize(10, 40);
+  }
+
+  virtual void TearDown() {
+    // and the swap journals of the edits that were never saved
+    for (const string& name : {first, second}) {
+      remove(name.c_str());
+      string swap = SwapJournal::pathFor(name);
+      remove(swap.c_str());
+      remove((swap + ".old.1").c_str());
+    }
+  };
+};
+
+TEST_F(DocumentTest, LoadsOnFirstView) {
+  editorOpen(first);
+  Document& other = addDocument(second);
+  EXPECT_FALSE(other.loaded);
+  EXPECT_TRUE(other.buffer.empty());
+  EXPECT_EQ(g_E.documents.size(), 2u);
+
+  processKey(ctrlWith('b'));
+  EXPECT_EQ(g_E.doc, &other);
+  EXPECT_TRUE(other.loaded);
+  EXPECT_EQ(other.buffer.line(1).str(), "beta");
+  EXPECT_NE(composeFrame(0).find("[2/2]"), string::npos);
+}
+
+TEST_F(DocumentTest, KeepsStateWhenSwitching) {
+  editorOpen(first);
+  addDocument(second);
+  processKey(ARROW_DOWN);
+  processKey('x');
+  composeFrame(0);
+
+  processKey(ctrlWith('b'));
+  processKey('y');
+  EXPECT_EQ(g_E.doc->buffer.line(0).str(), "yalpha");
+
+  processKey(ctrlWith('b'));
+  EXPECT_EQ(g_E.current, 0u);
+  EXPECT_EQ(g_E.doc->cursorY, 1);
+  EXPECT_EQ(g_E.doc->cursorX, 1);
+  EXPECT_EQ(g_E.doc->buffer.line(1).str(), "xtwo");
+
+  // every document has its own history
+  processKey(ctrlWith('z'));
+  EXPECT_EQ(g_E.doc->buffer.line(1).str(), "two");
+  EXPECT_EQ(g_E.documents[1]->buffer.line(0).str(), "yalpha");
+  EXPECT_TRUE(g_E.documents[1]->modified);
+}
+
+TEST_F(DocumentTest, ViewsWithoutLoading) {
+  g_E.viewThreshold = 0;
+  editorOpen(first);
+  g_E.viewThreshold = VIEW_THRESHOLD;
+  EXPECT_TRUE(g_E.doc->viewing);
+  EXPECT_TRUE(g_E.doc->buffer.empty());
+  EXPECT_NE(composeFrame(0).find("two"), string::npos);
+
+  processKey(ARROW_DOWN);
+  EXPECT_EQ(g_E.doc->topOffset, 4u);
+  processKey(PAGE_DOWN);  // stops at the last line
+  EXPECT_EQ(g_E.doc->topOffset, 8u);
+  processKey(ARROW_UP);
+  EXPECT_EQ(g_E.doc->topOffset, 4u);
+
+  // the file can't be changed
+  processKey('x');
+  processKey(BACKSPACE);
+  EXPECT_TRUE(g_E.doc->buffer.empty());
+  EXPECT_FALSE(g_E.doc->modified);
+
+  processKey(ctrlWith('g'));
+  for (char c : string("9\r")) processKey(c);
+  EXPECT_EQ(g_E.doc->topOffset, 8u);
+  processKey(ctrlWith('g'));
+  for (char c : string("0%\r")) processKey(c);
+  EXPECT_EQ(g_E.doc->topOffset, 0u);
+}
+
+TEST_F(DocumentTest, IndexesBigFilesInTheBackground) {
+  string contents;
+  for (int i = 0; contents.size() < BACKGROUND_INDEX_THRESHOLD; ++i)
+    contents += "line " + to_string(i) + "\n";
+  ofstream(first) << contents;
+
+  editorOpen(first);
+  Document& doc = *g_E.doc;
+  ASSERT_TRUE(doc.indexing != nullptr);
+  EXPECT_TRUE(doc.viewing);
+  processKey(ARROW_DOWN);  // the viewer works meanwhile
+  processKey(ARROW_DOWN);
+  EXPECT_NE(composeFrame(0).find("line 2"), string::npos);
+
+  doc.indexer.join();
+  finishIndexing();
+  EXPECT_FALSE(doc.viewing);
+  EXPECT_TRUE(doc.indexing == nullptr);
+  EXPECT_EQ(doc.cursorY, 2);  // where the viewer was
+  EXPECT_EQ(doc.buffer.line(1000).str(), "line 1000");
+  processKey('x');
+  EXPECT_EQ(doc.buffer.line(2).str(), "xline 2");
+}
+
+TEST_F(DocumentTest, RecoversEditsAfterACrash) {
+  string swap = SwapJournal::pathFor(first);
+  g_E.journal = true;
+  editorOpen(first);
+  processKey('x');
+  processKey(ARROW_DOWN);
+  processKey('\r');
+  flushJournals();
+
+  // the editor dies, a new one opens the file
+  initEditor();
+  editorOpen(first);
+  EXPECT_EQ(g_E.doc->buffer.line(0).str(), "xone");
+  EXPECT_EQ(g_E.doc->buffer.line(1).str(), "t");
+  EXPECT_EQ(g_E.doc->buffer.line(2).str(), "wo");
+  EXPECT_TRUE(g_E.doc->modified);
+  EXPECT_NE(g_E.statusMsg.find("Recovered 2 edits"), string::npos);
+
+  // saving resets the journal, the edits are in the file
+  save();
+  g_E.saver.join();
+  finishSave();
+  initEditor();
+  editorOpen(first);
+  EXPECT_EQ(g_E.doc->buffer.line(0).str(), "xone");
+  EXPECT_FALSE(g_E.doc->modified);
+  g_E.journal = false;
+  remove(swap.c_str());
+}
+
+TEST_F(DocumentTest, LeavesOtherSwapFilesAlone) {
+  string vim = "." + first + ".swp";
+  string swap = SwapJournal::pathFor(first);
+  ofstream(vim) << "b0VIM 9.0";
+  ofstream(swap) << "b0VIM 9.0";
+  g_E.journal = true;
+  editorOpen(first);
+  EXPECT_NE(g_E.statusMsg.find("isn't a journal"), string::npos);
+  processKey('x');
+  flushJournals();
+  g_E.journal = false;
+
+  for (const string& file : {vim, swap}) {
+    ifstream in(file);
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    EXPECT_EQ(text, "b0VIM 9.0") << file;
+  }
+  EXPECT_NE(access((swap + ".old.1").c_str(), F_OK), 0);
+  remove(vim.c_str());
+}
+
+TEST_F(DocumentTest, KeepsJournalsForOtherVersions) {
+  string swap = SwapJournal::pathFor(first);
+  g_E.journal = true;
+  editorOpen(first);
+  processKey('x');
+  flushJournals();
+
+  // the editor dies and the file changes before it is opened again
+  initEditor();
+  ofstream(first) << "changed\n";
+  editorOpen(first);
+  EXPECT_NE(g_E.statusMsg.find("kept as " + swap + ".old.1"), string::npos);
+  EXPECT_EQ(g_E.doc->buffer.line(0).str(), "changed");
+  processKey('y');
+  flushJournals();
+  g_E.journal = false;
+
+  // the edits of each version are in a journal of their own
+  TextBuffer buffer;
+  size_t edits, length;
+  EXPECT_EQ(SwapJournal::replay(swap, SwapJournal::baseOf(first), buffer,
+                                edits, length),
+            SwapJournal::RECOVERED);
+  EXPECT_EQ(edits, 1u);
+  EXPECT_GT(length, 0u);
+}
+
+TEST_F(DocumentTest, OpensWithoutAJournalAnotherEditorHolds) {
+  string swap = SwapJournal::pathFor(first);
+  SwapJournal other;
+  ASSERT_TRUE(other.attach(swap, SwapJournal::baseOf(first)));
+  g_E.journal = true;
+  editorOpen(first);
+  g_E.journal = false;
+  EXPECT_NE(g_E.statusMsg.find("is in use"), string::npos);
+  EXPECT_FALSE(g_E.doc->journal.attached());
+  processKey('x');
+  flushJournals();
+  EXPECT_EQ(g_E.doc->buffer.line(0).str(), "xone");
+
+  // nothing was written to the journal of the other editor
+  struct stat st;
+  ASSERT_EQ(stat(swap.c_str(), &st), 0);
+  EXPECT_EQ(st.st_size, 0);
+}
+
+TEST_F(DocumentTest, CompletesIdentifiers) {
+  ofstream(first) << "counter = 0;\ncount += counter + countdown;\n\n";
+  editorOpen(first);
+  Document& doc = *g_E.doc;
+  doc.wordIndexer.join();
+  finishIndexing();
+
+  for (int i = 0; i < 2; ++i) processKey(ARROW_DOWN);
+  processKey('c');
+  processKey('o');
+  processKey(ctrlWith('n'));
+  EXPECT_EQ(doc.buffer.line(2).str(), "counter");
+  EXPECT_NE(composeFrame(0).find("[counter] count countdown"), string::npos);
+  processKey(ctrlWith('n'));
+  EXPECT_EQ(doc.buffer.line(2).str(), "count");
+  EXPECT_EQ(doc.cursorX, 5);
+
+  // any other key keeps the candidate
+  processKey(';');
+  processKey(ctrlWith('n'));
+  EXPECT_EQ(doc.buffer.line(2).str(), "count;");
+  EXPECT_NE(g_E.statusMsg.find("No identifier"), string::npos);
+
+  // the index follows the edits
+  EXPECT_EQ(doc.words.count("count"), 2);
+  processKey(ctrlWith('z'));
+  EXPECT_EQ(doc.buffer.line(2).str(), "count");
+}
+
+TEST_F(DocumentTest, MatchesBrackets) {
+  ofstream(first) << "int main() {\n  f(a[0]);\n}\n";
+  editorOpen(first);
+  Document& doc = *g_E.doc;
+  for (int i = 0; i < 11; ++i) processKey(ARROW_RIGHT);
+  EXPECT_NE(composeFrame(0).find("\x1b[7m{"), string::npos);
+  EXPECT_TRUE(g_E.brackets.shown);
+  EXPECT_EQ(g_E.brackets.match.y, 2u);
+
+  processKey(ctrlWith(']'));
+  EXPECT_EQ(doc.cursorY, 2);
+  EXPECT_EQ(doc.cursorX, 0);
+  processKey(DEL_KEY);  // unmatched once the closing one is gone
+  processKey(ARROW_UP);
+  processKey(ARROW_UP);
+  processKey(END_KEY);
+  EXPECT_EQ(composeFrame(0).find("\x1b[7m{"), string::npos);
+  EXPECT_FALSE(g_E.brackets.shown);
+  processKey(ctrlWith(']'));
+  EXPECT_EQ(doc.cursorY, 0);
+  EXPECT_EQ(doc.cursorX, 12);
+  EXPECT_NE(g_E.statusMsg.find("Nothing matches"), string::npos);
+}
+
+TEST_F(DocumentTest, ScrollsWithTheTerminal) {
+  string contents;
+  for (int i = 0; i < 30; ++i) contents += "line " + to_string(i) + "\n";
+  ofstream(first) << contents;
+  editorOpen(first);
+  composeFrame(0);
+  for (int i = 0; i < g_E.screenRows - 1; ++i) processKey(ARROW_DOWN);
+  composeFrame(0);
+
+  // one row comes into view, the others are moved by the terminal
+  processKey(ARROW_DOWN);
+  const string& frame = composeFrame(0);
+  string region = "\x1b[1;" + to_string(g_E.screenRows) + "r\x1b[1S\x1b[r";
+  EXPECT_NE(frame.find(region), string::npos);
+  EXPECT_NE(frame.find("line 8"), string::npos);
+  EXPECT_EQ(frame.find("line 7"), string::npos);
+  EXPECT_LT(frame.size(), 100u);
+}
+
+TEST_F(DocumentTest, JumpsAroundTheFile) {
+  string contents;
+  for (int i = 0; i < 100; ++i) contents += "int value_" + to_string(i) + ";\n";
+  ofstream(first) << contents;
+  editorOpen(first);
+  Document& doc = *g_E.doc;
+  composeFrame(0);
+
+  processKey(CTRL_RIGHT);
+  EXPECT_EQ(doc.cursorX, 4);
+  processKey(CTRL_RIGHT);  // over the semicolon to the end of the line
+  EXPECT_EQ(doc.cursorX, 12);
+  processKey(CTRL_RIGHT);
+  EXPECT_EQ(doc.cursorY, 1);
+  EXPECT_EQ(doc.cursorX, 0);
+  processKey(CTRL_LEFT);
+  EXPECT_EQ(doc.cursorY, 0);
+  EXPECT_EQ(doc.cursorX, 12);
+  processKey(CTRL_LEFT);
+  EXPECT_EQ(doc.cursorX, 4);
+
+  // pages keep the column
+  processKey(PAGE_DOWN);
+  EXPECT_EQ(doc.cursorY, 2 * g_E.screenRows - 1);
+  EXPECT_EQ(doc.cursorX, 4);
+  composeFrame(0);
+  processKey(PAGE_UP);
+  EXPECT_EQ(doc.cursorY, doc.rowOffset - g_E.screenRows);
+
+  processKey(ctrlWith('g'));
+  for (char c : string("42")) processKey(c);
+  processKey('\r');
+  EXPECT_EQ(doc.cursorY, 41);
+  processKey(ctrlWith('g'));
+  processKey('x');
+  processKey('\r');
+  EXPECT_NE(g_E.statusMsg.find("Not a line number"), string::npos);
+  EXPECT_EQ(doc.cursorY, 41);
+
+  processKey(CTRL_END);
+  EXPECT_EQ(doc.cursorY, 99);
+  EXPECT_EQ(doc.cursorX, 13);
+  processKey(CTRL_HOME);
+  EXPECT_EQ(doc.cursorY, 0);
+  EXPECT_EQ(doc.cursorX, 0);
+}
+
+TEST_F(DocumentTest, WrapsLongLines) {
+  ofstream(first) << "short\n" << string(100, 'x') << "y\nlast\n";
+  editorOpen(first);
+  Document& doc = *g_E.doc;
+  processKey(ctrlWith('w'));
+  EXPECT_TRUE(g_E.wrapLines);
+  composeFrame(0);
+  EXPECT_EQ(doc.wrap.totalRows(), 5u);  // 101 columns take 3 rows of 40
+
+  // the end of the long line is on its third row
+  processKey(ARROW_DOWN);
+  processKey(END_KEY);
+  string frame = composeFrame(0);
+  EXPECT_NE(frame.find("\x1b[4;22H"), string::npos);
+
+  // typing changes the rows of the line it is on
+  for (int i = 0; i < 20; ++i) processKey('z');
+  composeFrame(0);
+  EXPECT_EQ(doc.wrap.rowsOf(1), 4u);
+  EXPECT_EQ(doc.wrap.totalRows(), 6u);
+
+  setWindowSize(10, 200);
+  composeFrame(0);
+  EXPECT_EQ(doc.wrap.totalRows(), 3u);
+
+  processKey(ctrlWith('w'));
+  EXPECT_FALSE(doc.wrap.built());
+}
+
+TEST_F(DocumentTest, EditsColumnsAtOnce) {
+  ofstream(first) << "{1, 2},\n{3, 4},\n{5},\nend\n";
+  editorOpen(first);
+  Document& doc = *g_E.doc;
+  processKey(ARROW_RIGHT);
+  processKey(ALT_DOWN);
+  processKey(ALT_DOWN);
+  EXPECT_EQ(doc.cursors.size(), 2u);
+  EXPECT_NE(composeFrame(0).find("\x1b[7m3"), string::npos);
+
+  for (char c : string("0, ")) processKey(c);
+  EXPECT_EQ(doc.buffer.line(0).str(), "{0, 1, 2},");
+  EXPECT_EQ(doc.buffer.line(1).str(), "{0, 3, 4},");
+  EXPECT_EQ(doc.buffer.line(2).str(), "{0, 5},");
+  EXPECT_EQ(doc.cursorX, 4);
+  processKey(BACKSPACE);
+  processKey(END_KEY);
+  processKey(';');
+  EXPECT_EQ(doc.buffer.line(0).str(), "{0,1, 2},;");
+  EXPECT_EQ(doc.buffer.line(2).str(), "{0,5},;");
+
+  // every key is one step back
+  processKey(ctrlWith('z'));
+  EXPECT_TRUE(doc.cursors.empty());  // any other key leaves the column
+  EXPECT_EQ(doc.buffer.line(2).str(), "{0,5},");
+  processKey(ctrlWith('z'));
+  EXPECT_EQ(doc.buffer.line(1).str(), "{0, 3, 4},");
+  processKey(ctrlWith('z'));
+  EXPECT_EQ(doc.buffer.line(0).str(), "{0,1, 2},");
+  EXPECT_EQ(doc.buffer.line(2).str(), "{0,5},");
+  processKey(ctrlWith('y'));
+  EXPECT_EQ(doc.buffer.line(1).str(), "{0, 3, 4},");
+
+  // going back up takes the cursors away
+  processKey(ALT_DOWN);
+  processKey(ALT_UP);
+  EXPECT_TRUE(doc.cursors.empty());
+}
+
+TEST_F(DocumentTest, ReplacesAllAsOneEdit) {
+  ofstream(first) << "int n = 3;\nfor (n = 0; n < 3; ++n)\n  f(n);\n";
+  editorOpen(first);
+  Document& doc = *g_E.doc;
+  processKey(ARROW_DOWN);
+  composeFrame(0);
+
+  processKey(ctrlWith('\\'));
+  for (char c : string(" n")) processKey(c);
+  processKey('\r');
+  for (char c : string(" count")) processKey(c);
+  processKey('\r');
+  EXPECT_EQ(doc.buffer.line(0).str(), "int count = 3;");
+  EXPECT_EQ(doc.buffer.line(1).str(), "for (n = 0; count < 3; ++n)");
+  EXPECT_NE(composeFrame(0).find("Replaced 2 occurrences"), string::npos);
+  EXPECT_TRUE(doc.modified);
+
+  processKey(ctrlWith('z'));
+  EXPECT_EQ(doc.buffer.line(0).str(), "int n = 3;");
+  EXPECT_EQ(doc.buffer.line(1).str(), "for (n = 0; n < 3; ++n)");
+  EXPECT_EQ(doc.cursorY, 1);
+  processKey(ctrlWith('y'));
+  EXPECT_EQ(doc.buffer.line(1).str(), "for (n = 0; count < 3; ++n)");
+
+  processKey(ctrlWith('\\'));
+  for (char c : string("none")) processKey(c);
+  processKey('\r');
+  processKey('x');
+  processKey('\r');
+  EXPECT_NE(composeFrame(0).find("Not found: none"), string::npos);
+}
+
+TEST_F(DocumentTest, TypingBelowTheLastLineIsOneEdit) {
+  editorOpen(first);
+  Document& doc = *g_E.doc;
+  for (int i = 0; i < 3; ++i) processKey(ARROW_DOWN);
+  for (char c : string("four")) processKey(c);
+  ASSERT_EQ(doc.buffer.lineCount(), 4u);
+  EXPECT_EQ(doc.buffer.line(3).str(), "four");
+
+  processKey(ctrlWith('z'));
+  EXPECT_EQ(doc.buffer.lineCount(), 3u);
+  EXPECT_EQ(doc.buffer.line(2).str(), "three");
+  EXPECT_EQ(doc.cursorY, 3);
+  processKey(ctrlWith('y'));
+  EXPECT_EQ(doc.buffer.line(3).str(), "four");
+
+  // the first line of an empty file
+  ofstream(second).flush();
+  addDocument(second);
+  processKey(ctrlWith('b'));
+  processKey('x');
+  EXPECT_EQ(g_E.doc->buffer.line(0).str(), "x");
+  processKey(ctrlWith('z'));
+  EXPECT_EQ(g_E.doc->buffer.line(0).str(), "");
+}
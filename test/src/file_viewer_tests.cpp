@@ -0,0 +1,99 @@
+#include <file_viewer.h>
+#include "gtest/gtest.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class FileViewerTest : public ::testing::Test {
+
+protected:
+  string path = "file_viewer_test.txt";
+
+  virtual void TearDown() {
+    remove(path.c_str());
+  };
+
+  void write(const string& contents) { ofstream(path) << contents; }
+};
+
+TEST_F(FileViewerTest, WalksLinesBothWays) {
+  write("first\n\nthird\nlast");
+  FileViewer viewer;
+  ASSERT_TRUE(viewer.open(path));
+  EXPECT_EQ(viewer.size(), 17u);
+
+  EXPECT_EQ(viewer.line(0).str(), "first");
+  EXPECT_EQ(viewer.nextLine(0), 6u);
+  EXPECT_EQ(viewer.line(6).str(), "");
+  EXPECT_EQ(viewer.nextLine(6), 7u);
+  EXPECT_EQ(viewer.nextLine(7), 13u);
+  EXPECT_EQ(viewer.line(13).str(), "last");
+  EXPECT_EQ(viewer.nextLine(13), 17u);
+  EXPECT_EQ(viewer.line(17).str(), "");
+
+  EXPECT_EQ(viewer.previousLine(13), 7u);
+  EXPECT_EQ(viewer.previousLine(7), 6u);
+  EXPECT_EQ(viewer.previousLine(6), 0u);
+  EXPECT_EQ(viewer.previousLine(0), 0u);
+
+  EXPECT_EQ(viewer.lineStart(9), 7u);
+  EXPECT_EQ(viewer.lineStart(5), 0u);  // the newline belongs to its line
+  EXPECT_EQ(viewer.lineStart(100), 13u);
+}
+
+TEST_F(FileViewerTest, MovesTheWindowAcrossTheFile) {
+  string contents;
+  vector<size_t> starts;
+  for (int i = 0; i < 20000; ++i) {
+    starts.push_back(contents.size());
+    contents += "line " + to_string(i) + "\n";
+  }
+  write(contents);
+
+  // the smallest window, a few pages
+  FileViewer viewer(0, 64);
+  ASSERT_TRUE(viewer.open(path));
+  size_t offset = 0;
+  for (int i = 0; i < 20000; ++i) {
+    ASSERT_EQ(offset, starts[i]);
+    ASSERT_EQ(viewer.line(offset).str(), "line " + to_string(i));
+    offset = viewer.nextLine(offset);
+  }
+  EXPECT_EQ(offset, viewer.size());
+  for (int i = 19999; i > 0; --i) {
+    offset = viewer.previousLine(offset);
+    ASSERT_EQ(offset, starts[i]);
+  }
+  EXPECT_EQ(viewer.lineStart(starts[12345] + 3), starts[12345]);
+  EXPECT_EQ(viewer.lineStart(starts[10] + 2), starts[10]);
+}
+
+TEST_F(FileViewerTest, CutsLongLines) {
+  write(string(10, 'a') + "\nb\n");
+  FileViewer viewer(0, 4);
+  ASSERT_TRUE(viewer.open(path));
+  EXPECT_EQ(viewer.line(0).str(), "aaaa");
+  EXPECT_EQ(viewer.nextLine(0), 4u);
+  EXPECT_EQ(viewer.nextLine(8), 11u);
+  EXPECT_EQ(viewer.line(8).str(), "aa");
+  EXPECT_EQ(viewer.line(11).str(), "b");
+}
+
+TEST_F(FileViewerTest, EmptyAndMissingFiles) {
+  write("");
+  FileViewer viewer;
+  ASSERT_TRUE(viewer.open(path));
+  EXPECT_EQ(viewer.size(), 0u);
+  EXPECT_EQ(viewer.line(0).str(), "");
+  EXPECT_EQ(viewer.nextLine(0), 0u);
+  EXPECT_EQ(viewer.lineStart(0), 0u);
+
+  EXPECT_FALSE(viewer.open("no/such/file"));
+  EXPECT_EQ(errno, ENOENT);
+  EXPECT_FALSE(viewer.isOpen());
+}
@@ -0,0 +1,76 @@
+#include <buffer.h>
+#include <identifier_index.h>
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST(IdentifierIndexTest, CountsIdentifiers) {
+  IdentifierIndex index;
+  index.add(LineView("int count = count + 1; // x y2 42 _tmp"));
+  EXPECT_EQ(index.count("count"), 2);
+  EXPECT_EQ(index.count("int"), 1);
+  EXPECT_EQ(index.count("y2"), 1);
+  EXPECT_EQ(index.count("_tmp"), 1);
+  // too short to complete, or numbers
+  EXPECT_EQ(index.count("x"), 0);
+  EXPECT_EQ(index.count("42"), 0);
+
+  index.remove(LineView("count"));
+  EXPECT_EQ(index.count("count"), 1);
+  index.remove(LineView("int count"));
+  EXPECT_EQ(index.count("count"), 0);
+  EXPECT_EQ(index.size(), 2u);
+}
+
+TEST(IdentifierIndexTest, CompletesMostFrequentFirst) {
+  IdentifierIndex index;
+  index.add(LineView("value values valid valid valid vector"));
+  index.add(LineView("values"));
+
+  vector<string> out;
+  index.complete(LineView("val"), 10, out);
+  EXPECT_EQ(out, (vector<string>{"valid", "values", "value"}));
+  index.complete(LineView("val"), 2, out);
+  EXPECT_EQ(out, (vector<string>{"valid", "values"}));
+  // the prefix itself is not a completion
+  index.complete(LineView("value"), 10, out);
+  EXPECT_EQ(out, (vector<string>{"values"}));
+  index.complete(LineView("w"), 10, out);
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(IdentifierIndexTest, MergesEditsMadeDuringTheScan) {
+  TextBuffer buffer;
+  buffer.appendLine("alpha beta");
+  buffer.appendLine("alpha");
+  Snapshot snapshot = buffer.snapshot();
+
+  // line 1 is edited while the snapshot is scanned
+  IdentifierIndex edits;
+  edits.remove(buffer.line(1));
+  buffer.setLine(1, "gamma");
+  edits.add(buffer.line(1));
+
+  IdentifierIndex scanned;
+  atomic<bool> stop(false);
+  ASSERT_TRUE(scanned.addSnapshot(snapshot, stop));
+  EXPECT_EQ(scanned.count("alpha"), 2);
+
+  edits.merge(scanned);
+  EXPECT_EQ(edits.count("alpha"), 1);
+  EXPECT_EQ(edits.count("beta"), 1);
+  EXPECT_EQ(edits.count("gamma"), 1);
+  EXPECT_EQ(edits.size(), 3u);
+}
+
+TEST(IdentifierIndexTest, GivesUpWhenStopped) {
+  TextBuffer buffer;
+  buffer.appendLine("alpha");
+  IdentifierIndex index;
+  atomic<bool> stop(true);
+  EXPECT_FALSE(index.addSnapshot(buffer.snapshot(), stop));
+}
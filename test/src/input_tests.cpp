@@ -0,0 +1,86 @@
+#include <input.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class InputDecoderTest : public ::testing::Test {
+
+protected:
+  InputDecoder input;
+
+  void feed(const string &bytes) {
+    input.feed(bytes.data(), bytes.size());
+  }
+
+  vector<int> keys(bool flush = false) {
+    vector<int> result;
+    int key;
+    while ((key = input.next(flush)) != 0 && key != InputDecoder::INCOMPLETE)
+      result.push_back(key);
+    return result;
+  }
+};
+
+TEST_F(InputDecoderTest, DecodesPlainKeys) {
+  feed("ab\r");
+  EXPECT_EQ(keys(), (vector<int>{'a', 'b', '\r'}));
+  EXPECT_EQ(input.next(), 0);
+}
+
+TEST_F(InputDecoderTest, DecodesEscapeSequences) {
+  feed("\x1b[A\x1b[B\x1b[C\x1b[D\x1b[5~\x1b[6~\x1b[3~\x1b[1~\x1b[F\x1bOH");
+  EXPECT_EQ(keys(), (vector<int>{ARROW_UP, ARROW_DOWN, ARROW_RIGHT, ARROW_LEFT,
+                                 PAGE_UP, PAGE_DOWN, DEL_KEY, HOME_KEY,
+                                 END_KEY, HOME_KEY}));
+}
+
+TEST_F(InputDecoderTest, DecodesModifiedKeys) {
+  feed("\x1b[1;5C\x1b[1;5D\x1b[1;5H\x1b[1;5F\x1b[1;2C\x1b[1;3A\x1b[1;3B");
+  EXPECT_EQ(keys(), (vector<int>{CTRL_RIGHT, CTRL_LEFT, CTRL_HOME, CTRL_END,
+                                 ARROW_RIGHT, ALT_UP, ALT_DOWN}));
+}
+
+TEST_F(InputDecoderTest, WaitsForSplitSequences) {
+  feed("x\x1b[");
+  EXPECT_EQ(input.next(), 'x');
+  EXPECT_EQ(input.next(), InputDecoder::INCOMPLETE);
+  feed("6~");
+  EXPECT_EQ(input.next(), PAGE_DOWN);
+}
+
+TEST_F(InputDecoderTest, LoneEscapeOnFlush) {
+  feed("\x1b");
+  EXPECT_EQ(input.next(), InputDecoder::INCOMPLETE);
+  EXPECT_EQ(input.next(true), '\x1b');
+  EXPECT_TRUE(input.empty());
+}
+
+TEST_F(InputDecoderTest, BracketedPasteIsOneKey) {
+  feed("a\x1b[200~int x;\r\x1b[A\x1b[201~b");
+  EXPECT_EQ(input.next(), 'a');
+  EXPECT_EQ(input.next(), PASTE);
+  EXPECT_EQ(input.paste(), "int x;\r\x1b[A");
+  EXPECT_EQ(input.next(), 'b');
+}
+
+TEST_F(InputDecoderTest, PasteAcrossReads) {
+  feed("\x1b[200~first ");
+  EXPECT_EQ(input.next(), InputDecoder::INCOMPLETE);
+  feed("second\x1b[20");
+  EXPECT_EQ(input.next(), InputDecoder::INCOMPLETE);
+  feed("1~");
+  EXPECT_EQ(input.next(), PASTE);
+  EXPECT_EQ(input.paste(), "first second");
+  EXPECT_EQ(input.next(), 0);
+}
+
+TEST_F(InputDecoderTest, FlushHandsOutPartialPaste) {
+  feed("\x1b[200~part\x1b[2");
+  EXPECT_EQ(input.next(true), PASTE);
+  EXPECT_EQ(input.paste(), "part");
+  feed("01~");
+  EXPECT_EQ(input.next(), 0);
+}
@@ -0,0 +1,120 @@
+#include <line_tree.h>
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// sum and largest value of some lines
+struct SumMax {
+  long long sum;
+  int max;
+};
+
+struct Traits {
+  typedef int Value;
+  typedef SumMax Sum;
+  static SumMax sum(int value) { return SumMax{value, value}; }
+  static SumMax combine(const SumMax& a, const SumMax& b) {
+    return SumMax{a.sum + b.sum, max(a.max, b.max)};
+  }
+};
+
+}  // namespace
+
+class LineTreeTest : public ::testing::Test {
+
+protected:
+  LineTree<Traits> tree;
+  vector<int> lines;  // what the tree should hold
+
+  void expectLines() {
+    ASSERT_EQ(tree.size(), lines.size());
+    long long sum = 0;
+    for (size_t y = 0; y < lines.size(); ++y) {
+      ASSERT_EQ(tree[y], lines[y]) << "line " << y;
+      ASSERT_EQ(tree.prefix(y).sum, sum) << "line " << y;
+      sum += lines[y];
+    }
+    EXPECT_EQ(tree.total().sum, sum);
+    EXPECT_EQ(tree.prefix(lines.size()).sum, sum);
+  }
+};
+
+TEST_F(LineTreeTest, InsertsAndErasesAnywhere) {
+  lines = {5, 1, 4};
+  tree.assign(lines.size(), [this](size_t y) { return lines[y]; });
+  expectLines();
+
+  tree.insert(1, 3, 7);
+  lines.insert(lines.begin() + 1, 3, 7);
+  tree.push_back(2);
+  lines.push_back(2);
+  tree.append(2, [](size_t i) { return static_cast<int>(i) + 8; });
+  lines.push_back(8);
+  lines.push_back(9);
+  expectLines();
+  EXPECT_EQ(tree.total().max, 9);
+
+  tree.erase(1, 3);
+  lines.erase(lines.begin() + 1, lines.begin() + 4);
+  tree.erase(lines.size() - 2, 2);
+  lines.resize(lines.size() - 2);
+  tree.set(0, -1);
+  lines[0] = -1;
+  expectLines();
+  EXPECT_EQ(tree.total().max, 4);
+
+  tree.erase(0, lines.size());
+  EXPECT_TRUE(tree.empty());
+  EXPECT_EQ(tree.total().sum, 0);
+}
+
+TEST_F(LineTreeTest, AgreesWithAVectorAfterEdits) {
+  srand(7);
+  for (int step = 0; step < 2000; ++step) {
+    size_t y = lines.empty() ? 0 : rand() % (lines.size() + 1);
+    int value = rand() % 100;
+    switch (rand() % 3) {
+      case 0: {
+        size_t n = rand() % 4;
+        tree.insert(y, n, value);
+        lines.insert(lines.begin() + y, n, value);
+        break;
+      }
+      case 1: {
+        size_t n = min<size_t>(rand() % 4, lines.size() - y);
+        tree.erase(y, n);
+        lines.erase(lines.begin() + y, lines.begin() + y + n);
+        break;
+      }
+      default:
+        if (y == lines.size()) break;
+        tree.set(y, value);
+        lines[y] = value;
+    }
+  }
+  expectLines();
+}
+
+TEST_F(LineTreeTest, ModifiesOnlyTheSubtreesItVisits) {
+  lines.assign(1000, 1);
+  lines[10] = lines[500] = 50;
+  tree.assign(lines.size(), [this](size_t y) { return lines[y]; });
+
+  size_t changed = 0;
+  tree.modify([](const SumMax& lines) { return lines.max >= 50; },
+              [&changed](size_t, int& value) {
+                changed++;
+                if (value >= 50) value = 2;
+              });
+  lines[10] = lines[500] = 2;
+  expectLines();
+  EXPECT_EQ(tree.total().max, 2);
+  // the lines under the two, not all of them
+  EXPECT_LT(changed, 200u);
+}
@@ -0,0 +1,103 @@
+#include <profile.h>
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+static string traceOf(const FrameProfile& profile) {
+  FILE* f = tmpfile();
+  profile.writeTrace(f);
+  string out(ftell(f), '\0');
+  rewind(f);
+  size_t n = fread(&out[0], 1, out.size(), f);
+  out.resize(n);
+  fclose(f);
+  return out;
+}
+
+static size_t linesOf(const string& text) {
+  size_t n = 0;
+  for (char c : text) n += c == '\n';
+  return n;
+}
+
+TEST(LatencyHistogramTest, PercentilesAreWithinABucket) {
+  LatencyHistogram h;
+  EXPECT_EQ(h.percentile(50), 0);
+  for (int i = 0; i < 90; ++i) h.add(100);
+  for (int i = 0; i < 10; ++i) h.add(5000);
+  EXPECT_EQ(h.count(), 100u);
+
+  double p50 = h.percentile(50);
+  EXPECT_GT(p50, 100);
+  EXPECT_LT(p50, 100 * 1.19);
+  double p99 = h.percentile(99);
+  EXPECT_GT(p99, 5000);
+  EXPECT_LT(p99, 5000 * 1.19);
+  EXPECT_EQ(h.percentile(90), p50);
+
+  h.clear();
+  EXPECT_EQ(h.count(), 0u);
+}
+
+TEST(LatencyHistogramTest, KeepsExtremes) {
+  LatencyHistogram h;
+  h.add(0.2);
+  h.add(1e9);
+  EXPECT_EQ(h.percentile(50), 1);
+  EXPECT_GT(h.percentile(100), 5e5);
+}
+
+TEST(FrameProfileTest, RecordsNothingWhileOff) {
+  FrameProfile profile;
+  EXPECT_FALSE(profile.enabled());
+  profile.beginFrame();
+  profile.mark(PHASE_PROCESS);
+  profile.endFrame(100);
+  EXPECT_EQ(profile.frames().count(), 0u);
+}
+
+TEST(FrameProfileTest, RecordsFramesThatDidSomething) {
+  FrameProfile profile;
+  profile.setOverlay(true);
+  profile.beginFrame();
+  profile.mark(PHASE_DECODE);
+  profile.mark(PHASE_PROCESS);
+  profile.mark(PHASE_COMPOSE);
+  profile.endFrame(42);
+  EXPECT_EQ(profile.frames().count(), 1u);
+  EXPECT_EQ(profile.phase(PHASE_WRITE).count(), 1u);
+  EXPECT_EQ(profile.lastFrameBytes(), 42u);
+
+  // woken up without a key and without output
+  profile.beginFrame();
+  profile.endFrame(0);
+  EXPECT_EQ(profile.frames().count(), 1u);
+
+  // hiding and showing the overlay again starts over
+  profile.setOverlay(false);
+  EXPECT_FALSE(profile.enabled());
+  profile.setOverlay(true);
+  EXPECT_EQ(profile.frames().count(), 0u);
+}
+
+TEST(FrameProfileTest, TraceKeepsTheLastFrames) {
+  FrameProfile profile;
+  profile.setTrace(3);
+  EXPECT_TRUE(profile.enabled());
+  EXPECT_FALSE(profile.showOverlay());
+  for (int i = 1; i <= 5; ++i) {
+    profile.beginFrame();
+    profile.mark(PHASE_PROCESS);
+    profile.endFrame(i);
+  }
+  string trace = traceOf(profile);
+  EXPECT_EQ(linesOf(trace), 4u);  // the header and 3 frames
+  EXPECT_EQ(trace[0], '#');
+  // oldest first, the bytes come before the key count
+  EXPECT_LT(trace.find(" 3 1\n"), trace.find(" 4 1\n"));
+  EXPECT_LT(trace.find(" 4 1\n"), trace.find(" 5 1\n"));
+  EXPECT_EQ(trace.find(" 2 1\n"), string::npos);
+}
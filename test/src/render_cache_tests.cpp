@@ -0,0 +1,47 @@
+#include <render_cache.h>
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace std;
+
+TEST(RenderCacheTest, FindsOnlyCachedLines) {
+  RenderCache cache(4);
+  EXPECT_EQ(cache.find(0), nullptr);
+  cache.put(0).text = "zero";
+  cache.put(5).text = "five";
+  ASSERT_NE(cache.find(5), nullptr);
+  EXPECT_EQ(cache.find(5)->text, "five");
+  EXPECT_EQ(cache.find(0)->text, "zero");
+  EXPECT_EQ(cache.find(1), nullptr);
+
+  // line 9 shares the slot of line 5
+  cache.put(9).text = "nine";
+  EXPECT_EQ(cache.find(5), nullptr);
+}
+
+TEST(RenderCacheTest, InvalidateOnlyTouchesOneLine) {
+  RenderCache cache(8);
+  for (int i = 0; i < 8; ++i) cache.put(i).text = to_string(i);
+  cache.invalidate(3);
+  EXPECT_EQ(cache.find(3), nullptr);
+  EXPECT_EQ(cache.find(2)->text, "2");
+  EXPECT_EQ(cache.find(4)->text, "4");
+}
+
+TEST(RenderCacheTest, ShiftsLinesOnInsertAndErase) {
+  RenderCache cache(8);
+  for (int i = 0; i < 4; ++i) cache.put(i).text = to_string(i);
+
+  cache.insertLines(1, 2);
+  EXPECT_EQ(cache.find(0)->text, "0");
+  EXPECT_EQ(cache.find(1), nullptr);
+  EXPECT_EQ(cache.find(2), nullptr);
+  EXPECT_EQ(cache.find(3)->text, "1");
+  EXPECT_EQ(cache.find(5)->text, "3");
+
+  cache.eraseLines(0, 3);
+  EXPECT_EQ(cache.find(0)->text, "1");
+  EXPECT_EQ(cache.find(2)->text, "3");
+  EXPECT_EQ(cache.find(3), nullptr);
+}
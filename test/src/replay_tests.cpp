@@ -0,0 +1,51 @@
+#include <editor.h>
+#include <replay.h>
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace std;
+
+static void startEditor() {
+  initEditor();
+  setWindowSize(10, 40);
+  composeFrame(0);
+}
+
+TEST(ReplayTest, TypesEveryKeyAndDrawsAFrame) {
+  startEditor();
+  ReplayStats stats = replayKeys("ab\rc\x1b[D");
+  EXPECT_EQ(stats.keys(), 5u);
+  EXPECT_FALSE(stats.quit);
+  EXPECT_GT(stats.outputBytes, 0u);
+  ASSERT_EQ(g_E.doc->buffer.lineCount(), 2u);
+  EXPECT_EQ(g_E.doc->buffer.line(0).str(), "ab");
+  EXPECT_EQ(g_E.doc->buffer.line(1).str(), "c");
+  EXPECT_EQ(g_E.doc->cursorX, 0);
+}
+
+TEST(ReplayTest, PasteIsOneKey) {
+  startEditor();
+  ReplayStats stats = replayKeys("\x1b[200~one\rtwo\x1b[201~");
+  EXPECT_EQ(stats.keys(), 1u);
+  ASSERT_EQ(g_E.doc->buffer.lineCount(), 2u);
+  EXPECT_EQ(g_E.doc->buffer.line(1).str(), "two");
+}
+
+TEST(ReplayTest, StopsAtQuit) {
+  startEditor();
+  ReplayStats stats = replayKeys("a\x11" "b");
+  EXPECT_EQ(stats.keys(), 1u);
+  EXPECT_TRUE(stats.quit);
+  EXPECT_EQ(g_E.doc->buffer.line(0).str(), "a");
+}
+
+TEST(ReplayTest, PercentilesUseNearestRank) {
+  ReplayStats stats;
+  EXPECT_EQ(stats.percentile(50), 0);
+  for (int i = 100; i >= 1; --i) stats.latencies.push_back(i);
+  EXPECT_EQ(stats.percentile(50), 50);
+  EXPECT_EQ(stats.percentile(99), 99);
+  EXPECT_EQ(stats.percentile(100), 100);
+  EXPECT_EQ(stats.percentile(0), 1);
+}
@@ -0,0 +1,137 @@
+#include <sample_runner.h>
+#include "gtest/gtest.h"
+
+#include <poll.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class SampleRunnerTest : public ::testing::Test {
+
+protected:
+  string dir = "sample_runner_test";
+
+  virtual void SetUp() {
+    mkdir(dir.c_str(), 0755);
+  }
+
+  virtual void TearDown() {
+    system(("rm -rf " + dir).c_str());
+  };
+
+  // a shell script standing for a solution
+  string program(const string& script) {
+    string path = dir + "/solution.sh";
+    ofstream(path) << "#!/bin/sh\n" << script;
+    chmod(path.c_str(), 0755);
+    return path;
+  }
+
+  // poll the runner until every case is done, as the main loop would
+  void runToEnd(SampleRunner& runner) {
+    while (runner.running()) {
+      vector<int> fds;
+      runner.outputFds(fds);
+      vector<struct pollfd> polled;
+      for (int fd : fds) polled.push_back(pollfd{fd, POLLIN, 0});
+      poll(polled.data(), polled.size(), 10);
+      runner.poll();
+    }
+  }
+};
+
+TEST_F(SampleRunnerTest, ComparesAnswersLineByLine) {
+  size_t line;
+  EXPECT_TRUE(SampleRunner::sameAnswer("1 2\n3\n", "1 2\n3\n", line));
+  // whitespace at the end of lines and of the output doesn't matter
+  EXPECT_TRUE(SampleRunner::sameAnswer("1 2  \r\n3", "1 2\n3\n\n", line));
+  EXPECT_TRUE(SampleRunner::sameAnswer("", "\n", line));
+  EXPECT_FALSE(SampleRunner::sameAnswer("1 2\n4\n", "1 2\n3\n", line));
+  EXPECT_EQ(line, 2u);
+  EXPECT_FALSE(SampleRunner::sameAnswer("1  2\n", "1 2\n", line));
+  EXPECT_EQ(line, 1u);
+  EXPECT_FALSE(SampleRunner::sameAnswer("1\n", "1\n2\n", line));
+  EXPECT_EQ(line, 2u);
+}
+
+TEST_F(SampleRunnerTest, FindsInputsInNaturalOrder) {
+  for (const char* name : {"10.in", "2.in", "1.out", "b.in", "a2.in",
+                           "a10.in", "notes.txt"})
+    ofstream(dir + "/" + name) << "";
+  vector<string> inputs = SampleRunner::findInputs(dir + "/a.cpp");
+  vector<string> expected{dir + "/2.in", dir + "/10.in", dir + "/a2.in",
+                          dir + "/a10.in", dir + "/b.in"};
+  EXPECT_EQ(inputs, expected);
+}
+
+TEST_F(SampleRunnerTest, JudgesEveryCase) {
+  string binary = program(
+      "read n\n"
+      "case $n in\n"
+      "  1) echo one ;;\n"
+      "  2) echo debugging >&2; echo two ;;\n"
+      "  3) kill -SEGV $$ ;;\n"
+      "  *) echo other ;;\n"
+      "esac\n");
+  vector<string> inputs;
+  for (string n : {"1", "2", "3", "4"}) {
+    ofstream(dir + "/" + n + ".in") << n << "\n";
+    if (n != "4") ofstream(dir + "/" + n + ".out") << (n == "2" ? "two" : "1");
+    inputs.push_back(dir + "/" + n + ".in");
+  }
+
+  SampleRunner runner;
+  runner.start(binary, inputs, 2);
+  EXPECT_EQ(runner.count(SampleCase::RUNNING), 2u);
+  EXPECT_EQ(runner.count(SampleCase::WAITING), 2u);
+  runToEnd(runner);
+
+  const vector<SampleCase>& cases = runner.cases();
+  ASSERT_EQ(cases.size(), 4u);
+  EXPECT_EQ(cases[0].verdict, SampleCase::WRONG);
+  EXPECT_EQ(cases[0].output, "one\n");
+  EXPECT_EQ(cases[1].verdict, SampleCase::PASSED);  // stderr isn't read
+  EXPECT_EQ(cases[2].verdict, SampleCase::CRASHED);
+  EXPECT_EQ(cases[3].verdict, SampleCase::RAN);
+  for (const SampleCase& sample : cases) {
+    EXPECT_GT(sample.wall, 0);
+    EXPECT_GE(sample.cpu, 0);
+    EXPECT_GT(sample.peakKb, 0);
+  }
+}
+
+TEST_F(SampleRunnerTest, RunsCasesAtTheSameTime) {
+  string binary = program("sleep 0.3\n");
+  vector<string> inputs;
+  for (int i = 0; i < 8; ++i) {
+    string input = dir + "/" + to_string(i) + ".in";
+    ofstream(input) << "";
+    inputs.push_back(input);
+  }
+  SampleRunner runner;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  // sleeping takes no CPU, 8 workers finish in about the time of one case
+  runner.start(binary, inputs, 8);
+  runToEnd(runner);
+  double seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  EXPECT_EQ(runner.count(SampleCase::RAN), 8u);
+  EXPECT_LT(seconds, 8 * 0.3 / 2);
+}
+
+TEST_F(SampleRunnerTest, KillsCasesOverTheTimeLimit) {
+  string binary = program("sleep 30\n");
+  ofstream(dir + "/1.in") << "";
+  SampleRunner runner(0.2);
+  runner.start(binary, vector<string>{dir + "/1.in"});
+  runToEnd(runner);
+  EXPECT_EQ(runner.cases()[0].verdict, SampleCase::TIMED_OUT);
+  EXPECT_LT(runner.cases()[0].wall, 5);
+}
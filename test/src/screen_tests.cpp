@@ -0,0 +1,107 @@
+#include <screen.h>
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace std;
+
+class ScreenTest : public ::testing::Test {
+
+protected:
+  Screen screen;
+  string out;
+
+  virtual void SetUp() {
+    screen.resize(3);
+  };
+};
+
+TEST_F(ScreenTest, FirstFrameDrawsEveryRow) {
+  for (int row = 0; row < 3; ++row) {
+    EXPECT_TRUE(screen.isDirty(row));
+    screen.updateRow(row, "", out);
+    EXPECT_FALSE(screen.isDirty(row));
+  }
+  EXPECT_EQ(out, "\x1b[1;1H\x1b[K\x1b[2;1H\x1b[K\x1b[3;1H\x1b[K");
+}
+
+TEST_F(ScreenTest, UnchangedRowsAreNotSent) {
+  screen.updateRow(0, "int main() {", out);
+  out.clear();
+  screen.invalidate();
+  screen.updateRow(0, "int main() {", out);
+  EXPECT_EQ(out, "");
+}
+
+TEST_F(ScreenTest, OnlyTheChangedPartIsSent) {
+  screen.updateRow(1, "int x;", out);
+  out.clear();
+  screen.updateRow(1, "int xy;", out);
+  EXPECT_EQ(out, "\x1b[2;6Hy;\x1b[K");
+  out.clear();
+  screen.updateRow(1, "int", out);
+  EXPECT_EQ(out, "\x1b[2;4H\x1b[K");
+}
+
+TEST_F(ScreenTest, InvalidateMarksRows) {
+  for (int row = 0; row < 3; ++row) screen.updateRow(row, "", out);
+  screen.invalidateRow(1);
+  screen.invalidateRow(7);
+  EXPECT_FALSE(screen.isDirty(0));
+  EXPECT_TRUE(screen.isDirty(1));
+  EXPECT_FALSE(screen.isDirty(2));
+  screen.invalidateFrom(-1);
+  EXPECT_TRUE(screen.isDirty(0));
+}
+
+TEST_F(ScreenTest, CursorIsOnlyMovedWhenNeeded) {
+  screen.placeCursor(2, 5, out);
+  EXPECT_EQ(out, "\x1b[2;5H");
+  out.clear();
+  screen.placeCursor(2, 5, out);
+  EXPECT_EQ(out, "");
+  screen.updateRow(0, "x", out);
+  out.clear();
+  screen.placeCursor(2, 5, out);
+  EXPECT_EQ(out, "\x1b[2;5H");
+}
+
+TEST_F(ScreenTest, ScrollingKeepsTheRowsShown) {
+  screen.resize(4);
+  for (int row = 0; row < 4; ++row) screen.updateRow(row, to_string(row), out);
+  out.clear();
+
+  // the last row is a status bar and stays where it is
+  screen.scroll(0, 3, 1, out);
+  EXPECT_EQ(out, "\x1b[1;3r\x1b[1S\x1b[r");
+  EXPECT_FALSE(screen.isDirty(0));
+  EXPECT_FALSE(screen.isDirty(1));
+  EXPECT_TRUE(screen.isDirty(2));
+  EXPECT_FALSE(screen.isDirty(3));
+  out.clear();
+  screen.updateRow(0, "1", out);
+  screen.updateRow(1, "2", out);
+  EXPECT_EQ(out, "");
+  screen.updateRow(2, "3", out);
+  EXPECT_EQ(out, "\x1b[3;1H3\x1b[K");
+
+  out.clear();
+  screen.scroll(0, 3, -2, out);
+  EXPECT_EQ(out, "\x1b[1;3r\x1b[2T\x1b[r");
+  EXPECT_TRUE(screen.isDirty(0));
+  EXPECT_TRUE(screen.isDirty(1));
+  EXPECT_FALSE(screen.isDirty(2));
+  out.clear();
+  screen.updateRow(2, "1", out);
+  EXPECT_EQ(out, "");
+}
+
+TEST_F(ScreenTest, ScrollingTheWholeRegionAwayRedrawsIt) {
+  for (int row = 0; row < 3; ++row) screen.updateRow(row, "x", out);
+  out.clear();
+  screen.scroll(0, 2, 2, out);
+  EXPECT_EQ(out, "");
+  EXPECT_TRUE(screen.isDirty(0));
+  EXPECT_TRUE(screen.isDirty(1));
+  EXPECT_FALSE(screen.isDirty(2));
+}
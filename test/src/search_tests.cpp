@@ -0,0 +1,155 @@
+#include <buffer.h>
+#include <mapped_file.h>
+#include <search.h>
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static long first(const string &text, const string &needle) {
+  const char *p = findFirst(text.data(), text.size(), needle);
+  return p ? p - text.data() : -1;
+}
+
+static long last(const string &text, const string &needle) {
+  const char *p = findLast(text.data(), text.size(), needle);
+  return p ? p - text.data() : -1;
+}
+
+TEST(SearchTest, FindFirst) {
+  EXPECT_EQ(first("abcabc", "c"), 2);
+  EXPECT_EQ(first("abcabc", "ca"), 2);
+  EXPECT_EQ(first("abcabc", "abd"), -1);
+  EXPECT_EQ(first("abc", ""), -1);
+  EXPECT_EQ(first("ab", "abc"), -1);
+}
+
+TEST(SearchTest, FindLast) {
+  EXPECT_EQ(last("abcabc", "c"), 5);
+  EXPECT_EQ(last("abcabc", "ab"), 3);
+  EXPECT_EQ(last("abcabc", "cb"), -1);
+  EXPECT_EQ(last("abc", ""), -1);
+  EXPECT_EQ(last("ab", "abc"), -1);
+}
+
+TEST(SearchTest, LongInputs) {
+  // matches on both sides of every vector boundary and at the very end
+  for (size_t n = 1; n < 70; ++n) {
+    string text(n, 'a');
+    text.replace(n - 1, 1, "xyz");
+    EXPECT_EQ(first(text, "xyz"), static_cast<long>(n - 1));
+    EXPECT_EQ(first(text, "ayz"), -1);
+    EXPECT_EQ(last(text, "axy"), n > 1 ? static_cast<long>(n - 2) : -1);
+  }
+  string text(1000, 'a');
+  EXPECT_EQ(first(text + "ab", "aab"), 999);
+  EXPECT_EQ(last("ab" + text, "aba"), 0);
+  EXPECT_EQ(last("xyz" + text + "xyz", "xyz"), 1003);
+}
+
+TEST(SearchTest, AgreesWithStringFind) {
+  // a small alphabet makes for many candidates failing late
+  srand(3);
+  for (int round = 0; round < 200; ++round) {
+    string text, needle;
+    for (int i = rand() % 100; i > 0; --i) text += "ab"[rand() % 2];
+    for (int i = rand() % 5 + 1; i > 0; --i) needle += "ab"[rand() % 2];
+    size_t f = text.find(needle), l = text.rfind(needle);
+    EXPECT_EQ(first(text, needle), f == string::npos ? -1 : long(f));
+    EXPECT_EQ(last(text, needle), l == string::npos ? -1 : long(l));
+  }
+}
+
+TEST(SearchTest, FindLineStarts) {
+  // newlines in every position of a 64 byte block and in the tail
+  string text;
+  for (int i = 0; i < 300; ++i) text += string(i % 70, 'x') + "\n";
+  text += "tail";
+  vector<size_t> expected;
+  for (size_t i = 0; i < text.size(); ++i)
+    if (text[i] == '\n') expected.push_back(100 + i + 1);
+
+  vector<size_t> starts;
+  findLineStarts(text.data(), text.size(), 100, starts);
+  EXPECT_EQ(starts, expected);
+
+  starts.assign(1, 7);
+  findLineStarts("\n\n", 2, 0, starts);
+  EXPECT_EQ(starts, vector<size_t>({7, 1, 2}));
+}
+
+class BufferSearchTest : public ::testing::Test {
+
+protected:
+  string path = "buffer_search_test.txt";
+  TextBuffer buffer;
+
+  virtual void TearDown() {
+    remove(path.c_str());
+  };
+
+  void load(const string &contents) {
+    ofstream(path) << contents;
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    ASSERT_TRUE(file->open(path));
+    buffer.load(file);
+  }
+
+  TextPosition forward(const string &needle, size_t y, size_t x) {
+    TextPosition match{~0u, ~0u};
+    buffer.search(needle, TextPosition{y, x}, match);
+    return match;
+  }
+
+  TextPosition backward(const string &needle, size_t y, size_t x) {
+    TextPosition match{~0u, ~0u};
+    buffer.searchBackward(needle, TextPosition{y, x}, match);
+    return match;
+  }
+};
+
+static bool operator==(const TextPosition &a, const TextPosition &b) {
+  return a.y == b.y && a.x == b.x;
+}
+
+static ostream &operator<<(ostream &os, const TextPosition &p) {
+  return os << "(" << p.y << ", " << p.x << ")";
+}
+
+static const TextPosition none{~0u, ~0u};
+
+TEST_F(BufferSearchTest, SearchMappedLines) {
+  load("int a;\nint b;\nreturn a + b;");
+  EXPECT_EQ(forward("int", 0, 0), (TextPosition{0, 0}));
+  EXPECT_EQ(forward("int", 0, 1), (TextPosition{1, 0}));
+  EXPECT_EQ(forward("b;", 0, 0), (TextPosition{1, 4}));
+  EXPECT_EQ(forward("b;", 1, 5), (TextPosition{2, 11}));
+  EXPECT_EQ(forward("int", 2, 0), none);
+}
+
+TEST_F(BufferSearchTest, SearchBackwardMappedLines) {
+  load("int a;\nint b;\nreturn a + b;\n");
+  EXPECT_EQ(backward("int", 3, 0), (TextPosition{1, 0}));
+  EXPECT_EQ(backward("int", 1, 0), (TextPosition{0, 0}));
+  EXPECT_EQ(backward("a", 2, 8), (TextPosition{2, 7}));
+  EXPECT_EQ(backward("a", 2, 7), (TextPosition{0, 4}));
+  EXPECT_EQ(backward("int", 0, 0), none);
+}
+
+TEST_F(BufferSearchTest, SearchEditedLines) {
+  load("one\ntwo\nthree\nfour\n");
+  buffer.setLine(1, "two needle");
+  buffer.insertLine(3, "needle");
+  EXPECT_EQ(forward("needle", 0, 0), (TextPosition{1, 4}));
+  EXPECT_EQ(forward("needle", 1, 5), (TextPosition{3, 0}));
+  EXPECT_EQ(forward("four", 1, 5), (TextPosition{4, 0}));
+  EXPECT_EQ(backward("needle", 4, 0), (TextPosition{3, 0}));
+  EXPECT_EQ(backward("needle", 3, 0), (TextPosition{1, 4}));
+  EXPECT_EQ(backward("one", 3, 0), (TextPosition{0, 0}));
+}
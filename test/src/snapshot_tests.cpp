@@ -0,0 +1,122 @@
+#include <buffer.h>
+#include <snapshot.h>
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+class SnapshotTest : public ::testing::Test {
+
+protected:
+  string path = "snapshot_test.txt";
+
+  virtual void TearDown() {
+    remove(path.c_str());
+  };
+
+  void write(const string &contents) {
+    ofstream(path) << contents;
+  }
+
+  string read() {
+    ifstream ifs(path);
+    stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+  }
+
+  shared_ptr<MappedFile> map() {
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    EXPECT_TRUE(file->open(path));
+    return file;
+  }
+};
+
+TEST_F(SnapshotTest, UntouchedFileIsOneSourceRange) {
+  write("a\nbb\nccc\n");
+  TextBuffer buffer;
+  buffer.load(map());
+  Snapshot snapshot = buffer.snapshot();
+  EXPECT_EQ(snapshot.size(), 9u);
+  ASSERT_TRUE(saveAtomically(snapshot, path));
+  EXPECT_EQ(read(), "a\nbb\nccc\n");
+}
+
+TEST_F(SnapshotTest, KeepsContentsWhileBufferChanges) {
+  write("first\nsecond\nthird");
+  TextBuffer buffer;
+  buffer.load(map());
+  buffer.insertChar(1, 0, '2');
+  buffer.appendLine("fourth");
+
+  Snapshot snapshot = buffer.snapshot();
+  buffer.eraseLine(0);
+  buffer.insertChar(0, 0, 'x');
+
+  ASSERT_TRUE(saveAtomically(snapshot, path));
+  EXPECT_EQ(read(), "first\n2second\nthird\nfourth\n");
+}
+
+TEST_F(SnapshotTest, MappingSurvivesSave) {
+  write("one\ntwo\n");
+  TextBuffer buffer;
+  buffer.load(map());
+  buffer.setLine(0, "ONE");
+  ASSERT_TRUE(saveAtomically(buffer.snapshot(), path));
+  buffer.setLine(0, "1");
+  ASSERT_TRUE(saveAtomically(buffer.snapshot(), path));
+  EXPECT_EQ(read(), "1\ntwo\n");
+}
+
+TEST_F(SnapshotTest, KeepsPermissions) {
+  write("x\n");
+  chmod(path.c_str(), 0600);
+  TextBuffer buffer;
+  buffer.load(map());
+  ASSERT_TRUE(saveAtomically(buffer.snapshot(), path));
+  struct stat st;
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  EXPECT_EQ(st.st_mode & 0777, 0600u);
+}
+
+TEST_F(SnapshotTest, NewFilesFollowTheUmask) {
+  remove(path.c_str());
+  TextBuffer buffer;
+  buffer.appendLine("x");
+  mode_t mask = umask(077);
+  bool saved = saveAtomically(buffer.snapshot(), path);
+  umask(mask);
+  ASSERT_TRUE(saved);
+  struct stat st;
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  EXPECT_EQ(st.st_mode & 0777, 0600u);
+}
+
+TEST_F(SnapshotTest, ReportsErrors) {
+  TextBuffer buffer;
+  buffer.appendLine("x");
+  EXPECT_FALSE(saveAtomically(buffer.snapshot(), "no/such/dir/file"));
+  EXPECT_EQ(errno, ENOENT);
+}
+
+TEST_F(SnapshotTest, HashesContentsNotPieces) {
+  write("int main() {}\nreturn 0;\n");
+  TextBuffer buffer;
+  buffer.load(map());
+  uint64_t untouched = buffer.snapshot().hash();
+  string text = "int main() {}\nreturn 0;\n";
+  EXPECT_EQ(untouched, hashBytes(text.data(), text.size()));
+
+  // the same text made of edited lines hashes the same
+  buffer.setLine(1, "return 1;");
+  EXPECT_NE(buffer.snapshot().hash(), untouched);
+  buffer.setLine(1, "return 0;");
+  EXPECT_EQ(buffer.snapshot().hash(), untouched);
+}
@@ -0,0 +1,259 @@
+#include <buffer.h>
+#include <swap_journal.h>
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class SwapJournalTest : public ::testing::Test {
+
+protected:
+  string path = "swap_journal_test.txt";
+  string swap = SwapJournal::pathFor(path);
+
+  virtual void SetUp() {
+    ofstream(path) << "one\ntwo\nthree\n";
+  }
+
+  virtual void TearDown() {
+    remove(path.c_str());
+    remove(swap.c_str());
+  };
+
+  // the file as an editor that starts again reads it
+  void load(TextBuffer& buffer) {
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    ASSERT_TRUE(file->open(path));
+    buffer.load(file);
+  }
+
+  string contents(const TextBuffer& buffer) {
+    string out;
+    buffer.forEachLine([&out](LineView line) {
+      out += line.str();
+      out += '\n';
+    });
+    return out;
+  }
+
+  size_t fileSize(const string& file) {
+    struct stat st;
+    return stat(file.c_str(), &st) == 0 ? st.st_size : 0;
+  }
+
+  SwapJournal::Recovery replay(TextBuffer& buffer, size_t& edits) {
+    size_t length;
+    return SwapJournal::replay(swap, SwapJournal::baseOf(path), buffer,
+                               edits, length);
+  }
+};
+
+TEST_F(SwapJournalTest, NamesJournalsAfterTheirFile) {
+  // not .swp, which is what vim calls its own
+  EXPECT_EQ(SwapJournal::pathFor("a.cpp"), ".a.cpp.cpswp");
+  EXPECT_EQ(SwapJournal::pathFor("src/a.cpp"), "src/.a.cpp.cpswp");
+}
+
+TEST_F(SwapJournalTest, ReplaysEditsOntoTheFile) {
+  {
+    SwapJournal journal;
+    journal.attach(swap, SwapJournal::baseOf(path));
+    journal.recordInsert(0, 3, "!");
+    journal.recordErase(1, 0, 4);  // "two" and its line break
+    journal.recordInsert(1, 5, "\nfour");
+    EXPECT_EQ(fileSize(swap), 0u);  // nothing before a flush
+    ASSERT_TRUE(journal.flush());
+    EXPECT_EQ(journal.pending(), 0u);
+  }  // the editor crashes, the journal stays
+
+  TextBuffer buffer;
+  load(buffer);
+  size_t edits;
+  EXPECT_EQ(replay(buffer, edits), SwapJournal::RECOVERED);
+  EXPECT_EQ(edits, 3u);
+  EXPECT_EQ(contents(buffer), "one!\nthree\nfour\n");
+}
+
+TEST_F(SwapJournalTest, CostsTheSizeOfTheEdit) {
+  SwapJournal journal;
+  journal.attach(swap, SwapJournal::baseOf(path));
+  journal.recordInsert(0, 0, "x");
+  ASSERT_TRUE(journal.flush());
+  size_t before = fileSize(swap);
+  journal.recordInsert(0, 1, "y");
+  size_t record = journal.pending();
+  EXPECT_EQ(record, 9u);  // the op, three numbers, 'y' and a checksum
+  ASSERT_TRUE(journal.flush());
+  EXPECT_EQ(fileSize(swap), before + record);
+}
+
+TEST_F(SwapJournalTest, StopsAtARecordCutShort) {
+  {
+    SwapJournal journal;
+    journal.attach(swap, SwapJournal::baseOf(path));
+    journal.recordInsert(0, 0, "a");
+    journal.recordInsert(0, 1, "b");
+    ASSERT_TRUE(journal.flush());
+  }
+  // the crash came in the middle of the last write
+  ASSERT_EQ(truncate(swap.c_str(), fileSize(swap) - 1), 0);
+
+  TextBuffer buffer;
+  load(buffer);
+  size_t edits, length;
+  EXPECT_EQ(SwapJournal::replay(swap, SwapJournal::baseOf(path), buffer,
+                                edits, length),
+            SwapJournal::RECOVERED);
+  EXPECT_EQ(edits, 1u);
+  EXPECT_EQ(buffer.line(0).str(), "aone");
+
+  // the edits after the recovery go after the last complete record
+  SwapJournal journal;
+  journal.attach(swap, SwapJournal::baseOf(path));
+  ASSERT_TRUE(journal.resume(length));
+  journal.recordInsert(0, 4, "c");
+  ASSERT_TRUE(journal.flush());
+
+  TextBuffer again;
+  load(again);
+  EXPECT_EQ(replay(again, edits), SwapJournal::RECOVERED);
+  EXPECT_EQ(again.line(0).str(), "aonec");
+}
+
+TEST_F(SwapJournalTest, OnlyReplaysOntoItsVersion) {
+  TextBuffer buffer;
+  size_t edits;
+  EXPECT_EQ(replay(buffer, edits), SwapJournal::NOTHING);
+
+  SwapJournal journal;
+  journal.attach(swap, SwapJournal::baseOf(path));
+  journal.recordInsert(0, 0, "x");
+  ASSERT_TRUE(journal.flush());
+  ofstream(path) << "changed by another program\n";
+  load(buffer);
+  EXPECT_EQ(replay(buffer, edits), SwapJournal::OTHER_BASE);
+  EXPECT_EQ(buffer.line(0).str(), "changed by another program");
+}
+
+TEST_F(SwapJournalTest, LeavesForeignFilesAlone) {
+  string vim("b0VIM 9.0\0\0\0\0", 14);
+  ofstream(swap) << vim;
+  TextBuffer buffer;
+  load(buffer);
+  size_t edits;
+  EXPECT_EQ(replay(buffer, edits), SwapJournal::FOREIGN);
+  EXPECT_EQ(edits, 0u);
+  EXPECT_EQ(buffer.line(0).str(), "one");
+
+  // nor a journal cut short in its magic
+  ofstream(swap) << "CPSW";
+  EXPECT_EQ(replay(buffer, edits), SwapJournal::OTHER_BASE);
+  ofstream(swap) << "";
+  EXPECT_EQ(replay(buffer, edits), SwapJournal::NOTHING);
+}
+
+TEST_F(SwapJournalTest, OneEditorJournalsAFile) {
+  SwapJournal journal;
+  ASSERT_TRUE(journal.attach(swap, SwapJournal::baseOf(path)));
+  journal.recordInsert(0, 0, "x");
+  ASSERT_TRUE(journal.flush());
+  size_t size = fileSize(swap);
+
+  SwapJournal other;
+  EXPECT_FALSE(other.attach(swap, SwapJournal::baseOf(path)));
+  EXPECT_EQ(errno, EWOULDBLOCK);
+  EXPECT_FALSE(other.attached());
+  other.recordInsert(0, 0, "y");
+  EXPECT_TRUE(other.flush());
+  EXPECT_EQ(fileSize(swap), size);
+
+  // the lock goes with the journal, and with a rebase to the new file
+  ASSERT_TRUE(journal.rebase(SwapJournal::baseOf(path)));
+  EXPECT_FALSE(other.attach(swap, SwapJournal::baseOf(path)));
+  journal.detach();
+  EXPECT_TRUE(other.attach(swap, SwapJournal::baseOf(path)));
+}
+
+TEST_F(SwapJournalTest, SetsJournalsAsideUnderFreshNames) {
+  string kept[2];
+  for (int i = 0; i < 2; ++i) {
+    SwapJournal journal;
+    ASSERT_TRUE(journal.attach(swap, SwapJournal::baseOf(path)));
+    journal.recordInsert(0, 0, string(i + 1, 'x'));
+    ASSERT_TRUE(journal.flush());
+    size_t size = fileSize(swap);
+    ASSERT_TRUE(journal.setAside(kept[i]));
+    EXPECT_EQ(fileSize(kept[i]), size);
+    EXPECT_TRUE(journal.attached());
+    EXPECT_EQ(fileSize(swap), 0u);
+  }
+  EXPECT_EQ(kept[0], swap + ".old.1");
+  EXPECT_EQ(kept[1], swap + ".old.2");
+  EXPECT_NE(fileSize(kept[0]), fileSize(kept[1]));
+  // the journals nothing was written to are gone
+  EXPECT_NE(access(swap.c_str(), F_OK), 0);
+  remove(kept[0].c_str());
+  remove(kept[1].c_str());
+}
+
+TEST_F(SwapJournalTest, RebaseKeepsTheEditsMadeWhileSaving) {
+  SwapJournal journal;
+  journal.attach(swap, SwapJournal::baseOf(path));
+  TextBuffer buffer;
+  load(buffer);
+
+  buffer.insertText(0, 0, "1");
+  journal.recordInsert(0, 0, "1");
+  ASSERT_TRUE(journal.flush());
+  journal.checkpoint();
+  Snapshot saved = buffer.snapshot();
+  // typing goes on while the snapshot is written
+  buffer.insertText(0, 1, "2");
+  journal.recordInsert(0, 1, "2");
+  ASSERT_TRUE(journal.flush());
+  ASSERT_TRUE(saveAtomically(saved, path));
+  ASSERT_TRUE(journal.rebase(SwapJournal::baseOf(path)));
+
+  buffer.insertText(0, 2, "3");
+  journal.recordInsert(0, 2, "3");
+  ASSERT_TRUE(journal.flush());
+
+  TextBuffer recovered;
+  load(recovered);
+  EXPECT_EQ(recovered.line(0).str(), "1one");
+  size_t edits;
+  EXPECT_EQ(replay(recovered, edits), SwapJournal::RECOVERED);
+  EXPECT_EQ(edits, 2u);
+  EXPECT_EQ(contents(recovered), contents(buffer));
+
+  journal.remove();
+  EXPECT_NE(access(swap.c_str(), F_OK), 0);
+}
+
+TEST_F(SwapJournalTest, ReplaysReplacements) {
+  {
+    SwapJournal journal;
+    journal.attach(swap, SwapJournal::baseOf(path));
+    journal.recordInsert(2, 5, " three");
+    vector<TextPosition> at{{0, 2}, {2, 1}, {2, 7}};
+    journal.recordReplace(at, 1, "EE");
+    ASSERT_TRUE(journal.flush());
+  }
+
+  TextBuffer buffer;
+  load(buffer);
+  size_t edits;
+  EXPECT_EQ(replay(buffer, edits), SwapJournal::RECOVERED);
+  EXPECT_EQ(edits, 2u);
+  EXPECT_EQ(contents(buffer), "onEE\ntwo\ntEEree tEEree\n");
+}
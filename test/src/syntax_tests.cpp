@@ -0,0 +1,129 @@
+#include <buffer.h>
+#include <syntax.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// one letter per character: n normal, c comment, k keyword, t type,
+// s string, d number, p preprocessor
+static string classes(SyntaxHighlighter &syntax, const string &line,
+                      SyntaxHighlighter::State state = 0) {
+  vector<unsigned char> hl;
+  syntax.highlight(line, state, hl);
+  string out;
+  for (auto c : hl) out += "nckt" "sdp"[c];
+  return out;
+}
+
+// states at the start of every line as computed from scratch
+static vector<SyntaxHighlighter::State> freshStates(const TextBuffer &buffer) {
+  SyntaxHighlighter syntax;
+  vector<SyntaxHighlighter::State> states;
+  for (size_t y = 0; y <= buffer.lineCount(); ++y)
+    states.push_back(syntax.stateBefore(buffer, y));
+  return states;
+}
+
+static vector<SyntaxHighlighter::State> states(SyntaxHighlighter &syntax,
+                                               const TextBuffer &buffer) {
+  vector<SyntaxHighlighter::State> states;
+  for (size_t y = 0; y <= buffer.lineCount(); ++y)
+    states.push_back(syntax.stateBefore(buffer, y));
+  return states;
+}
+
+TEST(SyntaxHighlighterTest, Supports) {
+  EXPECT_TRUE(SyntaxHighlighter::supports("main.cpp"));
+  EXPECT_TRUE(SyntaxHighlighter::supports("dir.d/lib.h"));
+  EXPECT_FALSE(SyntaxHighlighter::supports("input.txt"));
+  EXPECT_FALSE(SyntaxHighlighter::supports("Makefile"));
+}
+
+TEST(SyntaxHighlighterTest, Tokens) {
+  SyntaxHighlighter syntax;
+  EXPECT_EQ(classes(syntax, "int x = 42;"), "tttnnnnnddn");
+  EXPECT_EQ(classes(syntax, "return\"a\\\"\";"), "kkkkkksssssn");
+  EXPECT_EQ(classes(syntax, "x1 = 1e+9;"), "nnnnnddddn");
+  EXPECT_EQ(classes(syntax, "a; // b"), "nnncccc");
+  EXPECT_EQ(classes(syntax, "a /* b */ c"), "nncccccccnn");
+  EXPECT_EQ(classes(syntax, "  #include \"x\""), "nnpppppppppsss");
+  EXPECT_EQ(classes(syntax, "R\"x(a)\")x\""), "ssssssssss");
+}
+
+TEST(SyntaxHighlighterTest, StatesAcrossLines) {
+  TextBuffer buffer;
+  buffer.appendLine("int a; /* open");
+  buffer.appendLine("still comment");
+  buffer.appendLine("*/ int b;");
+  buffer.appendLine("auto s = R\"(raw");
+  buffer.appendLine("int c; )\";");
+  buffer.appendLine("#define X \\");
+  buffer.appendLine("  1");
+  buffer.appendLine("int d;");
+
+  SyntaxHighlighter syntax;
+  EXPECT_EQ(classes(syntax, buffer.line(1).str(),
+                    syntax.stateBefore(buffer, 1)),
+            "ccccccccccccc");
+  EXPECT_EQ(classes(syntax, buffer.line(2).str(),
+                    syntax.stateBefore(buffer, 2)),
+            "ccntttnnn");
+  EXPECT_EQ(classes(syntax, buffer.line(4).str(),
+                    syntax.stateBefore(buffer, 4)),
+            "sssssssssn");
+  EXPECT_EQ(classes(syntax, buffer.line(6).str(),
+                    syntax.stateBefore(buffer, 6)),
+            "ppp");
+  EXPECT_EQ(syntax.stateBefore(buffer, 7), 0u);
+}
+
+TEST(SyntaxHighlighterTest, EditsRelexOnlyTheChange) {
+  TextBuffer buffer;
+  for (int i = 0; i < 1000; ++i) buffer.appendLine("int x = 0;");
+  SyntaxHighlighter syntax;
+  syntax.stateBefore(buffer, 1000);
+  EXPECT_EQ(syntax.linesLexed(), 1000u);
+
+  // an edit that doesn't change the state at the end of the line
+  buffer.setLine(10, "int y = 1;");
+  syntax.invalidate(10);
+  syntax.stateBefore(buffer, 1000);
+  EXPECT_EQ(syntax.linesLexed(), 1001u);
+
+  // opening a comment changes every line after it; only the lines before
+  // the one asked for are lexed
+  buffer.setLine(10, "/* int y = 1;");
+  syntax.invalidate(10);
+  syntax.stateBefore(buffer, 20);
+  EXPECT_EQ(syntax.linesLexed(), 1011u);
+  EXPECT_EQ(states(syntax, buffer), freshStates(buffer));
+
+  // closing it again
+  buffer.setLine(10, "int y = 1;");
+  syntax.invalidate(10);
+  EXPECT_EQ(states(syntax, buffer), freshStates(buffer));
+}
+
+TEST(SyntaxHighlighterTest, InsertAndEraseLines) {
+  TextBuffer buffer;
+  for (int i = 0; i < 50; ++i) buffer.appendLine("int x = 0;");
+  SyntaxHighlighter syntax;
+  syntax.stateBefore(buffer, 50);
+
+  buffer.insertLine(5, "/*");
+  buffer.insertLine(6, "*/");
+  syntax.insertLines(5, 2);
+  EXPECT_EQ(states(syntax, buffer), freshStates(buffer));
+
+  buffer.eraseLine(6);
+  syntax.eraseLines(6, 1);
+  EXPECT_EQ(states(syntax, buffer), freshStates(buffer));
+
+  buffer.eraseLine(5);
+  syntax.eraseLines(5, 1);
+  EXPECT_EQ(states(syntax, buffer), freshStates(buffer));
+  EXPECT_EQ(syntax.stateBefore(buffer, 49), 0u);
+}
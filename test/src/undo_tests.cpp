@@ -0,0 +1,240 @@
+#include <buffer.h>
+#include <undo.h>
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static TextPosition at(size_t y, size_t x) { return TextPosition{y, x}; }
+
+static void apply(TextBuffer &buffer, const UndoJournal::Step &step) {
+  if (step.replace)
+    buffer.replaceAll(step.at, step.n, step.text);
+  else if (step.insert)
+    buffer.insertText(step.y, step.x, step.text);
+  else
+    buffer.eraseText(step.y, step.x, step.text.size());
+}
+
+static string contents(const TextBuffer &buffer) {
+  string out;
+  buffer.forEachLine([&out](LineView line) { out += line.str() + "\n"; });
+  return out;
+}
+
+TEST(UndoJournalTest, TypingIsOneStep) {
+  UndoJournal journal;
+  for (size_t x = 0; x < 5; ++x)
+    journal.recordInsert(0, x, string(1, 'a' + x), at(0, x), at(0, x + 1));
+
+  UndoJournal::Step step;
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_FALSE(step.insert);
+  EXPECT_EQ("abcde", step.text);
+  EXPECT_EQ(0u, step.x);
+  EXPECT_EQ(0u, step.cursor.x);
+  EXPECT_FALSE(journal.undo(step));
+}
+
+TEST(UndoJournalTest, SealAndLineBreakEndSteps) {
+  UndoJournal journal;
+  journal.recordInsert(0, 0, "a", at(0, 0), at(0, 1));
+  journal.seal();
+  journal.recordInsert(0, 1, "b", at(0, 1), at(0, 2));
+  journal.recordInsert(0, 2, "\n", at(0, 2), at(1, 0));
+  journal.recordInsert(1, 0, "c", at(1, 0), at(1, 1));
+
+  UndoJournal::Step step;
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("c", step.text);
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("\n", step.text);
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("b", step.text);
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("a", step.text);
+}
+
+TEST(UndoJournalTest, BackspaceRunIsMerged) {
+  UndoJournal journal;
+  // "hello" with the cursor at the end, erase "llo" backwards
+  journal.recordErase(0, 4, "o", at(0, 5), at(0, 4));
+  journal.recordErase(0, 3, "l", at(0, 4), at(0, 3));
+  journal.recordErase(0, 2, "l", at(0, 3), at(0, 2));
+
+  UndoJournal::Step step;
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_TRUE(step.insert);
+  EXPECT_EQ(2u, step.x);
+  EXPECT_EQ("llo", step.text);
+  EXPECT_EQ(5u, step.cursor.x);
+  EXPECT_FALSE(journal.undo(step));
+}
+
+TEST(UndoJournalTest, UndoRedoRoundTrip) {
+  TextBuffer buffer;
+  buffer.appendLine("int main() {}");
+  UndoJournal journal;
+
+  buffer.insertText(0, 12, "\n  return 0;\n");
+  journal.recordInsert(0, 12, "\n  return 0;\n", at(0, 12), at(2, 0));
+  journal.seal();
+  buffer.eraseText(0, 0, 4);
+  journal.recordErase(0, 0, "int ", at(0, 4), at(0, 0));
+  string edited = contents(buffer);
+
+  UndoJournal::Step step;
+  while (journal.undo(step)) apply(buffer, step);
+  EXPECT_EQ("int main() {}\n", contents(buffer));
+  EXPECT_EQ(12u, step.cursor.x);
+
+  while (journal.redo(step)) apply(buffer, step);
+  EXPECT_EQ(edited, contents(buffer));
+  EXPECT_EQ(0u, step.cursor.y);
+}
+
+TEST(UndoJournalTest, NewEditDropsRedo) {
+  UndoJournal journal;
+  journal.recordInsert(0, 0, "ab", at(0, 0), at(0, 2));
+  UndoJournal::Step step;
+  ASSERT_TRUE(journal.undo(step));
+  journal.recordInsert(0, 0, "cd", at(0, 0), at(0, 2));
+  EXPECT_FALSE(journal.redo(step));
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("cd", step.text);
+}
+
+TEST(UndoJournalTest, OldestRecordsAreDropped) {
+  UndoJournal journal(4096);
+  string chunk(1000, 'x');
+  for (size_t i = 0; i < 100; ++i) {
+    journal.recordInsert(i, 0, chunk, at(i, 0), at(i, 1000));
+    EXPECT_LE(journal.memoryUsage(), 4096u);
+  }
+
+  UndoJournal::Step step;
+  size_t steps = 0;
+  while (journal.undo(step)) {
+    EXPECT_EQ(chunk, step.text);
+    steps++;
+  }
+  EXPECT_GT(steps, 0u);
+  EXPECT_LT(steps, 5u);
+  EXPECT_EQ(99u - steps + 1, step.y);
+}
+
+TEST(UndoJournalTest, KeepsARecordOverTheLimit) {
+  UndoJournal journal(100);
+  string paste(1000, 'x');
+  journal.recordInsert(0, 0, paste, at(0, 0), at(0, 1000));
+  UndoJournal::Step step;
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ(paste, step.text);
+  ASSERT_TRUE(journal.redo(step));
+
+  // the next edit is newer, the paste goes
+  journal.recordInsert(0, 1000, "yz", at(0, 1000), at(0, 1002));
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("yz", step.text);
+  EXPECT_FALSE(journal.undo(step));
+}
+
+TEST(UndoJournalTest, LimitKeepsTheRedoRecords) {
+  UndoJournal journal;
+  journal.recordInsert(0, 0, "ab", at(0, 0), at(0, 2));
+  journal.recordInsert(0, 2, "cd", at(0, 2), at(0, 4));
+  journal.recordInsert(0, 4, "ef", at(0, 4), at(0, 6));
+  UndoJournal::Step step;
+  while (journal.undo(step)) {
+  }
+  journal.setLimit(1);
+  for (const char* text : {"ab", "cd", "ef"}) {
+    ASSERT_TRUE(journal.redo(step));
+    EXPECT_EQ(text, step.text);
+  }
+}
+
+TEST(UndoJournalTest, GroupIsOneStep) {
+  UndoJournal journal;
+  journal.recordInsert(0, 0, "a", at(0, 0), at(0, 1));
+  journal.beginGroup();
+  for (size_t y = 0; y < 3; ++y)
+    journal.recordInsert(y, 1, "b", at(0, 1), at(0, 2));
+  journal.endGroup();
+  journal.recordInsert(0, 2, "c", at(0, 2), at(0, 3));
+
+  UndoJournal::Step step;
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("c", step.text);
+  EXPECT_FALSE(step.more);
+  for (size_t y = 3; y-- > 0;) {
+    ASSERT_TRUE(journal.undo(step));
+    EXPECT_EQ(y, step.y);
+    EXPECT_EQ(y > 0, step.more);
+  }
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("a", step.text);  // not merged with the group
+
+  ASSERT_TRUE(journal.redo(step));
+  EXPECT_FALSE(step.more);
+  for (size_t y = 0; y < 3; ++y) {
+    ASSERT_TRUE(journal.redo(step));
+    EXPECT_EQ(y < 2, step.more);
+  }
+}
+
+TEST(UndoJournalTest, OpenGroupTakesTheTypingAfterIt) {
+  UndoJournal journal;
+  journal.beginGroup();
+  journal.recordInsert(0, 3, "\n", at(1, 0), at(1, 0));
+  journal.recordInsert(1, 0, "a", at(1, 0), at(1, 1));
+  journal.endGroup(true);
+  journal.recordInsert(1, 1, "b", at(1, 1), at(1, 2));
+
+  UndoJournal::Step step;
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("ab", step.text);
+  EXPECT_TRUE(step.more);
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_EQ("\n", step.text);
+  EXPECT_FALSE(step.more);
+  EXPECT_FALSE(journal.undo(step));
+}
+
+TEST(UndoJournalTest, ReplacementIsOneStep) {
+  TextBuffer buffer;
+  for (const char* line : {"ab ab", "", "xab", "ababab"})
+    buffer.appendLine(line);
+  string before = contents(buffer);
+  vector<TextPosition> found;
+  buffer.findAll("ab", found);
+  buffer.replaceAll(found, 2, "xyz");
+  string after = contents(buffer);
+  EXPECT_EQ("xyz xyz\n\nxxyz\nxyzxyzxyz\n", after);
+
+  UndoJournal journal;
+  journal.recordReplace("ab", "xyz", found, at(0, 0), at(0, 0));
+
+  UndoJournal::Step step;
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_TRUE(step.replace);
+  EXPECT_FALSE(step.more);
+  EXPECT_EQ("ab", step.text);
+  EXPECT_EQ(3u, step.n);
+  apply(buffer, step);
+  EXPECT_EQ(before, contents(buffer));
+  EXPECT_FALSE(journal.undo(step));
+
+  ASSERT_TRUE(journal.redo(step));
+  EXPECT_EQ("xyz", step.text);
+  apply(buffer, step);
+  EXPECT_EQ(after, contents(buffer));
+
+  // the next edit is a step of its own
+  journal.recordInsert(0, 0, "q", at(0, 0), at(0, 1));
+  ASSERT_TRUE(journal.undo(step));
+  EXPECT_FALSE(step.replace);
+  EXPECT_EQ("q", step.text);
+}
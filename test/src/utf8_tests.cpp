@@ -0,0 +1,50 @@
+#include <utf8.h>
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace std;
+
+TEST(Utf8Test, Decode) {
+  uint32_t c;
+  EXPECT_EQ(decodeUtf8("a", 1, c), 1u);
+  EXPECT_EQ(c, 0x61u);
+  EXPECT_EQ(decodeUtf8("\xC3\xA9", 2, c), 2u);
+  EXPECT_EQ(c, 0xE9u);
+  EXPECT_EQ(decodeUtf8("\xE6\xBC\xA2", 3, c), 3u);
+  EXPECT_EQ(c, 0x6F22u);
+  EXPECT_EQ(decodeUtf8("\xF0\x9F\x98\x80", 4, c), 4u);
+  EXPECT_EQ(c, 0x1F600u);
+}
+
+TEST(Utf8Test, RejectInvalid) {
+  uint32_t c;
+  EXPECT_EQ(decodeUtf8("\x80", 1, c), 0u);          // continuation byte
+  EXPECT_EQ(decodeUtf8("\xE6\xBC", 2, c), 0u);      // truncated
+  EXPECT_EQ(decodeUtf8("\xC0\xAF", 2, c), 0u);      // overlong
+  EXPECT_EQ(decodeUtf8("\xED\xA0\x80", 3, c), 0u);  // surrogate
+  EXPECT_EQ(decodeUtf8("\xFF", 1, c), 0u);
+}
+
+TEST(Utf8Test, Width) {
+  EXPECT_EQ(codePointWidth('a'), 1);
+  EXPECT_EQ(codePointWidth(0xE9), 1);
+  EXPECT_EQ(codePointWidth(0x0301), 0);
+  EXPECT_EQ(codePointWidth(0x3042), 2);   // hiragana
+  EXPECT_EQ(codePointWidth(0x6F22), 2);   // kanji
+  EXPECT_EQ(codePointWidth(0xFF21), 2);   // fullwidth A
+  EXPECT_EQ(codePointWidth(0x1F600), 2);  // emoji
+  EXPECT_EQ(codePointWidth(0x0414), 1);   // cyrillic
+}
+
+TEST(Utf8Test, PlainSpan) {
+  string text(40, 'a');
+  EXPECT_EQ(plainSpan(text.data(), text.size()), 40u);
+  for (size_t i = 0; i < 40; ++i) {
+    string tab = text, wide = text;
+    tab[i] = '\t';
+    wide[i] = '\xE6';
+    EXPECT_EQ(plainSpan(tab.data(), tab.size()), i);
+    EXPECT_EQ(plainSpan(wide.data(), wide.size()), i);
+  }
+}
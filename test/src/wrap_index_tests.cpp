@@ -0,0 +1,114 @@
+#include <wrap_index.h>
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+class WrapIndexTest : public ::testing::Test {
+
+protected:
+  WrapIndex wrap;
+  vector<size_t> widths;
+
+  void build(size_t columns) {
+    const vector<size_t>& w = widths;
+    wrap.build(w.size(), columns, [&w](size_t y) { return w[y]; });
+  }
+
+  // rows of the lines, worked out one by one
+  void expectRows() {
+    size_t row = 0;
+    for (size_t y = 0; y < widths.size(); ++y) {
+      size_t rows = widths[y] / wrap.columns() + 1;
+      ASSERT_EQ(wrap.rowsOf(y), rows) << "line " << y;
+      ASSERT_EQ(wrap.rowOf(y), row) << "line " << y;
+      size_t skip;
+      ASSERT_EQ(wrap.lineAt(row + rows - 1, skip), y);
+      ASSERT_EQ(skip, rows - 1);
+      row += rows;
+    }
+    ASSERT_EQ(wrap.totalRows(), row);
+    ASSERT_EQ(wrap.rowOf(widths.size()), row);
+  }
+};
+
+TEST_F(WrapIndexTest, MapsRowsAndLines) {
+  widths = {0, 10, 25, 9, 30};
+  build(10);
+  // a line as wide as the screen gets a row for the cursor after it
+  EXPECT_EQ(wrap.rowsOf(1), 2u);
+  EXPECT_EQ(wrap.rowsOf(2), 3u);
+  EXPECT_EQ(wrap.totalRows(), 11u);
+  size_t skip;
+  EXPECT_EQ(wrap.lineAt(4, skip), 2u);
+  EXPECT_EQ(skip, 1u);
+  EXPECT_EQ(wrap.lineAt(11, skip), 5u);  // past the end
+  expectRows();
+}
+
+TEST_F(WrapIndexTest, FollowsEdits) {
+  widths = {5, 50, 5};
+  build(20);
+  wrap.setWidth(0, 45);
+  widths[0] = 45;
+  wrap.insertLines(1, 2);
+  widths.insert(widths.begin() + 1, 2, 0);
+  wrap.setWidth(2, 21);
+  widths[2] = 21;
+  expectRows();
+  wrap.eraseLines(0, 2);
+  widths.erase(widths.begin(), widths.begin() + 2);
+  expectRows();
+
+  // inserting past the leaves there are grows the tree
+  wrap.insertLines(3, 100);
+  widths.insert(widths.end(), 100, 0);
+  expectRows();
+}
+
+TEST_F(WrapIndexTest, ResizingOnlyWrapsLongLines) {
+  widths.assign(10000, 30);
+  widths[17] = 500;
+  widths[9000] = 100;
+  build(80);
+  size_t wrapped = wrap.linesWrapped();
+
+  wrap.setColumns(60);
+  EXPECT_EQ(wrap.linesWrapped() - wrapped, 2u);
+  expectRows();
+  wrap.setColumns(20);  // now every line is as wide as the screen
+  EXPECT_EQ(wrap.linesWrapped() - wrapped, 2u + 10000u);
+  expectRows();
+}
+
+TEST_F(WrapIndexTest, AgreesWithTheWidthsAfterEdits) {
+  srand(3);
+  widths.assign(50, 0);
+  for (size_t& w : widths) w = rand() % 40;
+  build(7);
+  for (int round = 0; round < 500; ++round) {
+    size_t y = rand() % widths.size();
+    switch (rand() % 4) {
+      case 0:
+        widths[y] = rand() % 40;
+        wrap.setWidth(y, widths[y]);
+        break;
+      case 1:
+        widths.insert(widths.begin() + y, 0);
+        wrap.insertLines(y, 1);
+        break;
+      case 2:
+        if (widths.size() > 1) {
+          widths.erase(widths.begin() + y);
+          wrap.eraseLines(y, 1);
+        }
+        break;
+      case 3:
+        wrap.setColumns(1 + rand() % 30);
+        break;
+    }
+    expectRows();
+  }
+}